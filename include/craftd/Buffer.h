@@ -36,12 +36,26 @@
 
 typedef struct evbuffer* CDRawBuffer;
 
+typedef evbuffer_ref_cleanup_cb CDBufferCleanup;
+
 typedef struct _CDBuffer {
 	CDRawBuffer raw;
 
 	bool external;
 } CDBuffer;
 
+/**
+ * Immutable data shared by reference between many Buffers, it's freed when
+ * the last reference is released.
+ */
+typedef struct _CDSharedBuffer {
+	int                references;
+	pthread_spinlock_t lock;
+
+	size_t    length;
+	CDPointer data;
+} CDSharedBuffer;
+
 /**
  * Create an empty Buffer object
  *
@@ -70,8 +84,37 @@ void CD_BufferAdd (CDBuffer* self, CDPointer data, size_t length);
 
 void CD_BufferAddBuffer (CDBuffer* self, CDBuffer* data);
 
+/**
+ * Append data to the Buffer without copying it, the data has to stay valid and
+ * unchanged until the cleanup function is called.
+ *
+ * @param cleanup Called with the data, length and context once the Buffer is done with it
+ */
+void CD_BufferAddReference (CDBuffer* self, CDPointer data, size_t length, CDBufferCleanup cleanup, CDPointer context);
+
+/**
+ * Append a SharedBuffer to the Buffer without copying it, the Buffer holds a
+ * reference until the data has been sent or drained.
+ */
+void CD_BufferAddShared (CDBuffer* self, CDSharedBuffer* data);
+
 CDPointer CD_BufferRemove (CDBuffer* self, size_t length);
 
 CDBuffer* CD_BufferRemoveBuffer (CDBuffer* self);
 
+/**
+ * Create a SharedBuffer with a copy of the content of a Buffer, the only copy
+ * made however many Buffers it's appended to.
+ *
+ * @return The SharedBuffer with one reference owned by the caller
+ */
+CDSharedBuffer* CD_CreateSharedBuffer (CDBuffer* data);
+
+CDSharedBuffer* CD_RetainSharedBuffer (CDSharedBuffer* self);
+
+/**
+ * Release a reference to the SharedBuffer, destroying it if it was the last.
+ */
+void CD_ReleaseSharedBuffer (CDSharedBuffer* self);
+
 #endif
@@ -38,6 +38,20 @@ typedef struct _CDBuffers {
 	CDBuffer* input;
 	CDBuffer* output;
 
+	/// Progress of the protocol framing the next packet of the input, kept
+	/// between reads so the bytes already validated aren't looked at again
+	struct {
+		int    type;
+		int    step;
+		bool   complete;
+		size_t offset;
+		size_t variable;
+		size_t count;
+
+		/// Reused to hand a validated frame to the packet parser
+		CDRawBuffer packet;
+	} frame;
+
 	bool external;
 } CDBuffers;
 
@@ -51,4 +65,10 @@ void CD_BufferReadIn (CDBuffers* self, size_t low, size_t high);
 
 void CD_BuffersFlush (CDBuffers* self);
 
+/**
+ * Forget the framing progress, to be called once the framed packet has been
+ * consumed from the input.
+ */
+void CD_BuffersResetFrame (CDBuffers* self);
+
 #endif
@@ -29,6 +29,7 @@
 #include <craftd/common.h>
 
 struct _CDServer;
+struct _CDReactor;
 
 typedef enum _CDClientStatus {
 	CDClientConnect,
@@ -40,12 +41,26 @@ typedef enum _CDClientStatus {
 typedef struct _CDClient {
 	struct _CDServer* server;
 
+	/// The Reactor running the Client's I/O, it never changes
+	struct _CDReactor* reactor;
+
 	char            ip[128];
 	evutil_socket_t socket;
 	CDBuffers*      buffers;
 
 	CDClientStatus status;
-	uint8_t        jobs;
+
+	/// Jobs of the client queued or running, the disconnection waits for them
+	uint8_t jobs;
+
+	/// Output is gathered in pending and handed to the socket in one go by the
+	/// reactor, see CD_ClientFlush
+	struct {
+		CDBuffer*     pending;
+		struct event* flush;
+		bool          scheduled;
+		int           corked;
+	} output;
 
 	struct {
 		pthread_rwlock_t status;
@@ -69,6 +84,11 @@ CDClient* CD_CreateClient (struct _CDServer* server);
  */
 void CD_DestroyClient (CDClient* self);
 
+/**
+ * Pin the Client to a Reactor, its output is written on the Reactor's thread.
+ */
+void CD_ClientSetReactor (CDClient* self, struct _CDReactor* reactor);
+
 /**
  * Send a raw String to a Client
  *
@@ -76,4 +96,51 @@ void CD_DestroyClient (CDClient* self);
  */
 void CD_ClientSendBuffer (CDClient* self, CDBuffer* data);
 
+/**
+ * Send data to a Client without copying it, see CD_BufferAddReference
+ *
+ * The cleanup function is called right away if the Client can't be written to.
+ */
+void CD_ClientSendReference (CDClient* self, CDPointer data, size_t length, CDBufferCleanup cleanup, CDPointer context);
+
+/**
+ * Send a SharedBuffer to a Client, the data is referenced and not copied so
+ * the same SharedBuffer can be sent to any number of Clients.
+ */
+void CD_ClientSendShared (CDClient* self, CDSharedBuffer* data);
+
+/**
+ * Schedule the write of the Client's pending output on its Reactor, all the
+ * data sent until the Reactor gets to it is written with a single call.
+ *
+ * The Send functions flush by themselves unless the Client is corked.
+ */
+void CD_ClientFlush (CDClient* self);
+
+/**
+ * Hold back the Client's output until the matching CD_ClientUncork, used while
+ * one of its jobs runs so all its responses are flushed at the end of the job.
+ */
+void CD_ClientCork (CDClient* self);
+
+void CD_ClientUncork (CDClient* self);
+
+/**
+ * Mark a Client as disconnecting, its disconnection is scheduled right away
+ * or by CD_ClientReleaseJob once its last job is done.
+ *
+ * Must be called with the status lock held for writing.
+ *
+ * @return false if the Client was already disconnecting
+ */
+bool CD_ClientDisconnect (CDClient* self);
+
+/**
+ * Mark one of the Client's jobs as done, the Client must not be used after
+ * this unless another job of it is still pending.
+ *
+ * Must be called with the status lock held for writing.
+ */
+void CD_ClientReleaseJob (CDClient* self);
+
 #endif
@@ -43,6 +43,7 @@ typedef struct _CDConfig {
 
 			uint16_t port;
 			int      backlog;
+			bool     reuseport;
 		} connection;
 
 		struct {
@@ -50,6 +51,7 @@ typedef struct _CDConfig {
 		} files;
 
 		int workers;
+		int reactors;
 
 		struct {
 			struct {
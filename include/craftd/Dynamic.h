@@ -26,15 +26,110 @@
 #ifndef CRAFTD_DYNAMIC_H
 #define CRAFTD_DYNAMIC_H
 
-#define CD_DEFINE_DYNAMIC CDHash* _dynamic
+/**
+ * Dynamic properties, values plugins hang on the core objects.
+ *
+ * Every property name gets a slot once for the life of the process, and every
+ * object carries a value per slot inline, so getting or putting through a
+ * slot is an indexed load or store. Going through the name resolves the slot
+ * first and should stay out of hot paths.
+ *
+ * Names coming after the slots ran out get slots past CD_DYNAMIC_SLOTS, whose
+ * values live in a per object map instead.
+ */
+#define CD_DYNAMIC_SLOTS 32
+
+struct _CDMap;
+
+/// 0 means no slot, the ones from CD_DYNAMIC_SLOTS on are overflowing
+typedef uint16_t CDDynamicSlot;
+
+typedef struct _CDDynamic {
+	CDPointer slots[CD_DYNAMIC_SLOTS];
+
+	/// Values of the overflowing slots, created on first use
+	struct _CDMap* overflow;
+} CDDynamic;
+
+#define CD_DEFINE_DYNAMIC CDDynamic _dynamic
+
+#define DYNAMIC(data) (&(data)->_dynamic)
+
+void CD_InitDynamic (CDDynamic* self);
+
+void CD_FinalizeDynamic (CDDynamic* self);
+
+/**
+ * Reserve the slot for a property name, or get it if it's already reserved.
+ *
+ * Plugins should do this once at initialization and keep the slot around.
+ *
+ * @return the slot, past CD_DYNAMIC_SLOTS when the inline ones ran out, or 0
+ *         only if every slot is taken
+ */
+CDDynamicSlot CD_DynamicSlot (const char* name);
+
+/**
+ * Get the slot of a property name without reserving it
+ *
+ * @return the slot or 0 if the name has none
+ */
+CDDynamicSlot CD_DynamicFindSlot (const char* name);
+
+/**
+ * Get the slot of a property name, reserved once per call site when the name
+ * is a string literal.
+ */
+#define CD_DYNAMIC_SLOT(name)                                                                       \
+	(__builtin_constant_p(name) ? ({                                                               \
+		static CDDynamicSlot __slot__ = 0;                                                          \
+		CDDynamicSlot        __current__ = __atomic_load_n(&__slot__, __ATOMIC_RELAXED);            \
+									                                                                \
+		if (!__current__) {                                                                         \
+			__atomic_store_n(&__slot__, (__current__ = CD_DynamicSlot(name)), __ATOMIC_RELAXED);    \
+		}                                                                                           \
+									                                                                \
+		__current__;                                                                                \
+	}) : CD_DynamicSlot(name))
+
+CDPointer cd_DynamicGetOverflow (CDDynamic* self, CDDynamicSlot slot);
+
+CDPointer cd_DynamicPutOverflow (CDDynamic* self, CDDynamicSlot slot, CDPointer value);
+
+static inline
+CDPointer
+cd_DynamicGetSlot (CDDynamic* self, CDDynamicSlot slot)
+{
+	if (__builtin_expect(slot == 0 || slot >= CD_DYNAMIC_SLOTS, 0)) {
+		return cd_DynamicGetOverflow(self, slot);
+	}
+
+	return __atomic_load_n(&self->slots[slot], __ATOMIC_ACQUIRE);
+}
+
+static inline
+CDPointer
+cd_DynamicPutSlot (CDDynamic* self, CDDynamicSlot slot, CDPointer value)
+{
+	if (__builtin_expect(slot == 0 || slot >= CD_DYNAMIC_SLOTS, 0)) {
+		return cd_DynamicPutOverflow(self, slot, value);
+	}
+
+	return __atomic_exchange_n(&self->slots[slot], value, __ATOMIC_ACQ_REL);
+}
+
+CDPointer cd_DynamicGet (CDDynamic* self, const char* name);
+
+CDPointer cd_DynamicPut (CDDynamic* self, const char* name, CDPointer value);
 
-#define DYNAMIC(data) ((data)->_dynamic)
+CDPointer cd_DynamicDelete (CDDynamic* self, const char* name);
 
-#define CD_CreateDynamic()  CD_CreateHash()
-#define CD_DestroyDynamic(self) CD_DestroyHash(self)
+#define CD_DynamicGetSlot(object, slot)        cd_DynamicGetSlot(DYNAMIC(object), slot)
+#define CD_DynamicPutSlot(object, slot, value) cd_DynamicPutSlot(DYNAMIC(object), slot, (CDPointer) (value))
+#define CD_DynamicDeleteSlot(object, slot)     cd_DynamicPutSlot(DYNAMIC(object), slot, CDNull)
 
-#define CD_DynamicGet(object, property)        CD_HashGet(DYNAMIC(object), property)
-#define CD_DynamicPut(object, property, value) CD_HashPut(DYNAMIC(object), property, (value))
-#define CD_DynamicDelete(object, property)     CD_HashDelete(DYNAMIC(object), property)
+#define CD_DynamicGet(object, property)        cd_DynamicGet(DYNAMIC(object), property)
+#define CD_DynamicPut(object, property, value) cd_DynamicPut(DYNAMIC(object), property, (CDPointer) (value))
+#define CD_DynamicDelete(object, property)     cd_DynamicDelete(DYNAMIC(object), property)
 
 #endif
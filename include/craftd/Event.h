@@ -30,11 +30,46 @@
 
 typedef bool (*CDEventCallbackFunction)();
 
+/**
+ * Interned event name, 0 is never a valid one.
+ */
+typedef uint16_t CDEventId;
+
+/**
+ * The dispatch hooks, Event.dispatch:before and Event.dispatch:after.
+ */
+typedef enum _CDEventHook {
+	CDEventHookBefore = 1 << 0,
+	CDEventHookAfter  = 1 << 1
+} CDEventHook;
+
+/**
+ * The events a dispatch hook runs for.
+ */
+typedef struct _CDEventFilter {
+	/// Run for every event given to CD_EventProvides, even later ones
+	bool provided;
+
+	/// Bit set of the CDEventIds to run for
+	uint64_t events[CD_EVENTS_MAX / 64];
+} CDEventFilter;
+
 typedef struct _CDEventCallback {
 	CDEventCallbackFunction function;
 	int                     priority;
+
+	/// Only used by dispatch hooks, NULL runs them for every event
+	CDEventFilter* filter;
 } CDEventCallback;
 
+/**
+ * The callbacks of an event sorted by priority, never changed once published.
+ */
+typedef struct _CDEventCallbacks {
+	size_t          length;
+	CDEventCallback item[];
+} CDEventCallbacks;
+
 CDEventCallback* CD_CreateEventCallback (CDEventCallbackFunction function, int priority);
 
 void CD_DestroyEventCallback (CDEventCallback* self);
@@ -43,6 +78,78 @@ CDList* CD_CreateEventParameters (const char* first, ...);
 
 void CD_DestroyEventParameters (CDList* parameters);
 
+/**
+ * Intern an event name, the ids are shared by every Server.
+ *
+ * Running out of ids aborts, see CD_EVENTS_MAX.
+ *
+ * @return The id of the event
+ */
+CDEventId CD_EventId (const char* eventName);
+
+/**
+ * Get the id of an event name, interned once per call site when the name is
+ * a string literal.
+ */
+#define CD_EVENT_ID(eventName)                                                                      \
+	(__builtin_constant_p(eventName) ? ({                                                          \
+		static CDEventId __id__ = 0;                                                                \
+		CDEventId        __current__ = __atomic_load_n(&__id__, __ATOMIC_RELAXED);                  \
+									                                                                \
+		if (!__current__) {                                                                         \
+			__atomic_store_n(&__id__, (__current__ = CD_EventId(eventName)), __ATOMIC_RELAXED);     \
+		}                                                                                           \
+									                                                                \
+		__current__;                                                                                \
+	}) : CD_EventId(eventName))
+
+/**
+ * Count a dispatch in the current epoch, what it loads from the callbacks
+ * stays allocated until the matching cd_EventLeave.
+ *
+ * @return The epoch to pass to cd_EventLeave
+ */
+static inline
+uint64_t
+cd_EventEnter (CDServer* server)
+{
+	uint64_t epoch = __atomic_load_n(&server->event.retired.epoch, __ATOMIC_SEQ_CST);
+
+	__atomic_add_fetch(&server->event.retired.readers[epoch & 1], 1, __ATOMIC_SEQ_CST);
+
+	return epoch;
+}
+
+static inline
+void
+cd_EventLeave (CDServer* server, uint64_t epoch)
+{
+	__atomic_sub_fetch(&server->event.retired.readers[epoch & 1], 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Get the current callbacks of an event, they stay valid until cd_EventLeave
+ * even if the event's callbacks change meanwhile.
+ *
+ * @return The callbacks or NULL if there are none
+ */
+static inline
+CDEventCallbacks*
+CD_EventCallbacks (CDServer* server, CDEventId id)
+{
+	return __atomic_load_n(&server->event.callbacks[id], __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Get the CDEventHook bits of the dispatch hooks to run for an event.
+ */
+static inline
+uint8_t
+CD_EventHooks (CDServer* server, CDEventId id)
+{
+	return __atomic_load_n(&server->event.hooks.all, __ATOMIC_RELAXED) | __atomic_load_n(&server->event.hooks.events[id], __ATOMIC_RELAXED);
+}
+
 /**
  * Tell the system that an event is being provided.
  *
@@ -54,13 +161,18 @@ void CD_DestroyEventParameters (CDList* parameters);
  */
 bool CD_EventProvides (CDServer* server, const char* eventName, CDList* parameters);
 
-bool cd_EventBeforeDispatch (CDServer* self, const char* eventName, ...);
+bool cd_EventBeforeDispatch (CDServer* self, CDEventId id, const char* eventName, ...);
 
-bool cd_EventAfterDispatch (CDServer* self, const char* eventName, bool interrupted, ...);
+bool cd_EventAfterDispatch (CDServer* self, CDEventId id, const char* eventName, bool interrupted, ...);
 
 /**
  * Dispatch an event with the given name and the given parameters.
  *
+ * The callbacks are walked without taking any lock or allocating anything, the
+ * dispatch only counts itself in the current epoch so what it walks isn't
+ * freed under it. The dispatch hooks are only looked at when one wants the
+ * event.
+ *
  * Pay attention to the parameters you pass, those go on the stack and passing float/double
  * could get them borked. Pointers are always safe to pass.
  *
@@ -73,24 +185,27 @@ bool cd_EventAfterDispatch (CDServer* self, const char* eventName, bool interrup
 									                                                                \
 		bool __interrupted__ = false;                                                               \
 									                                                                \
-		if (!cd_EventBeforeDispatch(self, eventName, ##__VA_ARGS__)) {                              \
-			break;                                                                                  \
-		}                                                                                           \
+		CDEventId __id__    = CD_EVENT_ID(eventName);                                               \
+		uint8_t   __hooks__ = CD_EventHooks(self, __id__);                                          \
+		uint64_t  __epoch__ = cd_EventEnter(self);                                                  \
 									                                                                \
-		CDList* __callbacks__ = (CDList*) CD_HashGet(self->event.callbacks, eventName);             \
+		if (!(__hooks__ & CDEventHookBefore) ||                                                     \
+		    cd_EventBeforeDispatch(self, __id__, eventName, ##__VA_ARGS__)) {                       \
+			CDEventCallbacks* __callbacks__ = CD_EventCallbacks(self, __id__);                      \
 									                                                                \
-		CD_LIST_FOREACH(__callbacks__, it) {                                                        \
-			if (!CD_ListIteratorValue(it)) {                                                        \
-				continue;                                                                           \
+			for (size_t __i__ = 0; __callbacks__ && __i__ < __callbacks__->length; __i__++) {      \
+				if (!__callbacks__->item[__i__].function(self, ##__VA_ARGS__)) {                    \
+					__interrupted__ = true;                                                         \
+					break;                                                                          \
+				}                                                                                   \
 			}                                                                                       \
 									                                                                \
-			if (!((CDEventCallback*) CD_ListIteratorValue(it))->function(self, ##__VA_ARGS__)) {    \
-				__interrupted__ = !CD_ListStopIterating(__callbacks__, false);                      \
-				break;                                                                              \
+			if (__hooks__ & CDEventHookAfter) {                                                     \
+				cd_EventAfterDispatch(self, __id__, eventName, __interrupted__, ##__VA_ARGS__);     \
 			}                                                                                       \
 		}                                                                                           \
 									                                                                \
-		cd_EventAfterDispatch(self, eventName, __interrupted__, ##__VA_ARGS__);                     \
+		cd_EventLeave(self, __epoch__);                                                             \
 	}
 
 #define CD_EventDispatchWithResult(interrupted, self, eventName, ...)                               \
@@ -100,24 +215,27 @@ bool cd_EventAfterDispatch (CDServer* self, const char* eventName, bool interrup
 									                                                                \
 		interrupted = false;                                                                        \
 									                                                                \
-		if (!cd_EventBeforeDispatch(self, eventName, ##__VA_ARGS__)) {                              \
-			break;                                                                                  \
-		}                                                                                           \
+		CDEventId __id__    = CD_EVENT_ID(eventName);                                               \
+		uint8_t   __hooks__ = CD_EventHooks(self, __id__);                                          \
+		uint64_t  __epoch__ = cd_EventEnter(self);                                                  \
 									                                                                \
-		CDList* __callbacks__ = (CDList*) CD_HashGet(self->event.callbacks, eventName);             \
+		if (!(__hooks__ & CDEventHookBefore) ||                                                     \
+		    cd_EventBeforeDispatch(self, __id__, eventName, ##__VA_ARGS__)) {                       \
+			CDEventCallbacks* __callbacks__ = CD_EventCallbacks(self, __id__);                      \
 									                                                                \
-		CD_LIST_FOREACH(__callbacks__, it) {                                                        \
-			if (!CD_ListIteratorValue(it)) {                                                        \
-				continue;                                                                           \
+			for (size_t __i__ = 0; __callbacks__ && __i__ < __callbacks__->length; __i__++) {      \
+				if (!__callbacks__->item[__i__].function(self, ##__VA_ARGS__)) {                    \
+					interrupted = true;                                                             \
+					break;                                                                          \
+				}                                                                                   \
 			}                                                                                       \
 									                                                                \
-			if (!((CDEventCallback*) CD_ListIteratorValue(it))->function(self, ##__VA_ARGS__)) {    \
-				interrupted = !CD_ListStopIterating(__callbacks__, false);                          \
-				break;                                                                              \
+			if (__hooks__ & CDEventHookAfter) {                                                     \
+				cd_EventAfterDispatch(self, __id__, eventName, interrupted, ##__VA_ARGS__);         \
 			}                                                                                       \
 		}                                                                                           \
 									                                                                \
-		cd_EventAfterDispatch(self, eventName, interrupted, ##__VA_ARGS__);                         \
+		cd_EventLeave(self, __epoch__);                                                             \
 	}
 
 #define CD_EventDispatchWithError(error, self, eventName, ...)                                              \
@@ -128,24 +246,27 @@ bool cd_EventAfterDispatch (CDServer* self, const char* eventName, bool interrup
 		bool __interrupted__ = false;                                                                       \
 			 error           = CDOk;                                                                        \
 									                                                                        \
-		if (!cd_EventBeforeDispatch(self, eventName, ##__VA_ARGS__, &error)) {                              \
-			break;                                                                                          \
-		}                                                                                                   \
+		CDEventId __id__    = CD_EVENT_ID(eventName);                                                       \
+		uint8_t   __hooks__ = CD_EventHooks(self, __id__);                                                  \
+		uint64_t  __epoch__ = cd_EventEnter(self);                                                          \
 									                                                                        \
-		CDList* __callbacks__ = (CDList*) CD_HashGet(self->event.callbacks, eventName);                     \
+		if (!(__hooks__ & CDEventHookBefore) ||                                                             \
+		    cd_EventBeforeDispatch(self, __id__, eventName, ##__VA_ARGS__, &error)) {                       \
+			CDEventCallbacks* __callbacks__ = CD_EventCallbacks(self, __id__);                              \
 									                                                                        \
-		CD_LIST_FOREACH(__callbacks__, it) {                                                                \
-			if (!CD_ListIteratorValue(it)) {                                                                \
-				continue;                                                                                   \
+			for (size_t __i__ = 0; __callbacks__ && __i__ < __callbacks__->length; __i__++) {              \
+				if (!__callbacks__->item[__i__].function(self, ##__VA_ARGS__, &error)) {                    \
+					__interrupted__ = true;                                                                 \
+					break;                                                                                  \
+				}                                                                                           \
 			}                                                                                               \
 									                                                                        \
-			if (!((CDEventCallback*) CD_ListIteratorValue(it))->function(self, ##__VA_ARGS__, &error)) {    \
-				__interrupted__ = !CD_ListStopIterating(__callbacks__, false);                              \
-				break;                                                                                      \
+			if (__hooks__ & CDEventHookAfter) {                                                             \
+				cd_EventAfterDispatch(self, __id__, eventName, __interrupted__, ##__VA_ARGS__, &error);     \
 			}                                                                                               \
 		}                                                                                                   \
 									                                                                        \
-		cd_EventAfterDispatch(self, eventName, __interrupted__, ##__VA_ARGS__, &error);                     \
+		cd_EventLeave(self, __epoch__);                                                                     \
 	}
 
 
@@ -169,13 +290,23 @@ void CD_EventRegister (CDServer* server, const char* eventName, CDEventCallbackF
  */
 void CD_EventRegisterWithPriority (CDServer* server, const char* eventName, int priority, CDEventCallbackFunction callback);
 
+/**
+ * Register a dispatch hook that only runs for some events, registering it with
+ * CD_EventRegister runs it for every event.
+ *
+ * @param hookName Event.dispatch:before or Event.dispatch:after
+ * @param events The names of the events to run for, can be NULL
+ * @param provided Run it for every event given to CD_EventProvides too
+ */
+void CD_EventRegisterHook (CDServer* server, const char* hookName, CDEventCallbackFunction callback, CDList* events, bool provided);
+
 /**
  * Unregister the event with the passed name, unregisters only the passed callback or every callback if NULL.
  *
  * @param callback The callback to unregister or NULL to unregister every callback
  *
- * @return The unregistered callbacks
+ * @return The number of unregistered callbacks
  */
-CDEventCallback** CD_EventUnregister (CDServer* server, const char* eventName, CDEventCallbackFunction callback);
+size_t CD_EventUnregister (CDServer* server, const char* eventName, CDEventCallbackFunction callback);
 
 #endif
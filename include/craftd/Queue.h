@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CRAFTD_QUEUE_H
+#define CRAFTD_QUEUE_H
+
+#include <craftd/common.h>
+
+typedef struct _CDQueueCell {
+	size_t    sequence;
+	CDPointer value;
+} CDQueueCell;
+
+/**
+ * The Queue class, a bounded lock-free multi-producer multi-consumer FIFO.
+ *
+ * Pushes never fail, values that don't fit in the ring go in a locked overflow
+ * list. Consumers can park on the queue until something is pushed.
+ */
+typedef struct _CDQueue {
+	size_t       mask;
+	CDQueueCell* cells;
+
+	/// Producer and consumer positions, kept on different cache lines
+	size_t head __attribute__((aligned(64)));
+	size_t tail __attribute__((aligned(64)));
+
+	struct {
+		/// Bumped on every wake up, parked consumers wait for it to change
+		uint32_t epoch __attribute__((aligned(64)));
+		uint32_t waiters;
+
+		#ifndef __linux__
+		pthread_mutex_t mutex;
+		pthread_cond_t  condition;
+		#endif
+	} park;
+
+	struct {
+		CDList* values;
+		size_t  length;
+	} overflow;
+} CDQueue;
+
+/**
+ * Create a Queue object
+ *
+ * @param size The number of values the ring holds, rounded up to a power of 2
+ *
+ * @return The queue object
+ */
+CDQueue* CD_CreateQueue (size_t size);
+
+/**
+ * Destroy a Queue object, the remaining values are dropped
+ */
+void CD_DestroyQueue (CDQueue* self);
+
+/**
+ * Push a value at the end of the queue and wake up a parked consumer
+ *
+ * @param value The value to push, it can't be CDNull
+ */
+void CD_QueuePush (CDQueue* self, CDPointer value);
+
+/**
+ * Take the value at the start of the queue without waiting
+ *
+ * @return The value or CDNull if the queue is empty
+ */
+CDPointer CD_QueueShift (CDQueue* self);
+
+/**
+ * Take up to length values at the start of the queue without waiting, the
+ * values in the ring are claimed all at once
+ *
+ * @return The number of values put in values
+ */
+size_t CD_QueueShiftMany (CDQueue* self, CDPointer* values, size_t length);
+
+/**
+ * Get the number of values in the queue, it's only a snapshot when there are
+ * concurrent producers or consumers
+ */
+size_t CD_QueueLength (CDQueue* self);
+
+/**
+ * Check if the queue is empty, see CD_QueueLength
+ */
+bool CD_QueueIsEmpty (CDQueue* self);
+
+/**
+ * Park the calling thread until something is pushed or CD_QueueWakeAll is
+ * called, it returns immediately if the queue isn't empty or running is false.
+ *
+ * Clearing running before calling CD_QueueWakeAll can't be missed, even by a
+ * consumer that checked it right before parking. A consumer woken after its
+ * running was cleared passes the wake up on if the queue isn't empty.
+ *
+ * Spurious wake ups are possible.
+ *
+ * @param running The flag the consumer runs on, can be NULL
+ */
+void CD_QueueWait (CDQueue* self, bool* running);
+
+/**
+ * Wake up all the parked consumers
+ */
+void CD_QueueWakeAll (CDQueue* self);
+
+#endif
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CRAFTD_REACTOR_H
+#define CRAFTD_REACTOR_H
+
+#include <craftd/common.h>
+
+struct _CDServer;
+struct _CDClient;
+
+/**
+ * The Reactor class, an I/O thread with its own event base.
+ *
+ * Every Client is pinned to one Reactor for its whole life, its bufferevent
+ * callbacks run and its disconnection is cleaned up on the Reactor's thread.
+ */
+typedef struct _CDReactor {
+	struct _CDServer* server;
+
+	size_t id;
+
+	pthread_t      thread;
+	pthread_attr_t attributes;
+
+	bool running;
+
+	/// Clients whose disconnection job is done, destroyed by the Reactor
+	CDList* disconnecting;
+
+	/// Only used when the Reactor accepts on its own SO_REUSEPORT socket
+	evutil_socket_t socket;
+
+	struct {
+		struct event_base* base;
+		struct event*      listener;
+		struct event*      alive;
+		struct event*      report;
+	} event;
+
+	/// Output counters, only touched on the Reactor's thread, the difference
+	/// from the reported values is logged every minute
+	struct {
+		uint64_t flushes;
+		uint64_t writes;
+		uint64_t bytes;
+		uint64_t deferred;
+
+		struct {
+			uint64_t flushes;
+			uint64_t writes;
+			uint64_t bytes;
+			uint64_t deferred;
+		} reported;
+	} statistics;
+} CDReactor;
+
+/**
+ * Create a Reactor object for the given server.
+ *
+ * @param server The Server the Reactor will run on
+ * @param id The index of the Reactor
+ *
+ * @return The instantiated Reactor object
+ */
+CDReactor* CD_CreateReactor (struct _CDServer* server, size_t id);
+
+/**
+ * Destroy a Reactor object, it has to be stopped already.
+ */
+void CD_DestroyReactor (CDReactor* self);
+
+/**
+ * Run the Reactor's event loop, this is the body of the Reactor's thread.
+ */
+void* CD_RunReactor (CDReactor* self);
+
+/**
+ * Start the Reactor's thread.
+ *
+ * @return true if the thread has been started
+ */
+bool CD_StartReactor (CDReactor* self);
+
+/**
+ * Stop the Reactor and wait for its thread to end.
+ */
+void CD_StopReactor (CDReactor* self);
+
+/**
+ * Wake up the Reactor so it cleans up disconnected Clients.
+ *
+ * @param now Break out of the current loop right away instead of after the
+ *            pending callbacks ran
+ */
+void CD_ReactorFlush (CDReactor* self, bool now);
+
+/**
+ * Hand a Client whose disconnection job is done to its Reactor, which will
+ * destroy it on its own thread.
+ */
+void CD_ReactorDisconnect (CDReactor* self, struct _CDClient* client);
+
+/**
+ * Destroy the Clients handed over with CD_ReactorDisconnect, it has to be
+ * called on the Reactor's thread.
+ */
+void CD_ReactorCleanDisconnects (CDReactor* self);
+
+#endif
@@ -30,11 +30,17 @@
 #include <craftd/Logger.h>
 #include <craftd/TimeLoop.h>
 #include <craftd/Workers.h>
+#include <craftd/Reactor.h>
 #include <craftd/Protocol.h>
 #include <craftd/Plugins.h>
 #include <craftd/ScriptingEngines.h>
 #include <craftd/Client.h>
 
+/// Most distinct event names, see CD_EventId
+#define CD_EVENTS_MAX 1024
+
+struct _CDEventCallbacks;
+
 /**
  * Server class.
  */
@@ -49,21 +55,61 @@ typedef struct _CDServer {
 	CDScriptingEngines* scriptingEngines;
 	CDLogger            logger;
 
-	CDList* clients;
-	CDList* disconnecting;
+	/// The connected Clients, guarded by the Vector's lock
+	CDVector* clients;
+
+	struct {
+		CDReactor** item;
+		size_t      length;
+
+		/// Round-robin counter used to hand accepted sockets to the reactors
+		size_t next;
+	} reactors;
 
 	bool running;
 
 	uint16_t time;
 
+	/// The main event base only accepts and handles signals, the clients run
+	/// on the reactors
 	struct {
 		struct event_base* base;
 		struct event*      listener;
 
-		CDHash* callbacks;
+		/// The callbacks of every event indexed by CDEventId, an entry is
+		/// replaced as a whole when it changes so dispatching never locks
+		struct _CDEventCallbacks* callbacks[CD_EVENTS_MAX];
+
+		/// Replaced entries and filters, a dispatch could still be walking
+		/// them. Every dispatch counts itself in the readers of the epoch it
+		/// started in, and what was retired during an epoch is freed once the
+		/// readers of that epoch are gone, see cd_EventReclaim
+		struct {
+			uint64_t epoch;
+			size_t   readers[2];
+
+			/// Retired during the previous and the current epoch
+			CDList* previous;
+			CDList* current;
+		} retired;
+
+		/// CDEventHook bits of the dispatch hooks to run, all is for the ones
+		/// without a filter, events for the filtered ones indexed by CDEventId
+		struct {
+			uint8_t all;
+			uint8_t events[CD_EVENTS_MAX];
+
+			/// Bit set of the events given to CD_EventProvides
+			uint64_t provided[CD_EVENTS_MAX / 64];
+		} hooks;
+
 		CDHash* provided;
 	} event;
 
+	struct {
+		pthread_mutex_t events;
+	} lock;
+
 	evutil_socket_t socket;
 
 	CD_DEFINE_DYNAMIC;
@@ -100,12 +146,27 @@ bool CD_RunServer (CDServer* self);
 
 bool CD_StopServer (CDServer* self);
 
+/**
+ * Wake up the main event base and every reactor.
+ *
+ * @param now Break out of the current loops right away
+ */
 void CD_ServerFlush (CDServer* self, bool now);
 
-void CD_ServerCleanDisconnects (CDServer* self);
-
 void CD_ReadFromClient (CDClient* client);
 
+/**
+ * Parse the next packet of a client whose lane is running, every client has
+ * at most one lane running its packets in order. A lane runs at most
+ * CD_WORKERS_LANE packets before its job is queued again.
+ *
+ * When there's no complete packet the lane ends, the client goes back to
+ * idle and its job is released with CD_ClientReleaseJob.
+ *
+ * @return The packet or NULL if the lane is over
+ */
+void* CD_ClientNextPacket (CDClient* client);
+
 #ifndef CRAFTD_SERVER_IGNORE_EXTERN
 extern CDServer* CDMainServer;
 #endif
@@ -13,16 +13,17 @@
 
 #include <craftd/common.h>
 
-typedef struct _CDSetMember {
-	struct _CDSetMember* next;
-	CDPointer            value;
-} CDSetMember;
-
 struct _CDSet;
 
-typedef bool         (*CDSetCompare) (struct _CDSet* self, CDPointer a, CDPointer b);
-typedef unsigned int (*CDSetHash)    (struct _CDSet* self, CDPointer pointer);
+typedef bool     (*CDSetCompare) (struct _CDSet* self, CDPointer a, CDPointer b);
+typedef uint64_t (*CDSetHash)    (struct _CDSet* self, CDPointer pointer);
 
+/**
+ * The Set class, an open addressing hash table with linear probing.
+ *
+ * The values are stored in the slots themselves, CDNull marks an empty slot so
+ * it can't be a member. The table doubles when it's 3/4 full.
+ */
 typedef struct _CDSet {
 	size_t       length;
 	unsigned int timestamp;
@@ -30,11 +31,29 @@ typedef struct _CDSet {
 	CDSetCompare cmp;
 	CDSetHash    hash;
 
+	/// Number of slots, always a power of 2
 	size_t size;
 
-	CDSetMember** buckets;
+	CDPointer* values;
 } CDSet;
 
+/**
+ * Mix the bits of a 64 bit value so every bit of the input affects the low
+ * bits of the output, which are the ones picking the slot
+ */
+static inline
+uint64_t
+CD_SetMix (uint64_t value)
+{
+	value ^= value >> 33;
+	value *= 0xff51afd7ed558ccdULL;
+	value ^= value >> 33;
+	value *= 0xc4ceb9fe1a85ec53ULL;
+	value ^= value >> 33;
+
+	return value;
+}
+
 typedef void (*CDSetApply) (CDSet* self, CDPointer value, CDPointer context);
 
 CDSet* CD_CreateSet (void);
@@ -42,7 +61,8 @@ CDSet* CD_CreateSet (void);
 /**
  * Allocate and create a new Set
  *
- * @param hint a hint at the number of values the set may hold
+ * @param hint a hint at the number of values the set may hold, it grows past it
+ *             when needed
  * @param cmp a comparison function for two members
  * @param hash a hash function for the member
  *
@@ -38,8 +38,14 @@ typedef bstring CDRawString;
  */
 typedef struct _CDString {
 	CDRawString raw;
-	size_t      length;
-	bool        external;
+
+	/// Number of characters
+	size_t length;
+
+	/// Every byte is ASCII, characters can be indexed as bytes
+	bool ascii;
+
+	bool external;
 } CDString;
 
 /**
@@ -224,6 +230,12 @@ size_t CD_UTF8_strnlen (const char* data, size_t limit);
 
 size_t CD_UTF8_offset (const char* data, size_t offset);
 
+/**
+ * Check if a buffer is well formed UTF-8, overlong forms, surrogates and code
+ * points past U+10FFFF are rejected
+ */
+bool CD_UTF8_valid (const char* data, size_t size);
+
 CDString* CD_StringDirname (CDString* self);
 
 CDString* CD_StringBasename (CDString* self);
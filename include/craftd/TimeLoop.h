@@ -31,8 +31,49 @@
 
 struct _CDServer;
 
+/// Milliseconds covered by a slot of the wheel, timers fire with this precision
+#define CD_TIMELOOP_RESOLUTION 10
+
+/// Bits of the slot index of each level of the wheel
+#define CD_TIMELOOP_BITS 6
+
+/// Levels of the wheel, with 10ms slots they cover about 46 hours, timers
+/// further away are cascaded from the last level until they fit
+#define CD_TIMELOOP_LEVELS 4
+
+#define CD_TIMELOOP_SLOTS (1 << CD_TIMELOOP_BITS)
+
+/**
+ * A timeout or an interval, it lives in a slot of the wheel until it expires.
+ */
+typedef struct _CDTimer {
+	int id;
+
+	/// Wheel tick at which the timer fires
+	uint64_t expires;
+
+	/// Ticks between the runs of an interval, 0 for a timeout
+	uint64_t interval;
+
+	/// Set when it's cleared while out of the wheel to run, the TimeLoop
+	/// frees it after the run instead of scheduling it again
+	bool cancelled;
+
+	event_callback_fn callback;
+	CDPointer         data;
+
+	struct _CDTimer*  next;
+
+	/// The pointer pointing to this timer, NULL when it's not in the wheel
+	struct _CDTimer** previous;
+} CDTimer;
+
 /**
  * The TimeLoop class.
+ *
+ * Timeouts and intervals are kept in a hierarchical timing wheel driven by
+ * a single libevent timer, so adding and clearing them is O(1) and everything
+ * expiring in the same slot is run in one batch.
  */
 typedef struct _CDTimeLoop {
 	struct _CDServer* server;
@@ -45,12 +86,23 @@ typedef struct _CDTimeLoop {
 	int    last;
 	CDMap* callbacks;
 
+	struct {
+		/// Monotonic time of tick 0, in nanoseconds
+		uint64_t start;
+
+		/// Last tick run
+		uint64_t now;
+
+		CDTimer* slots[CD_TIMELOOP_LEVELS][CD_TIMELOOP_SLOTS];
+	} wheel;
+
 	struct {
 		struct event_base* base;
+		struct event*      tick;
 	} event;
 
 	struct {
-		pthread_spinlock_t last;
+		pthread_spinlock_t wheel;
 	} lock;
 } CDTimeLoop;
 
@@ -76,7 +128,18 @@ bool CD_RunTimeLoop (CDTimeLoop* self);
 bool CD_StopTimeLoop (CDTimeLoop* self);
 
 /**
- * Create an event that will run after the given seconds and delete itself after that
+ * Run the wheel up to the given tick, the expired timers are taken out under
+ * the lock and run in one batch without it, so callbacks can add and clear
+ * timers.
+ *
+ * The TimeLoop calls it every CD_TIMELOOP_RESOLUTION milliseconds with the
+ * current tick, calling it directly runs the wheel without waiting.
+ */
+void CD_TimeLoopAdvance (CDTimeLoop* self, uint64_t tick);
+
+/**
+ * Create an event that will run after the given seconds and delete itself after that,
+ * it can be called from any thread and the callback runs on the TimeLoop thread
  *
  * @param seconds The seconds after which the event will be fired
  * @param callback The callback to call after the given time
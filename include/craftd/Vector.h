@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CRAFTD_VECTOR_H
+#define CRAFTD_VECTOR_H
+
+#include <craftd/common.h>
+
+/**
+ * The Vector class, a growable array of values.
+ *
+ * Unlike List it doesn't lock by itself, a Vector shared between threads has
+ * to be wrapped in CD_VectorReadLock/CD_VectorWriteLock and CD_VectorUnlock.
+ */
+typedef struct _CDVector {
+	CDPointer* item;
+	size_t     length;
+	size_t     size;
+
+	pthread_rwlock_t lock;
+} CDVector;
+
+/**
+ * Create a Vector object
+ *
+ * @return The vector object
+ */
+CDVector* CD_CreateVector (void);
+
+/**
+ * Shallow clone a Vector object
+ *
+ * @return The cloned Vector
+ */
+CDVector* CD_CloneVector (CDVector* self);
+
+/**
+ * Destroy a Vector object, the values are not touched
+ */
+void CD_DestroyVector (CDVector* self);
+
+static inline
+void
+CD_VectorReadLock (CDVector* self)
+{
+	pthread_rwlock_rdlock(&self->lock);
+}
+
+static inline
+void
+CD_VectorWriteLock (CDVector* self)
+{
+	pthread_rwlock_wrlock(&self->lock);
+}
+
+static inline
+void
+CD_VectorUnlock (CDVector* self)
+{
+	pthread_rwlock_unlock(&self->lock);
+}
+
+/**
+ * Get the number of values in the Vector
+ */
+static inline
+size_t
+CD_VectorLength (CDVector* self)
+{
+	return self->length;
+}
+
+/**
+ * Get the value at the given index, it must be lower than the length
+ */
+static inline
+CDPointer
+CD_VectorGet (CDVector* self, size_t index)
+{
+	assert(index < self->length);
+
+	return self->item[index];
+}
+
+/**
+ * Make room for at least size values
+ */
+void CD_VectorReserve (CDVector* self, size_t size);
+
+/**
+ * Push a value at the end of the Vector
+ *
+ * @return self
+ */
+CDVector* CD_VectorPush (CDVector* self, CDPointer value);
+
+/**
+ * Take the value at the end of the Vector
+ *
+ * @return The value or CDNull if the Vector is empty
+ */
+CDPointer CD_VectorPop (CDVector* self);
+
+/**
+ * Get the index of the first value matching the passed one
+ *
+ * @return The index or -1 if it's not there
+ */
+ssize_t CD_VectorIndexOf (CDVector* self, CDPointer value);
+
+bool CD_VectorContains (CDVector* self, CDPointer value);
+
+/**
+ * Delete the value at the given index keeping the order of the others
+ *
+ * @return The removed value
+ */
+CDPointer CD_VectorDeleteAt (CDVector* self, size_t index);
+
+/**
+ * Delete the first value matching the passed one, the last value takes its
+ * place so the order isn't kept
+ *
+ * @return The removed value or CDNull if it's not there
+ */
+CDPointer CD_VectorDelete (CDVector* self, CDPointer value);
+
+/**
+ * Delete every value matching the passed one
+ *
+ * @return The number of removed values
+ */
+size_t CD_VectorDeleteAll (CDVector* self, CDPointer value);
+
+/**
+ * Remove every value, the memory is kept for reuse
+ */
+void CD_VectorClear (CDVector* self);
+
+/**
+ * Iterate over the indices of a Vector, use CD_VectorGet to get the values.
+ *
+ * The Vector must not be changed while iterating.
+ */
+#define CD_VECTOR_FOREACH(self, index) \
+	for (size_t index = 0; (self) && index < (self)->length; index++)
+
+#endif
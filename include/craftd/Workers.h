@@ -27,10 +27,20 @@
 #define CRAFTD_WORKERS_H
 
 #include <craftd/common.h>
+#include <craftd/Queue.h>
 #include <craftd/Worker.h>
 
 #define CD_THREAD_STACK 8388608
 
+/// Jobs the queue holds before spilling into its overflow list
+#define CD_WORKERS_QUEUE 4096
+
+/// Most jobs a worker takes from the queue at once
+#define CD_WORKERS_BATCH 16
+
+/// Most packets a client's lane runs before going back in the queue
+#define CD_WORKERS_LANE 32
+
 struct _CDServer;
 
 typedef struct _CDWorkers {
@@ -41,14 +51,9 @@ typedef struct _CDWorkers {
 	size_t     length;
 	CDWorker** item;
 
-	CDList* jobs;
+	CDQueue* jobs;
 
 	pthread_attr_t attributes;
-
-	struct {
-		pthread_cond_t  condition;
-		pthread_mutex_t mutex;
-	} lock;
 } CDWorkers;
 
 CDWorkers* CD_CreateWorkers (struct _CDServer* server);
@@ -73,4 +78,17 @@ void CD_AddJob (CDWorkers* self, CDJob* job);
 
 CDJob* CD_NextJob (CDWorkers* self);
 
+/**
+ * Take a batch of jobs, the batch is smaller when there are few jobs for each
+ * worker so they're spread on the pool
+ *
+ * @return The number of jobs put in jobs, at most CD_WORKERS_BATCH
+ */
+size_t CD_NextJobs (CDWorkers* self, CDJob** jobs);
+
+/**
+ * Park the calling worker until a job is added or the worker is stopped
+ */
+void CD_WaitJobs (CDWorkers* self, CDWorker* worker);
+
 #endif
@@ -89,6 +89,7 @@
 #include <craftd/Map.h>
 #include <craftd/Hash.h>
 #include <craftd/Set.h>
+#include <craftd/Vector.h>
 #include <craftd/String.h>
 #include <craftd/Regexp.h>
 #include <craftd/Dynamic.h>
@@ -0,0 +1,329 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CRAFTD_SURVIVAL_CODEC_H
+#define CRAFTD_SURVIVAL_CODEC_H
+
+#include <craftd/protocols/survival/minecraft.h>
+
+/**
+ * Primitives the generated packet codec is made of.
+ *
+ * Writers take a cursor into a region that has already been sized for the
+ * whole packet and return the advanced cursor, readers pull from a flat span
+ * and set the error flag instead of ever reading past its end.
+ */
+
+typedef struct _SVReader {
+	const uint8_t* data;
+	size_t         length;
+	size_t         offset;
+
+	bool error;
+} SVReader;
+
+static inline
+const uint8_t*
+SV_ReaderTake (SVReader* self, size_t size)
+{
+	const uint8_t* result;
+
+	if (self->error || self->length - self->offset < size) {
+		self->error = true;
+
+		return NULL;
+	}
+
+	result        = self->data + self->offset;
+	self->offset += size;
+
+	return result;
+}
+
+static inline
+size_t
+SV_ReaderLeft (SVReader* self)
+{
+	return self->length - self->offset;
+}
+
+static inline
+SVByte
+SV_ReadByte (SVReader* self)
+{
+	const uint8_t* data = SV_ReaderTake(self, SVByteSize);
+
+	return data ? (SVByte) data[0] : 0;
+}
+
+static inline
+SVBoolean
+SV_ReadBoolean (SVReader* self)
+{
+	const uint8_t* data = SV_ReaderTake(self, SVBooleanSize);
+
+	return data ? (SVBoolean) data[0] : false;
+}
+
+static inline
+SVShort
+SV_ReadShort (SVReader* self)
+{
+	const uint8_t* data   = SV_ReaderTake(self, SVShortSize);
+	SVShort        result = 0;
+
+	if (data) {
+		memcpy(&result, data, SVShortSize);
+	}
+
+	return ntohs(result);
+}
+
+static inline
+SVInteger
+SV_ReadInteger (SVReader* self)
+{
+	const uint8_t* data   = SV_ReaderTake(self, SVIntegerSize);
+	SVInteger      result = 0;
+
+	if (data) {
+		memcpy(&result, data, SVIntegerSize);
+	}
+
+	return ntohl(result);
+}
+
+static inline
+SVLong
+SV_ReadLong (SVReader* self)
+{
+	const uint8_t* data   = SV_ReaderTake(self, SVLongSize);
+	SVLong         result = 0;
+
+	if (data) {
+		memcpy(&result, data, SVLongSize);
+	}
+
+	return ntohll(result);
+}
+
+static inline
+SVFloat
+SV_ReadFloat (SVReader* self)
+{
+	const uint8_t* data   = SV_ReaderTake(self, SVFloatSize);
+	SVFloat        result = 0;
+
+	if (data) {
+		memcpy(&result, data, SVFloatSize);
+	}
+
+	return ntohf(result);
+}
+
+static inline
+SVDouble
+SV_ReadDouble (SVReader* self)
+{
+	const uint8_t* data   = SV_ReaderTake(self, SVDoubleSize);
+	SVDouble       result = 0;
+
+	if (data) {
+		memcpy(&result, data, SVDoubleSize);
+	}
+
+	return ntohd(result);
+}
+
+/**
+ * Copy a raw array out of the span, a zero sized array is NULL.
+ */
+static inline
+void*
+SV_ReadBytes (SVReader* self, size_t size)
+{
+	const uint8_t* data = SV_ReaderTake(self, size);
+	void*          result;
+
+	if (!data || size == 0) {
+		return NULL;
+	}
+
+	result = CD_malloc(size);
+
+	memcpy(result, data, size);
+
+	return result;
+}
+
+/**
+ * Read an inventory slot, the count and uses are only on the wire when the id
+ * isn't -1.
+ */
+static inline
+SVItem
+SV_ReadItem (SVReader* self)
+{
+	SVItem result = { .id = SV_ReadShort(self) };
+
+	if (result.id != -1) {
+		result.count = SV_ReadByte(self);
+		result.uses  = SV_ReadShort(self);
+	}
+
+	return result;
+}
+
+SVString SV_ReadString (SVReader* self);
+
+SVString SV_ReadString16 (SVReader* self);
+
+SVMetadata* SV_ReadMetadata (SVReader* self);
+
+static inline
+uint8_t*
+SV_WriteByte (uint8_t* cursor, SVByte data)
+{
+	*cursor = (uint8_t) data;
+
+	return cursor + SVByteSize;
+}
+
+static inline
+uint8_t*
+SV_WriteBoolean (uint8_t* cursor, SVBoolean data)
+{
+	*cursor = (uint8_t) data;
+
+	return cursor + SVBooleanSize;
+}
+
+static inline
+uint8_t*
+SV_WriteShort (uint8_t* cursor, SVShort data)
+{
+	data = htons(data);
+
+	memcpy(cursor, &data, SVShortSize);
+
+	return cursor + SVShortSize;
+}
+
+static inline
+uint8_t*
+SV_WriteInteger (uint8_t* cursor, SVInteger data)
+{
+	data = htonl(data);
+
+	memcpy(cursor, &data, SVIntegerSize);
+
+	return cursor + SVIntegerSize;
+}
+
+static inline
+uint8_t*
+SV_WriteLong (uint8_t* cursor, SVLong data)
+{
+	data = htonll(data);
+
+	memcpy(cursor, &data, SVLongSize);
+
+	return cursor + SVLongSize;
+}
+
+static inline
+uint8_t*
+SV_WriteFloat (uint8_t* cursor, SVFloat data)
+{
+	data = htonf(data);
+
+	memcpy(cursor, &data, SVFloatSize);
+
+	return cursor + SVFloatSize;
+}
+
+static inline
+uint8_t*
+SV_WriteDouble (uint8_t* cursor, SVDouble data)
+{
+	data = htond(data);
+
+	memcpy(cursor, &data, SVDoubleSize);
+
+	return cursor + SVDoubleSize;
+}
+
+static inline
+uint8_t*
+SV_WriteBytes (uint8_t* cursor, const void* data, size_t size)
+{
+	if (size > 0) {
+		memcpy(cursor, data, size);
+	}
+
+	return cursor + size;
+}
+
+static inline
+uint8_t*
+SV_WriteItem (uint8_t* cursor, SVItem item)
+{
+	cursor = SV_WriteShort(cursor, item.id);
+
+	if (item.id != -1) {
+		cursor = SV_WriteByte(cursor, item.count);
+		cursor = SV_WriteShort(cursor, item.uses);
+	}
+
+	return cursor;
+}
+
+uint8_t* SV_WriteString (uint8_t* cursor, SVString data);
+
+uint8_t* SV_WriteString16 (uint8_t* cursor, SVString data);
+
+uint8_t* SV_WriteMetadata (uint8_t* cursor, SVMetadata* data);
+
+/**
+ * Upper bounds of the wire size of the variable fields, sanitizing a String
+ * never makes it bigger and no character takes more UCS-2 units than bytes.
+ */
+static inline
+size_t
+SV_StringBound (SVString data)
+{
+	return SVShortSize + CD_StringSize(data);
+}
+
+static inline
+size_t
+SV_String16Bound (SVString data)
+{
+	return SVShortSize + CD_StringSize(data) * 2;
+}
+
+size_t SV_MetadataBound (SVMetadata* data);
+
+#endif
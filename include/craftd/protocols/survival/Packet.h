@@ -887,7 +887,7 @@ typedef union _SVPacketItemData {
 	struct {
 		SVShort itemType;
 		SVShort itemId;
-		SVByte textLength; //This is unsigned!
+		uint8_t textLength;
 		SVByte* text;
 	} response;
 } SVPacketItemData;
@@ -965,4 +965,11 @@ CDPointer SV_GetPacketDataFromBuffer (SVPacket* self, CDBuffer* input);
  */
 CDBuffer* SV_PacketToBuffer (SVPacket* self);
 
+/**
+ * Serialize the packet once to send it to many clients, see CD_ClientSendShared
+ *
+ * @return The raw packet data, release it with CD_ReleaseSharedBuffer
+ */
+CDSharedBuffer* SV_PacketToSharedBuffer (SVPacket* self);
+
 #endif
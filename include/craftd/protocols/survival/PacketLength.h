@@ -31,6 +31,10 @@
 /**
  * Check if the buffer has enough/right data to parse a Packet
  *
+ * Only the fields giving the size of the packet are looked at, and the
+ * progress is kept in the buffers' frame so a packet arriving in many reads
+ * isn't walked again from the start each time.
+ *
  * @param input The buffer to read from
  *
  * @return true if parsable, false otherwise, errno is set with the following possible values:
@@ -40,9 +44,14 @@
  */
 bool SV_PacketParsable (CDBuffers* buffers);
 
+/**
+ * Get the length of the packet SV_PacketParsable validated
+ */
+size_t SV_PacketFrameLength (CDBuffers* buffers);
+
 static const size_t SVPacketLength[] = {
 /* 0x00 */  5,      // Keep Alive
-/* 0x01 */  22,     // Login
+/* 0x01 */  23,     // Login
 /* 0x02 */  3,      // Handshake
 /* 0x03 */  3,      // Chat
 /* 0x04 */  9,      // Time Update
@@ -0,0 +1,521 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Wire layout of every survival packet, included by the codec once per pass
+ * with the macros below defined to generate the size bound, the encoder, the
+ * decoder and the release of each packet, so a protocol change is an edit
+ * here and nowhere else.
+ *
+ * SV_REQUEST/SV_RESPONSE/SV_PING(type, structure, fields) declare the layout
+ * of a packet in that chain, the fields follow each other without commas and
+ * name members of the structure.
+ *
+ *     SV_BYTE, SV_SHORT, SV_INTEGER, SV_LONG, SV_FLOAT, SV_DOUBLE, SV_BOOLEAN
+ *     SV_STRING:   UTF-8 with a short byte size
+ *     SV_STRING16: UCS-2 with a short character count
+ *     SV_METADATA: entity metadata terminated by 127
+ *     SV_SIZE:     byte holding the size minus one
+ *     SV_ITEM:     slot, count and uses only follow when the id isn't -1
+ *
+ *     SV_ITEMS(member, count):       count slots
+ *     SV_ARRAY(member, type, count): count raw elements of type
+ *     SV_IF(condition, fields):      fields only on the wire when condition holds
+ *
+ * The type byte isn't part of the fields, and there's no include guard on
+ * purpose.
+ */
+
+SV_REQUEST(SVKeepAlive, SVPacketKeepAlive,
+	SV_INTEGER(keepAliveID))
+
+SV_REQUEST(SVLogin, SVPacketLogin,
+	SV_INTEGER(request.version)
+	SV_STRING16(request.username)
+	SV_LONG(request.u1)
+	SV_INTEGER(request.u2)
+	SV_BYTE(request.u3)
+	SV_BYTE(request.u4)
+	SV_BYTE(request.u5)
+	SV_BYTE(request.u6))
+
+SV_REQUEST(SVHandshake, SVPacketHandshake,
+	SV_STRING16(request.username))
+
+SV_REQUEST(SVChat, SVPacketChat,
+	SV_STRING16(request.message))
+
+SV_REQUEST(SVUseEntity, SVPacketUseEntity,
+	SV_INTEGER(request.user)
+	SV_INTEGER(request.target)
+	SV_BYTE(request.leftClick))
+
+SV_REQUEST(SVRespawn, SVPacketRespawn,
+	SV_BYTE(request.world)
+	SV_BYTE(request.u1)
+	SV_BYTE(request.mode)
+	SV_SHORT(request.worldHeight)
+	SV_LONG(request.mapSeed))
+
+SV_REQUEST(SVOnGround, SVPacketOnGround,
+	SV_BOOLEAN(request.onGround))
+
+SV_REQUEST(SVPlayerPosition, SVPacketPlayerPosition,
+	SV_DOUBLE(request.position.x)
+	SV_DOUBLE(request.position.y)
+	SV_DOUBLE(request.stance)
+	SV_DOUBLE(request.position.z)
+	SV_BYTE(request.is.onGround))
+
+SV_REQUEST(SVPlayerLook, SVPacketPlayerLook,
+	SV_FLOAT(request.yaw)
+	SV_FLOAT(request.pitch)
+	SV_BYTE(request.is.onGround))
+
+SV_REQUEST(SVPlayerMoveLook, SVPacketPlayerMoveLook,
+	SV_DOUBLE(request.position.x)
+	SV_DOUBLE(request.stance)
+	SV_DOUBLE(request.position.y)
+	SV_DOUBLE(request.position.z)
+	SV_FLOAT(request.yaw)
+	SV_FLOAT(request.pitch)
+	SV_BYTE(request.is.onGround))
+
+SV_REQUEST(SVPlayerDigging, SVPacketPlayerDigging,
+	SV_BYTE(request.status)
+	SV_INTEGER(request.position.x)
+	SV_BYTE(request.position.y)
+	SV_INTEGER(request.position.z)
+	SV_BYTE(request.face))
+
+SV_REQUEST(SVPlayerBlockPlacement, SVPacketPlayerBlockPlacement,
+	SV_INTEGER(request.position.x)
+	SV_BYTE(request.position.y)
+	SV_INTEGER(request.position.z)
+	SV_BYTE(request.direction)
+	SV_ITEM(request.item))
+
+SV_REQUEST(SVHoldChange, SVPacketHoldChange,
+	SV_SHORT(request.slot))
+
+SV_REQUEST(SVAnimation, SVPacketAnimation,
+	SV_INTEGER(request.entity.id)
+	SV_BYTE(request.type))
+
+SV_REQUEST(SVEntityAction, SVPacketEntityAction,
+	SV_INTEGER(request.entity.id)
+	SV_BYTE(request.type))
+
+SV_REQUEST(SVStanceUpdate, SVPacketStanceUpdate,
+	SV_FLOAT(request.u1)
+	SV_FLOAT(request.u2)
+	SV_FLOAT(request.u3)
+	SV_FLOAT(request.u4)
+	SV_BOOLEAN(request.u5)
+	SV_BOOLEAN(request.u6))
+
+SV_REQUEST(SVEntityMetadata, SVPacketEntityMetadata,
+	SV_INTEGER(request.entity.id)
+	SV_METADATA(request.metadata))
+
+SV_REQUEST(SVEntityEffect, SVPacketEntityEffect,
+	SV_INTEGER(request.entity.id)
+	SV_BYTE(request.effect)
+	SV_BYTE(request.amplifier)
+	SV_SHORT(request.duration))
+
+SV_REQUEST(SVRemoveEntityEffect, SVPacketRemoveEntityEffect,
+	SV_INTEGER(request.entity.id)
+	SV_BYTE(request.effect))
+
+SV_REQUEST(SVCloseWindow, SVPacketCloseWindow,
+	SV_BYTE(request.id))
+
+SV_REQUEST(SVWindowClick, SVPacketWindowClick,
+	SV_BYTE(request.id)
+	SV_SHORT(request.slot)
+	SV_BOOLEAN(request.rightClick)
+	SV_SHORT(request.action)
+	SV_BOOLEAN(request.shiftPressed)
+	SV_ITEM(request.item))
+
+SV_REQUEST(SVTransaction, SVPacketTransaction,
+	SV_BYTE(request.id)
+	SV_SHORT(request.action)
+	SV_BOOLEAN(request.accepted))
+
+SV_REQUEST(SVCreativeInventoryAction, SVPacketCreativeInventoryAction,
+	SV_SHORT(request.slot)
+	SV_SHORT(request.itemId)
+	SV_SHORT(request.quantity)
+	SV_SHORT(request.damage))
+
+SV_REQUEST(SVUpdateSign, SVPacketUpdateSign,
+	SV_INTEGER(request.position.x)
+	SV_SHORT(request.position.y)
+	SV_INTEGER(request.position.z)
+	SV_STRING16(request.first)
+	SV_STRING16(request.second)
+	SV_STRING16(request.third)
+	SV_STRING16(request.fourth))
+
+SV_REQUEST(SVIncrementStatistic, SVPacketIncrementStatistic,
+	SV_INTEGER(request.id)
+	SV_BYTE(request.amount))
+
+SV_REQUEST(SVListPing, SVPacketListPing, )
+
+SV_REQUEST(SVDisconnect, SVPacketDisconnect,
+	SV_STRING16(request.reason))
+
+SV_PING(SVDisconnect, SVPacketDisconnect,
+	SV_STRING16(ping.description))
+
+SV_RESPONSE(SVKeepAlive, SVPacketKeepAlive,
+	SV_INTEGER(keepAliveID))
+
+SV_RESPONSE(SVLogin, SVPacketLogin,
+	SV_INTEGER(response.id)
+	SV_STRING16(response.u1)
+	SV_LONG(response.mapSeed)
+	SV_INTEGER(response.serverMode)
+	SV_BYTE(response.dimension)
+	SV_BYTE(response.u2)
+	SV_BYTE(response.worldHeight)
+	SV_BYTE(response.maxPlayers))
+
+SV_RESPONSE(SVHandshake, SVPacketHandshake,
+	SV_STRING16(response.hash))
+
+SV_RESPONSE(SVChat, SVPacketChat,
+	SV_STRING16(response.message))
+
+SV_RESPONSE(SVTimeUpdate, SVPacketTimeUpdate,
+	SV_LONG(response.time))
+
+SV_RESPONSE(SVEntityEquipment, SVPacketEntityEquipment,
+	SV_INTEGER(response.entity.id)
+	SV_SHORT(response.slot)
+	SV_SHORT(response.item)
+	SV_SHORT(response.damage))
+
+SV_RESPONSE(SVSpawnPosition, SVPacketSpawnPosition,
+	SV_INTEGER(response.position.x)
+	SV_INTEGER(response.position.y)
+	SV_INTEGER(response.position.z))
+
+SV_RESPONSE(SVUpdateHealth, SVPacketUpdateHealth,
+	SV_SHORT(response.health)
+	SV_SHORT(response.food)
+	SV_FLOAT(response.foodSaturation))
+
+SV_RESPONSE(SVRespawn, SVPacketRespawn,
+	SV_BYTE(response.world)
+	SV_BYTE(response.u1)
+	SV_BYTE(response.mode)
+	SV_SHORT(response.worldHeight)
+	SV_LONG(response.mapSeed))
+
+SV_RESPONSE(SVPlayerMoveLook, SVPacketPlayerMoveLook,
+	SV_DOUBLE(response.position.x)
+	SV_DOUBLE(response.position.y)
+	SV_DOUBLE(response.stance)
+	SV_DOUBLE(response.position.z)
+	SV_FLOAT(response.yaw)
+	SV_FLOAT(response.pitch)
+	SV_BOOLEAN(response.is.onGround))
+
+SV_RESPONSE(SVUseBed, SVPacketUseBed,
+	SV_INTEGER(response.entity.id)
+	SV_BYTE(response.inBed)
+	SV_INTEGER(response.position.x)
+	SV_BYTE(response.position.y)
+	SV_INTEGER(response.position.z))
+
+SV_RESPONSE(SVAnimation, SVPacketAnimation,
+	SV_INTEGER(response.entity.id)
+	SV_BYTE(response.type))
+
+SV_RESPONSE(SVNamedEntitySpawn, SVPacketNamedEntitySpawn,
+	SV_INTEGER(response.entity.id)
+	SV_STRING16(response.name)
+	SV_INTEGER(response.position.x)
+	SV_INTEGER(response.position.y)
+	SV_INTEGER(response.position.z)
+	SV_BYTE(response.rotation)
+	SV_BYTE(response.pitch)
+	SV_SHORT(response.item.id))
+
+SV_RESPONSE(SVPickupSpawn, SVPacketPickupSpawn,
+	SV_INTEGER(response.entity.id)
+	SV_SHORT(response.item.id)
+	SV_BYTE(response.item.count)
+	SV_SHORT(response.item.uses)
+	SV_INTEGER(response.position.x)
+	SV_INTEGER(response.position.y)
+	SV_INTEGER(response.position.z)
+	SV_BYTE(response.rotation)
+	SV_BYTE(response.pitch)
+	SV_BYTE(response.roll))
+
+SV_RESPONSE(SVCollectItem, SVPacketCollectItem,
+	SV_INTEGER(response.collected)
+	SV_INTEGER(response.collector))
+
+SV_RESPONSE(SVSpawnObject, SVPacketSpawnObject,
+	SV_INTEGER(response.entity.id)
+	SV_BYTE(response.type)
+	SV_INTEGER(response.position.x)
+	SV_INTEGER(response.position.y)
+	SV_INTEGER(response.position.z)
+	SV_INTEGER(response.flag)
+	SV_IF(response.flag > 0,
+		SV_SHORT(response.u1)
+		SV_SHORT(response.u2)
+		SV_SHORT(response.u3)))
+
+SV_RESPONSE(SVSpawnMob, SVPacketSpawnMob,
+	SV_INTEGER(response.id)
+	SV_BYTE(response.type)
+	SV_INTEGER(response.position.x)
+	SV_INTEGER(response.position.y)
+	SV_INTEGER(response.position.z)
+	SV_BYTE(response.yaw)
+	SV_BYTE(response.pitch)
+	SV_METADATA(response.metadata))
+
+SV_RESPONSE(SVPainting, SVPacketPainting,
+	SV_INTEGER(response.entity.id)
+	SV_STRING16(response.title)
+	SV_INTEGER(response.position.x)
+	SV_INTEGER(response.position.y)
+	SV_INTEGER(response.position.z)
+	SV_INTEGER(response.direction))
+
+SV_RESPONSE(SVExperienceOrb, SVPacketExperienceOrb,
+	SV_INTEGER(response.entity.id)
+	SV_INTEGER(response.position.x)
+	SV_INTEGER(response.position.y)
+	SV_INTEGER(response.position.z)
+	SV_SHORT(response.count))
+
+SV_RESPONSE(SVStanceUpdate, SVPacketStanceUpdate,
+	SV_FLOAT(response.u1)
+	SV_FLOAT(response.u2)
+	SV_FLOAT(response.u3)
+	SV_FLOAT(response.u4)
+	SV_BOOLEAN(response.u5)
+	SV_BOOLEAN(response.u6))
+
+SV_RESPONSE(SVEntityVelocity, SVPacketEntityVelocity,
+	SV_INTEGER(response.entity.id)
+	SV_SHORT(response.velocity.x)
+	SV_SHORT(response.velocity.y)
+	SV_SHORT(response.velocity.z))
+
+SV_RESPONSE(SVEntityDestroy, SVPacketEntityDestroy,
+	SV_INTEGER(response.entity.id))
+
+SV_RESPONSE(SVEntityCreate, SVPacketEntityCreate,
+	SV_INTEGER(response.entity.id))
+
+SV_RESPONSE(SVEntityRelativeMove, SVPacketEntityRelativeMove,
+	SV_INTEGER(response.entity.id)
+	SV_BYTE(response.position.x)
+	SV_BYTE(response.position.y)
+	SV_BYTE(response.position.z))
+
+SV_RESPONSE(SVEntityLook, SVPacketEntityLook,
+	SV_INTEGER(response.entity.id)
+	SV_BYTE(response.yaw)
+	SV_BYTE(response.pitch))
+
+SV_RESPONSE(SVEntityLookMove, SVPacketEntityLookMove,
+	SV_INTEGER(response.entity.id)
+	SV_BYTE(response.position.x)
+	SV_BYTE(response.position.y)
+	SV_BYTE(response.position.z)
+	SV_BYTE(response.yaw)
+	SV_BYTE(response.pitch))
+
+SV_RESPONSE(SVEntityTeleport, SVPacketEntityTeleport,
+	SV_INTEGER(response.entity.id)
+	SV_INTEGER(response.position.x)
+	SV_INTEGER(response.position.y)
+	SV_INTEGER(response.position.z)
+	SV_BYTE(response.rotation)
+	SV_BYTE(response.pitch))
+
+SV_RESPONSE(SVEntityStatus, SVPacketEntityStatus,
+	SV_INTEGER(response.entity.id)
+	SV_BYTE(response.status))
+
+SV_RESPONSE(SVEntityAttach, SVPacketEntityAttach,
+	SV_INTEGER(response.entity.id)
+	SV_INTEGER(response.vehicle.id))
+
+SV_RESPONSE(SVEntityMetadata, SVPacketEntityMetadata,
+	SV_INTEGER(response.entity.id)
+	SV_METADATA(response.metadata))
+
+SV_RESPONSE(SVEntityEffect, SVPacketEntityEffect,
+	SV_INTEGER(response.entity.id)
+	SV_BYTE(response.effect)
+	SV_BYTE(response.amplifier)
+	SV_SHORT(response.duration))
+
+SV_RESPONSE(SVRemoveEntityEffect, SVPacketRemoveEntityEffect,
+	SV_INTEGER(response.entity.id)
+	SV_BYTE(response.effect))
+
+SV_RESPONSE(SVExperience, SVPacketExperience,
+	SV_BYTE(response.currentExperience)
+	SV_BYTE(response.level)
+	SV_SHORT(response.totalExperience))
+
+SV_RESPONSE(SVPreChunk, SVPacketPreChunk,
+	SV_INTEGER(response.position.x)
+	SV_INTEGER(response.position.z)
+	SV_BOOLEAN(response.mode))
+
+SV_RESPONSE(SVMapChunk, SVPacketMapChunk,
+	SV_INTEGER(response.position.x)
+	SV_SHORT(response.position.y)
+	SV_INTEGER(response.position.z)
+	SV_SIZE(response.size.x)
+	SV_SIZE(response.size.y)
+	SV_SIZE(response.size.z)
+	SV_INTEGER(response.length)
+	SV_ARRAY(response.item, SVByte, response.length))
+
+SV_RESPONSE(SVMultiBlockChange, SVPacketMultiBlockChange,
+	SV_INTEGER(response.position.x)
+	SV_INTEGER(response.position.z)
+	SV_SHORT(response.length)
+	SV_ARRAY(response.coordinate, SVShort, response.length)
+	SV_ARRAY(response.type, SVByte, response.length)
+	SV_ARRAY(response.metadata, SVByte, response.length))
+
+SV_RESPONSE(SVBlockChange, SVPacketBlockChange,
+	SV_INTEGER(response.position.x)
+	SV_BYTE(response.position.y)
+	SV_INTEGER(response.position.z)
+	SV_BYTE(response.type)
+	SV_BYTE(response.metadata))
+
+SV_RESPONSE(SVPlayNoteBlock, SVPacketPlayNoteBlock,
+	SV_INTEGER(response.position.x)
+	SV_SHORT(response.position.y)
+	SV_INTEGER(response.position.z)
+	SV_BYTE(response.data1)
+	SV_BYTE(response.data2))
+
+SV_RESPONSE(SVExplosion, SVPacketExplosion,
+	SV_DOUBLE(response.position.x)
+	SV_DOUBLE(response.position.y)
+	SV_DOUBLE(response.position.z)
+	SV_FLOAT(response.radius)
+	SV_INTEGER(response.length)
+	SV_ARRAY(response.item, SVRelativePosition, response.length))
+
+SV_RESPONSE(SVSoundEffect, SVPacketSoundEffect,
+	SV_INTEGER(response.effect)
+	SV_INTEGER(response.position.x)
+	SV_BYTE(response.position.y)
+	SV_INTEGER(response.position.z)
+	SV_INTEGER(response.data))
+
+SV_RESPONSE(SVState, SVPacketState,
+	SV_BYTE(response.reason)
+	SV_BYTE(response.gameMode))
+
+SV_RESPONSE(SVThunderbolt, SVPacketThunderbolt,
+	SV_INTEGER(response.entity.id)
+	SV_BOOLEAN(response.u1)
+	SV_INTEGER(response.position.x)
+	SV_INTEGER(response.position.y)
+	SV_INTEGER(response.position.z))
+
+SV_RESPONSE(SVOpenWindow, SVPacketOpenWindow,
+	SV_BYTE(response.id)
+	SV_BYTE(response.type)
+	SV_STRING(response.title)
+	SV_BYTE(response.slots))
+
+SV_RESPONSE(SVCloseWindow, SVPacketCloseWindow,
+	SV_BYTE(response.id))
+
+SV_RESPONSE(SVSetSlot, SVPacketSetSlot,
+	SV_BYTE(response.id)
+	SV_SHORT(response.slot)
+	SV_ITEM(response.item))
+
+SV_RESPONSE(SVWindowItems, SVPacketWindowItems,
+	SV_BYTE(response.id)
+	SV_SHORT(response.length)
+	SV_ITEMS(response.item, response.length))
+
+SV_RESPONSE(SVUpdateProgressBar, SVPacketUpdateProgressBar,
+	SV_BYTE(response.id)
+	SV_SHORT(response.bar)
+	SV_SHORT(response.value))
+
+SV_RESPONSE(SVTransaction, SVPacketTransaction,
+	SV_BYTE(response.id)
+	SV_SHORT(response.action)
+	SV_BOOLEAN(response.accepted))
+
+SV_RESPONSE(SVCreativeInventoryAction, SVPacketCreativeInventoryAction,
+	SV_SHORT(response.slot)
+	SV_SHORT(response.itemId)
+	SV_SHORT(response.quantity)
+	SV_SHORT(response.damage))
+
+SV_RESPONSE(SVUpdateSign, SVPacketUpdateSign,
+	SV_INTEGER(response.position.x)
+	SV_SHORT(response.position.y)
+	SV_INTEGER(response.position.z)
+	SV_STRING16(response.first)
+	SV_STRING16(response.second)
+	SV_STRING16(response.third)
+	SV_STRING16(response.fourth))
+
+SV_RESPONSE(SVItemData, SVPacketItemData,
+	SV_SHORT(response.itemType)
+	SV_SHORT(response.itemId)
+	SV_BYTE(response.textLength)
+	SV_ARRAY(response.text, SVByte, response.textLength))
+
+SV_RESPONSE(SVPlayerListItem, SVPacketPlayerListItem,
+	SV_STRING16(response.playerName)
+	SV_BOOLEAN(response.online)
+	SV_SHORT(response.ping))
+
+SV_RESPONSE(SVDisconnect, SVPacketDisconnect,
+	SV_STRING16(response.reason))
+
+SV_RESPONSE(SVIncrementStatistic, SVPacketIncrementStatistic,
+	SV_INTEGER(response.id)
+	SV_BYTE(response.amount))
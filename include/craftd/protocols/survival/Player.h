@@ -47,6 +47,10 @@ typedef struct _SVPlayer {
 
 	CDString* username;
 
+	/// Set while the World's tick holds a job of the client, only used by the
+	/// tick thread
+	bool pinned;
+
 	CD_DEFINE_DYNAMIC;
 	CD_DEFINE_ERROR;
 } SVPlayer;
@@ -93,4 +97,11 @@ void SV_PlayerSendPacketAndClean (SVPlayer* self, SVPacket* packet);
  */
 void SV_PlayerSendPacketAndCleanData (SVPlayer* self, SVPacket* packet);
 
+/**
+ * Send an already serialized Packet to a Player without copying it
+ *
+ * @param data The shared packet data, see SV_PacketToSharedBuffer
+ */
+void SV_PlayerSendShared (SVPlayer* self, CDSharedBuffer* data);
+
 #endif
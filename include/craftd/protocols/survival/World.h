@@ -51,6 +51,31 @@ typedef enum _SVWorldDifficulty {
     SVDifficultyHard   = 2
 } SVWorldDifficulty;
 
+/**
+ * The phases of a World tick, each one is dispatched as the matching
+ * World.tick.* event with the World as argument.
+ *
+ * Handlers must only touch the players with SVPlayer.pinned set, the others
+ * may be logging out on another thread.
+ */
+typedef enum _SVWorldTickPhase {
+	/// World.tick.input, for handlers that batch what the players sent since
+	/// the last tick, packets themselves are still run as they arrive by the
+	/// client lanes
+	SVTickInput,
+
+	/// World.tick.simulate, advance the World state
+	SVTickSimulate,
+
+	/// World.tick.broadcast, send the changes, the players are corked
+	SVTickBroadcast,
+
+	/// World.tick.flush, the players are uncorked after it
+	SVTickFlush,
+
+	SVTickPhases
+} SVWorldTickPhase;
+
 typedef struct _SVWorld {
 	CDServer* server;
 
@@ -75,6 +100,9 @@ typedef struct _SVWorld {
 
 	struct {
 		pthread_spinlock_t time;
+		pthread_mutex_t    chunks;
+		pthread_mutex_t    persistence;
+		pthread_rwlock_t   grid;
 	} lock;
 
 	/// The currently connected players
@@ -83,8 +111,96 @@ typedef struct _SVWorld {
 	/// All world entities (including players)
 	CDMap*  entities;
 
+	/// Spatial index of the entities, a CDList of SVEntity for every chunk
+	/// with entities in it, indexed by SV_ChunkPositionToId
+	struct {
+		CDMap* cells;
+	} grid;
+
 	SVBlockPosition spawnPosition;
-	CDSet*          chunks;
+
+	/// The in-memory chunk cache
+	struct {
+		/// Resident chunks, indexed by SV_ChunkPositionToId
+		CDMap* resident;
+
+		/// Pin counts of chunks pinned before being loaded
+		CDMap* pinned;
+
+		/// Loads in flight of chunks, see SV_WorldGetChunk
+		CDMap* loading;
+
+		/// Unreferenced and unpinned chunks, least recently used first
+		SVChunk* first;
+		SVChunk* last;
+
+		/// Bytes of resident chunks and their cached MapChunk packets, and the
+		/// maximum the cache may keep
+		size_t size;
+		size_t budget;
+
+		struct {
+			uint64_t hits;
+			uint64_t misses;
+			uint64_t evictions;
+
+			/// MapChunk packets served from cache and built from scratch
+			uint64_t packetHits;
+			uint64_t packetMisses;
+		} statistics;
+	} chunks;
+
+	/// Write-back of changed chunks, done by a background thread
+	struct {
+		pthread_t      thread;
+		pthread_cond_t condition;
+
+		bool running;
+
+		/// Seconds between automatic saves, 0 disables them
+		int interval;
+
+		/// Chunk snapshots waiting to be written, oldest first
+		CDList* queue;
+
+		/// Snapshots that failed to be written, queued again with the next
+		/// snapshot
+		CDList* failed;
+
+		/// The latest queued snapshot of each chunk, indexed by
+		/// SV_ChunkPositionToId, loads are served from it until it's written
+		CDMap* pending;
+
+		struct {
+			uint64_t chunks;
+			uint64_t batches;
+			uint64_t failures;
+		} statistics;
+	} persistence;
+
+	/// Fixed rate game loop, done by a thread of its own
+	struct {
+		pthread_t thread;
+
+		bool running;
+
+		/// Ticks per second
+		int rate;
+
+		/// Ticks run so far, handlers use it to do things every n ticks
+		uint64_t count;
+
+		/// Players pinned by the running tick, only used by the tick thread
+		CDVector* pinned;
+
+		/// Times are in nanoseconds
+		struct {
+			uint64_t phases[SVTickPhases];
+			uint64_t longest;
+			uint64_t overruns;
+			uint64_t skipped;
+		} statistics;
+	} tick;
 
 	SVEntityId lastGeneratedEntityId;
 
@@ -94,6 +210,11 @@ typedef struct _SVWorld {
 
 SVWorld* SV_CreateWorld (CDServer* server, const char* name);
 
+/**
+ * Queue a snapshot of every changed chunk for saving and return, the chunks
+ * are written in the background through the World.chunk= event and every
+ * batch is followed by a World.save event to sync it.
+ */
 bool SV_WorldSave (SVWorld* self);
 
 void SV_DestroyWorld (SVWorld* self);
@@ -116,8 +237,29 @@ bool SV_WorldAddPlayer (SVWorld* self, SVPlayer* player);
  */
 void SV_WorldRemovePlayer (SVWorld* self, SVPlayer* player);
 
+/**
+ * Move an entity of the world, keeping the spatial index up to date.
+ *
+ * The entity's position must only be changed through this.
+ */
+void SV_WorldMoveEntity (SVWorld* self, SVEntity* entity, SVPrecisePosition position);
+
+/**
+ * Get the players in the chunks at most radius chunks away from center on
+ * each axis, using the spatial index.
+ *
+ * @return A CDList of SVPlayer to be destroyed by the caller
+ */
+CDList* SV_WorldGetPlayersInRadius (SVWorld* self, SVChunkPosition center, int radius);
+
 void SV_WorldBroadcastBuffer (SVWorld* self, CDBuffer* buffer);
 
+/**
+ * Send the same data to every player of the World, every player references
+ * it instead of getting a copy
+ */
+void SV_WorldBroadcastShared (SVWorld* self, CDSharedBuffer* data);
+
 void SV_WorldBroadcastPacket (SVWorld* self, SVPacket* packet);
 
 void SV_WorldBroadcastMessage (SVWorld* self, CDString* message);
@@ -126,8 +268,80 @@ uint16_t SV_WorldGetTime (SVWorld* self);
 
 uint16_t SV_WorldSetTime (SVWorld* self, uint16_t time);
 
+/**
+ * Get a chunk from the chunk cache, loading it through the World.chunk event
+ * if it's not resident.
+ *
+ * The returned chunk is referenced and won't be evicted until it's released
+ * with SV_WorldReleaseChunk.
+ *
+ * @return The chunk or NULL on failure, errno is set accordingly
+ */
 SVChunk* SV_WorldGetChunk (SVWorld* self, int x, int z);
 
-void SV_WorldSetChunk (SVWorld* self, SVChunk* chunk);
+/**
+ * Drop a reference obtained with SV_WorldGetChunk, unreferenced and unpinned
+ * chunks become candidates for eviction.
+ */
+void SV_WorldReleaseChunk (SVWorld* self, SVChunk* chunk);
+
+/**
+ * Pin a chunk in memory, pinned chunks are never evicted.
+ *
+ * The chunk isn't loaded, if it's not resident the pin applies once it is.
+ * Used for the chunks inside a player's view.
+ */
+void SV_WorldPinChunk (SVWorld* self, int x, int z);
+
+/**
+ * Unpin a chunk pinned with SV_WorldPinChunk
+ */
+void SV_WorldUnpinChunk (SVWorld* self, int x, int z);
+
+/**
+ * Mark a chunk obtained with SV_WorldGetChunk as changed, this has to be called
+ * after every block change so stale cached packets aren't sent and the chunk
+ * gets saved.
+ *
+ * Persistence plugins call it on the chunks they generate in World.chunk so
+ * they're saved and not generated again.
+ */
+void SV_WorldTouchChunk (SVWorld* self, SVChunk* chunk);
+
+/**
+ * Change a block of a chunk obtained with SV_WorldGetChunk and mark the chunk
+ * as changed.
+ *
+ * Resident chunks are copied for their packets and snapshots while other
+ * threads use them, so their blocks must only be changed through this.
+ */
+void SV_WorldSetChunkBlock (SVWorld* self, SVChunk* chunk, SVBlockPosition position, SVByte type, SVByte data);
+
+/**
+ * Get the MapChunk packet for the given chunk, it's built and compressed only
+ * when the chunk changed since the last time.
+ *
+ * The packet is referenced, release it with SV_ReleaseChunkPacket.
+ *
+ * @return The packet or NULL on failure, errno is set accordingly
+ */
+SVChunkPacket* SV_WorldGetChunkPacket (SVWorld* self, int x, int z);
+
+/**
+ * Take a reference to a chunk packet
+ */
+SVChunkPacket* SV_RetainChunkPacket (SVChunkPacket* self);
+
+/**
+ * Drop a reference to a chunk packet, it's destroyed with the last one
+ */
+void SV_ReleaseChunkPacket (SVChunkPacket* self);
+
+/**
+ * Write a chunk right away through the World.chunk= event
+ *
+ * @return false if a persistence plugin failed to write it
+ */
+bool SV_WorldSetChunk (SVWorld* self, SVChunk* chunk);
 
 #endif
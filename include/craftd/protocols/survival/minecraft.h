@@ -90,6 +90,91 @@ typedef enum _SVStringColor {
 	SVColorWhite
 } SVStringColor;
 
+/// Bitmap of the Latin-1 characters in SVCharset
+extern const uint64_t SVCharsetValid[4];
+
+/**
+ * Check if the client can draw a character
+ */
+static inline
+bool
+SV_CharIsValid (uint32_t ch)
+{
+	if (ch < 0x100) {
+		return (SVCharsetValid[ch >> 6] >> (ch & 63)) & 1;
+	}
+
+	// ƒ and ⌂ are the only ones past Latin-1
+	return ch == 0x0192 || ch == 0x2302;
+}
+
+/**
+ * Decode the UTF-8 sequence at data[*index] and move the index past it,
+ * malformed sequences decode to U+FFFD one byte at a time
+ */
+static inline
+uint32_t
+SV_UTF8Next (const uint8_t* data, size_t size, size_t* index)
+{
+	static const uint32_t minimum[] = { 0, 0, 0x80, 0x800, 0x10000 };
+
+	uint8_t  lead = data[*index];
+	size_t   length;
+	uint32_t ch;
+
+	if (lead < 0x80) {
+		*index += 1;
+
+		return lead;
+	}
+	else if ((lead & 0xE0) == 0xC0) {
+		length = 2;
+		ch     = lead & 0x1F;
+	}
+	else if ((lead & 0xF0) == 0xE0) {
+		length = 3;
+		ch     = lead & 0x0F;
+	}
+	else if ((lead & 0xF8) == 0xF0) {
+		length = 4;
+		ch     = lead & 0x07;
+	}
+	else {
+		*index += 1;
+
+		return 0xFFFD;
+	}
+
+	if (*index + length > size) {
+		*index += 1;
+
+		return 0xFFFD;
+	}
+
+	for (size_t i = 1; i < length; i++) {
+		uint8_t next = data[*index + i];
+
+		if ((next & 0xC0) != 0x80) {
+			*index += 1;
+
+			return 0xFFFD;
+		}
+
+		ch = (ch << 6) | (next & 0x3F);
+	}
+
+	// Overlong forms would get past the sanitizer as something else
+	if (ch < minimum[length] || ch > 0x10FFFF || (ch >= 0xD800 && ch <= 0xDFFF)) {
+		*index += 1;
+
+		return 0xFFFD;
+	}
+
+	*index += length;
+
+	return ch;
+}
+
 /**
  * Check if a String is valid for Minecraft
  *
@@ -105,6 +190,25 @@ bool SV_StringIsValid (CDString* self);
  */
 SVString SV_StringSanitize (SVString self);
 
+/**
+ * Write a sanitized String, replacing a character with ? never makes it
+ * longer
+ *
+ * @param output Room for the size of the String
+ *
+ * @return The size written
+ */
+size_t SV_StringSanitizeTo (SVString self, uint8_t* output);
+
+/**
+ * Sanitize a String and write it as UTF-16BE in the same pass
+ *
+ * @param output Room for 2 bytes per byte of the String
+ *
+ * @return The number of UTF-16 units written
+ */
+size_t SV_StringToUTF16 (SVString self, uint8_t* output);
+
 SVString SV_StringColorRange (CDString* self, SVStringColor color, size_t a, size_t b);
 
 SVString SV_StringColor (CDString* self, SVStringColor color);
@@ -158,6 +262,21 @@ typedef struct _SVRelativePosition {
 	SVByte z;
 } SVRelativePosition;
 
+/**
+ * A serialized and compressed MapChunk packet, shared by all the clients it's
+ * being sent to
+ */
+typedef struct _SVChunkPacket {
+	/// The version of the chunk the packet was built from
+	uint32_t version;
+
+	int                references;
+	pthread_spinlock_t lock;
+
+	size_t   length;
+	uint8_t* data;
+} SVChunkPacket;
+
 typedef struct _SVChunk {
 	SVChunkPosition position;
 
@@ -167,6 +286,23 @@ typedef struct _SVChunk {
 	uint8_t data[16384];
 	uint8_t blockLight[16384];
 	uint8_t skyLight[16384];
+
+	/// Residency bookkeeping, owned by the SVWorld chunk cache
+	struct {
+		int references;
+		int pins;
+
+		/// Bumped on every change, see SV_WorldTouchChunk
+		uint32_t       version;
+		SVChunkPacket* packet;
+
+		/// The version last queued for saving, the chunk is dirty when it
+		/// differs from the current one
+		uint32_t saved;
+
+		struct _SVChunk* previous;
+		struct _SVChunk* next;
+	} cache;
 } SVChunk;
 
 typedef enum _SVItemType {
@@ -603,6 +739,16 @@ SV_PrecisePositionToAbsolutePosition(SVPrecisePosition position)
 	};
 }
 
+/**
+ * Pack a chunk position in a single integer, usable as a CDMap key
+ */
+static inline
+int64_t
+SV_ChunkPositionToId (SVChunkPosition position)
+{
+	return (((int64_t) position.x) << 32) | ((uint32_t) position.z);
+}
+
 #define SV_ChunkPositionEqual(a, b)     ((a.x == b.x) && (a.z == b.z))
 #define SV_BlockPositionEqual(a, b)     ((a.x == b.x) && (a.y == b.y) && (a.z == b.z))
 #define SV_AbsolutePositionEqueal(a, b) ((a.x == b.x) && (a.y == b.y) && (a.z == b.z))
@@ -610,6 +756,6 @@ SV_PrecisePositionToAbsolutePosition(SVPrecisePosition position)
 
 bool SV_CompareChunkPosition (CDSet* self, SVChunkPosition* a, SVChunkPosition* b);
 
-unsigned int SV_HashChunkPosition (CDSet* self, SVChunkPosition* position);
+uint64_t SV_HashChunkPosition (CDSet* self, SVChunkPosition* position);
 
 #endif
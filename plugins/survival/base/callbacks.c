@@ -27,93 +27,16 @@
  * here.
  * @inmodule Survival
  */
-#include <zlib.h>
-
 #include <craftd/Logger.h>
 
 #include <craftd/protocols/survival/World.h>
 #include <craftd/protocols/survival/Region.h>
 #include <craftd/protocols/survival/Player.h>
 
-static
-bool
-cdsurvival_SendChunk (CDServer* server, SVPlayer* player, SVChunkPosition* coord)
-{
-	DO {
-		SVPacketPreChunk pkt = {
-			.response = {
-				.position = *coord,
-				.mode     = true
-			}
-		};
-
-		SVPacket response = { SVResponse, SVPreChunk, (CDPointer) &pkt };
-
-		SV_PlayerSendPacketAndCleanData(player, &response);
-	}
-
-	DO {
-		SDEBUG(server, "sending chunk (%d, %d)", coord->x, coord->z);
-
-		SVChunk* chunk = CD_malloc(sizeof(SVChunk));
-		CDError  status;
-
-		CD_EventDispatchWithError(status, server, "World.chunk", player->world, coord->x, coord->z, chunk);
-
-		if (status != CDOk) {
-			CD_free(chunk);
-
-			return false;
-		}
-
-		uLongf written = compressBound(81920);
-		Bytef* buffer  = CD_malloc(written);
-		Bytef* data    = CD_malloc(81920);
-
-		SV_ChunkToByteArray(chunk, data);
-
-		if (compress(buffer, &written, (Bytef*) data, 81920) != Z_OK) {
-			SERR(server, "zlib compress failure");
-
-			CD_free(chunk);
-			CD_free(data);
-
-			return false;
-		}
-
-		SDEBUG(server, "compressed to %ld bytes", written);
-
-		CD_free(chunk);
-		CD_free(data);
-
-		SVPacketMapChunk pkt = {
-			.response = {
-				.position = SV_ChunkPositionToBlockPosition(*coord),
-
-				.size = {
-					.x = 16,
-					.y = 128,
-					.z = 16
-				},
-
-				.length = written,
-				.item   = (SVByte*) buffer
-			}
-		};
-
-		SVPacket response = { SVResponse, SVMapChunk, (CDPointer) &pkt };
-
-		SV_PlayerSendPacketAndCleanData(player, &response);
-	}
-
-	return true;
-}
-
 static
 void
-cdsurvival_ChunkRadiusUnload (CDSet* self, SVChunkPosition* coord, SVPlayer* player)
+cdsurvival_ChunkRadiusUnload (SVChunkPosition* coord, SVPlayer* player)
 {
-	assert(self);
 	assert(coord);
 	assert(player);
 
@@ -130,64 +53,59 @@ cdsurvival_ChunkRadiusUnload (CDSet* self, SVChunkPosition* coord, SVPlayer* pla
 		SV_PlayerSendPacketAndCleanData(player, &response);
 	}
 
-	CD_free(coord);
+	SV_WorldUnpinChunk(player->world, coord->x, coord->z);
 }
 
 static
 void
-cdsurvival_ChunkMemberFree (CDSet* self, SVChunkPosition* coord, void* _)
+cdsurvival_ChunkRadiusUnpin (SVChunkPosition* coord, SVPlayer* player)
 {
-	assert(self);
 	assert(coord);
+	assert(player);
 
-	CD_free(coord);
+	SV_WorldUnpinChunk(player->world, coord->x, coord->z);
 }
 
 static
 void
-cdsurvival_ChunkRadiusLoad (CDSet* self, SVChunkPosition* coord, SVPlayer* player)
+cdsurvival_ChunkRadiusLoad (SVChunkPosition* coord, SVPlayer* player)
 {
-	assert(self);
 	assert(coord);
 	assert(player);
 
-	cdsurvival_SendChunk(player->client->server, player, coord);
+	// Keep the chunks in the player's view resident until they leave it
+	SV_WorldPinChunk(player->world, coord->x, coord->z);
 }
 
+/**
+ * Move the view of the player, the chunks entering it are streamed in the
+ * background nearest first and the ones leaving it are unloaded.
+ */
 static
 void
 cdsurvival_SendChunkRadius (SVPlayer* player, SVChunkPosition* area, int radius)
 {
-	CDSet* loadedChunks = (CDSet*) CD_DynamicGet(player, "Player.loadedChunks");
-	CDSet* oldChunks    = loadedChunks;
-	CDSet* newChunks    = CD_CreateSetWith(400, (CDSetCompare) SV_CompareChunkPosition, (CDSetHash) SV_HashChunkPosition);
-
-	for (int x = -radius; x < radius; x++) {
-		for (int z = -radius; z < radius; z++) {
-			if ((x * x + z * z) <= (radius * radius)) {
-				SVChunkPosition* coord = CD_malloc(sizeof(SVChunkPosition));
-				coord->x          = x + area->x;
-				coord->z          = z + area->z;
-
-				CD_SetPut(newChunks, (CDPointer) coord);
-			}
-		}
+	CDSurvivalChunkView*   view   = (CDSurvivalChunkView*) CD_DynamicGetSlot(player, _slot.chunkView);
+	CDSurvivalChunkStream* stream = (CDSurvivalChunkStream*) CD_DynamicGetSlot(player, _slot.chunkStream);
+	CDSurvivalChunkView    next   = { *area, radius };
+
+	if (!view) {
+		CD_DynamicPutSlot(player, _slot.chunkView, (CDPointer) (view = CD_alloc(sizeof(CDSurvivalChunkView))));
 	}
 
-	CDSet* toRemove = CD_SetMinus(oldChunks, newChunks);
-	CDSet* toAdd    = CD_SetMinus(newChunks, oldChunks);
+	if (!stream) {
+		CD_DynamicPutSlot(player, _slot.chunkStream, (CDPointer) (stream = cdsurvival_CreateChunkStream(player)));
+	}
 
-	CD_SetMap(toRemove, (CDSetApply) cdsurvival_ChunkRadiusUnload, (CDPointer) player);
-	CD_SetMap(toAdd, (CDSetApply) cdsurvival_ChunkRadiusLoad, (CDPointer) player);
+	cdsurvival_ChunkViewMinus(&next, view, (CDSurvivalChunkViewApply) cdsurvival_ChunkRadiusLoad, (CDPointer) player);
 
-	CD_DestroySet(toRemove);
-	CD_DestroySet(toAdd);
+	// The view has to move before the unloads are sent, so a chunk leaving
+	// the view can't be delivered after its unload
+	cdsurvival_ChunkStreamMove(stream, &next);
 
-	if (oldChunks) {
-		CD_DestroySet(oldChunks);
-	}
+	cdsurvival_ChunkViewMinus(view, &next, (CDSurvivalChunkViewApply) cdsurvival_ChunkRadiusUnload, (CDPointer) player);
 
-	CD_DynamicPut(player, "Player.loadedChunks", (CDPointer) newChunks);
+	*view = next;
 }
 
 static
@@ -205,100 +123,6 @@ cdsurvival_CoordInRadius(SVChunkPosition *coord, SVChunkPosition *centerCoord, i
 	return false;
 }
 
-static
-bool
-cdsurvival_DistanceGreater (SVPrecisePosition a, SVPrecisePosition b, int maxDistance)
-{
-	return (abs( a.x - b.x ) > maxDistance ||
-			abs( a.y - b.y ) > maxDistance ||
-			abs( a.z - b.z ) > maxDistance);
-}
-
-static
-SVRelativePosition
-cdsurvival_RelativeMove (SVPrecisePosition* a, SVPrecisePosition* b)
-{
-	SVAbsolutePosition absoluteA = SV_PrecisePositionToAbsolutePosition(*a);
-	SVAbsolutePosition absoluteB = SV_PrecisePositionToAbsolutePosition(*b);
-
-	return (SVRelativePosition) {
-		.x = absoluteA.x - absoluteB.x,
-		.y = absoluteA.y - absoluteB.y,
-		.z = absoluteA.z - absoluteB.z
-	};
-}
-
-static
-void
-cdsurvival_SendPacketToAllInRegion(SVPlayer *player, SVPacket *pkt)
-{
-  CDList *seenPlayers = (CDList *) CD_DynamicGet(player, "Player.seenPlayers");
-
-  CD_LIST_FOREACH(seenPlayers, it)
-  {
-	if ( player != (SVPlayer *) CD_ListIteratorValue(it) )
-	  SV_PlayerSendPacket( (SVPlayer *) CD_ListIteratorValue(it), pkt );
-	else
-	  CERR("We have a player with himself in the List????");
-  }
-}
-
-static
-void
-cdsurvival_SendUpdatePos(SVPlayer* player, SVPrecisePosition* newPosition, bool andLook, SVFloat pitch, SVFloat yaw)
-{
-	if (cdsurvival_DistanceGreater(player->entity.position, *newPosition, 2) || true) {
-		DO {
-			SVPacketEntityTeleport pkt;
-
-			pkt.response.entity   = player->entity;
-			pkt.response.position = SV_PrecisePositionToAbsolutePosition(*newPosition);
-
-			if (andLook) {
-				pkt.response.pitch = pitch;
-				pkt.response.rotation = yaw;
-			}
-			else {
-				pkt.response.pitch = player->pitch;
-				pkt.response.rotation = player->yaw;
-			}
-
-			SVPacket response = { SVResponse, SVEntityTeleport, (CDPointer)  &pkt };
-
-			cdsurvival_SendPacketToAllInRegion(player, &response);
-		}
-	}
-	else {
-		if (andLook) {
-			SVPacketEntityLookMove pkt = {
-				.response = {
-					.entity   = player->entity,
-					.position = SV_RelativeMove(&player->entity.position, newPosition),
-					.yaw      = yaw,
-					.pitch    = pitch
-				}
-			};
-
-
-			SVPacket response = { SVResponse, SVEntityLookMove, (CDPointer) &pkt };
-
-			SV_RegionBroadcastPacket(player, &response);
-		}
-		else {
-			SVPacketEntityRelativeMove pkt = {
-				.response = {
-					.entity   = player->entity,
-					.position = SV_RelativeMove(&player->entity.position, newPosition)
-				}
-			};
-
-			SVPacket response = { SVResponse, SVEntityRelativeMove, (CDPointer) &pkt };
-
-			SV_RegionBroadcastPacket(player, &response);
-		}
-	}
-}
-
 static
 void
 cdsurvival_SendNamedPlayerSpawn(SVPlayer *player, SVPlayer *other)
@@ -308,17 +132,17 @@ cdsurvival_SendNamedPlayerSpawn(SVPlayer *player, SVPlayer *other)
 			.response = {
 				.entity   = other->entity,
 				.name     = other->username,
-				.pitch    = other->pitch,
-				.rotation = other->yaw,
 
 				.item = {
 					.id = 0
-				},
-
-				.position = SV_PrecisePositionToAbsolutePosition(other->entity.position)
+				}
 			}
 		};
 
+		// Spawn where the other players were last told, the next move is a
+		// delta from there
+		cdsurvival_MovementSent(other, &pkt.response.position, &pkt.response.rotation, &pkt.response.pitch);
+
 		SVPacket response = { SVResponse, SVNamedEntitySpawn, (CDPointer) &pkt };
 
 		SV_PlayerSendPacket(player, &response);
@@ -381,43 +205,83 @@ static
 void
 cdsurvival_CheckPlayersInRegion (CDServer* server, SVPlayer* player, SVChunkPosition *coord, int radius)
 {
-	CDList* seenPlayers = (CDList*) CD_DynamicGet(player, "Player.seenPlayers");;
+	CDVector* seenPlayers = (CDVector*) CD_DynamicGetSlot(player, _slot.seenPlayers);
+	CDList*   nearby      = SV_WorldGetPlayersInRadius(player->world, *coord, radius);
+	CDList*   gone        = CD_CreateList();
 
-	CD_HASH_FOREACH(player->world->players, it) {
-		SVPlayer* otherPlayer = (SVPlayer *) CD_HashIteratorValue(it);
+	// The seen players of two players are never locked together, and the
+	// other players' ones are only used with the movement lock held so a
+	// logout can't destroy them meanwhile
+	CD_LIST_FOREACH(nearby, it) {
+		SVPlayer* otherPlayer = (SVPlayer*) CD_ListIteratorValue(it);
+		bool      seen;
 
 		// If we are the player to check just skip
 		if (otherPlayer == player) {
 			continue;
 		}
 
-		SVChunkPosition chunkPos = SV_PrecisePositionToChunkPosition(otherPlayer->entity.position);
+		CD_VectorWriteLock(seenPlayers);
+		if (!(seen = CD_VectorContains(seenPlayers, (CDPointer) otherPlayer))) {
+			CD_VectorPush(seenPlayers, (CDPointer) otherPlayer);
+		}
+		CD_VectorUnlock(seenPlayers);
+
+		/* If the player is in range, but not in the list. */
+		if (!seen) {
+			cdsurvival_SendNamedPlayerSpawn(player, otherPlayer);
 
-		if (cdsurvival_CoordInRadius(&chunkPos, coord, radius)) {
-			/* If the player is in range, but not in the list. */
-			if (!CD_ListContains(seenPlayers, (CDPointer) otherPlayer)) {
-				CD_ListPush(seenPlayers, (CDPointer) otherPlayer);
-				cdsurvival_SendNamedPlayerSpawn(player, otherPlayer);
+			pthread_mutex_lock(&_movement.lock);
+			CDVector *otherSeenPlayers = (CDVector *) CD_DynamicGetSlot(otherPlayer, _slot.seenPlayers);
 
-				CDList *otherSeenPlayers = (CDList *) CD_DynamicGet(otherPlayer, "Player.seenPlayers");
-				CD_ListPush(otherSeenPlayers, (CDPointer) player);
-				cdsurvival_SendNamedPlayerSpawn(otherPlayer, player);
+			if (otherSeenPlayers) {
+				CD_VectorWriteLock(otherSeenPlayers);
+				CD_VectorPush(otherSeenPlayers, (CDPointer) player);
+				CD_VectorUnlock(otherSeenPlayers);
 			}
+			pthread_mutex_unlock(&_movement.lock);
+
+			cdsurvival_SendNamedPlayerSpawn(otherPlayer, player);
 		}
-		else {
-			/* If the player is out of range but in the list */
-			if (CD_ListContains(seenPlayers, (CDPointer) otherPlayer)) {
-				CDList *otherSeenPlayers = (CDList *) CD_DynamicGet(otherPlayer, "Player.seenPlayers");
+	}
 
-				CD_ListDeleteAll(seenPlayers, (CDPointer) otherPlayer);
-				CD_ListDeleteAll(otherSeenPlayers, (CDPointer) player);
+	// Only the players already seen can have gone out of range
+	CD_VectorReadLock(seenPlayers);
+	CD_VECTOR_FOREACH(seenPlayers, i) {
+		SVPlayer*       otherPlayer = (SVPlayer*) CD_VectorGet(seenPlayers, i);
+		SVChunkPosition chunkPos    = SV_PrecisePositionToChunkPosition(otherPlayer->entity.position);
 
-				/* Should send both players an update. */
-				cdsurvival_SendDestroyEntity(player, &otherPlayer->entity);
-				cdsurvival_SendDestroyEntity(otherPlayer, &player->entity);
-			}
+		if (!cdsurvival_CoordInRadius(&chunkPos, coord, radius)) {
+			CD_ListPush(gone, (CDPointer) otherPlayer);
+		}
+	}
+	CD_VectorUnlock(seenPlayers);
+
+	/* If the player is out of range but in the list */
+	CD_LIST_FOREACH(gone, it) {
+		SVPlayer* otherPlayer = (SVPlayer*) CD_ListIteratorValue(it);
+
+		CD_VectorWriteLock(seenPlayers);
+		CD_VectorDeleteAll(seenPlayers, (CDPointer) otherPlayer);
+		CD_VectorUnlock(seenPlayers);
+
+		pthread_mutex_lock(&_movement.lock);
+		CDVector* otherSeenPlayers = (CDVector*) CD_DynamicGetSlot(otherPlayer, _slot.seenPlayers);
+
+		if (otherSeenPlayers) {
+			CD_VectorWriteLock(otherSeenPlayers);
+			CD_VectorDeleteAll(otherSeenPlayers, (CDPointer) player);
+			CD_VectorUnlock(otherSeenPlayers);
 		}
+		pthread_mutex_unlock(&_movement.lock);
+
+		/* Should send both players an update. */
+		cdsurvival_SendDestroyEntity(player, &otherPlayer->entity);
+		cdsurvival_SendDestroyEntity(otherPlayer, &player->entity);
 	}
+
+	CD_DestroyList(gone);
+	CD_DestroyList(nearby);
 }
 
 static
@@ -425,13 +289,13 @@ bool
 cdsurvival_ClientProcess (CDServer* server, CDClient* client, SVPacket* packet)
 {
 	SVWorld*  world;
-	SVPlayer* player = (SVPlayer*) CD_DynamicGet(client, "Client.player");
+	SVPlayer* player = (SVPlayer*) CD_DynamicGetSlot(client, _slot.player);
 
 	if (player && player->world) {
 		world = player->world;
 	}
 	else {
-		world = (SVWorld*) CD_DynamicGet(server, "World.default");
+		world = (SVWorld*) CD_DynamicGetSlot(server, _slot.world);
 	}
 
 	switch (packet->type) {
@@ -493,19 +357,11 @@ cdsurvival_ClientProcess (CDServer* server, CDClient* client, SVPacket* packet)
 
 			SVChunkPosition spawnChunk = SV_BlockPositionToChunkPosition(world->spawnPosition);
 
-			// Hack in a square send for login
-			for (int i = -7; i < 8; i++) {
-				for ( int j = -7; j < 8; j++) {
-					SVChunkPosition coords = {
-						.x = spawnChunk.x + i,
-						.z = spawnChunk.z + j
-					};
+			// The chunks around the spawn are streamed in the background, the
+			// nearest ones first
+			SV_WorldMoveEntity(world, &player->entity, SV_BlockPositionToPrecisePosition(world->spawnPosition));
 
-					if (!cdsurvival_SendChunk(server, player, &coords)) {
-						return false;
-					}
-				}
-			}
+			cdsurvival_SendChunkRadius(player, &spawnChunk, 10);
 
 			/* Send Spawn Position to initialize compass */
 			DO {
@@ -561,7 +417,7 @@ cdsurvival_ClientProcess (CDServer* server, CDClient* client, SVPacket* packet)
 
 			player = SV_CreatePlayer(client);
 
-			CD_DynamicPut(client, "Client.player", (CDPointer) player);
+			CD_DynamicPutSlot(client, _slot.player, (CDPointer) player);
 
 			SVPacket response = { SVResponse, SVHandshake, (CDPointer) &pkt };
 
@@ -595,9 +451,9 @@ cdsurvival_ClientProcess (CDServer* server, CDClient* client, SVPacket* packet)
 				cdsurvival_CheckPlayersInRegion(server, player, &newChunk, 5);
 			}
 
-			cdsurvival_SendUpdatePos(player, &data->request.position, false, 0, 0);
+			cdsurvival_MovementUpdate(player, &data->request.position, false, 0, 0);
 
-			player->entity.position = data->request.position;
+			SV_WorldMoveEntity(world, &player->entity, data->request.position);
 		} break;
 
 		case SVPlayerLook: {
@@ -608,17 +464,7 @@ cdsurvival_ClientProcess (CDServer* server, CDClient* client, SVPacket* packet)
 			player->yaw   = data->request.yaw;
 			player->pitch = data->request.pitch;
 
-			DO {
-			  SVPacketEntityLook pkt;
-
-			  pkt.response.entity = player->entity;
-			  pkt.response.pitch = player->pitch;
-			  pkt.response.yaw = player->yaw;
-
-			  SVPacket response = { SVResponse, SVEntityLook, (CDPointer) &pkt };
-
-			  cdsurvival_SendPacketToAllInRegion(player, &response);
-			}
+			cdsurvival_MovementUpdate(player, NULL, true, player->pitch, player->yaw);
 		} break;
 
 		case SVPlayerMoveLook: {
@@ -636,11 +482,12 @@ cdsurvival_ClientProcess (CDServer* server, CDClient* client, SVPacket* packet)
 				cdsurvival_CheckPlayersInRegion(server, player, &newChunk, 5);
 			}
 
-			cdsurvival_SendUpdatePos(player, &data->request.position, true, data->request.pitch, data->request.yaw);
+			cdsurvival_MovementUpdate(player, &data->request.position, true, data->request.pitch, data->request.yaw);
+
+			SV_WorldMoveEntity(world, &player->entity, data->request.position);
 
-			player->entity.position = data->request.position;
-			player->yaw             = data->request.yaw;
-			player->pitch           = data->request.pitch;
+			player->yaw   = data->request.yaw;
+			player->pitch = data->request.pitch;
 		} break;
                 
                 case SVPlayerDigging: {
@@ -654,6 +501,10 @@ cdsurvival_ClientProcess (CDServer* server, CDClient* client, SVPacket* packet)
                             SVChunkPosition pos = SV_BlockPositionToChunkPosition(data->request.position);
                             SVChunk* chunk = SV_WorldGetChunk(world, pos.x, pos.z);
 
+                            if (!chunk) {
+                                break;
+                            }
+
                             SVInteger iPos = data->request.position.y + 128 * (
                                     (data->request.position.z & 0xF) + 16 *
                                     (data->request.position.x & 0xF));
@@ -678,6 +529,9 @@ cdsurvival_ClientProcess (CDServer* server, CDClient* client, SVPacket* packet)
                             DEBUG("Break info: Chunk X:%i Chunk Z:%i Block Type:0x%.2X Block Data:0x%.2X\n",
                                     pos.x, pos.z, chunk->blocks[iPos], chunk->data[iPos]);
 
+                            SV_WorldSetChunkBlock(world, chunk, data->request.position, SVAir, 0);
+                            SV_WorldReleaseChunk(world, chunk);
+
                             SVPacketBlockChange pkt = {
                                 .response = {
                                     .position = {
@@ -691,7 +545,17 @@ cdsurvival_ClientProcess (CDServer* server, CDClient* client, SVPacket* packet)
                             };
 
                             SVPacket response = { SVResponse, SVBlockChange, (CDPointer) &pkt};
-                            SV_WorldBroadcastPacket(world, &response); //Maybe send to all in region?
+
+                            // Only the players with the chunk in view care
+                            CDList*         viewers = SV_WorldGetPlayersInRadius(world, pos, 10);
+                            CDSharedBuffer* shared  = SV_PacketToSharedBuffer(&response);
+
+                            CD_LIST_FOREACH(viewers, it) {
+                                SV_PlayerSendShared((SVPlayer*) CD_ListIteratorValue(it), shared);
+                            }
+
+                            CD_ReleaseSharedBuffer(shared);
+                            CD_DestroyList(viewers);
                         }
                         else {
                             SERR(server, "Player %s tried to dig past max dig limit! Hacking?",
@@ -773,10 +637,8 @@ cdsurvival_PlayerLogin (CDServer* server, SVPlayer* player, int status)
 				CD_StringContent(player->username)), SVColorYellow));
 
 
-	CD_DynamicPut(player, "Player.loadedChunks", (CDPointer) CD_CreateSetWith(
-		400, (CDSetCompare) SV_CompareChunkPosition, (CDSetHash) SV_HashChunkPosition));
-
-	CD_DynamicPut(player, "Player.seenPlayers", (CDPointer) CD_CreateList());
+	CD_DynamicPutSlot(player, _slot.seenPlayers, (CDPointer) CD_CreateVector());
+	CD_DynamicPutSlot(player, _slot.movement, (CDPointer) cdsurvival_CreateMovement(player));
 
 	SVChunkPosition playerChunk = SV_PrecisePositionToChunkPosition(player->entity.position);
 
@@ -794,28 +656,67 @@ cdsurvival_PlayerLogout (CDServer* server, SVPlayer* player)
 	SV_WorldBroadcastMessage(player->world, SV_StringColor(CD_CreateStringFromFormat("%s has left the game",
 		CD_StringContent(player->username)), SVColorYellow));
 
-	CDList* seenPlayers = (CDList*) CD_DynamicDelete(player, "Player.seenPlayers");
+	// Other players' seen lists are only taken out or used with the movement
+	// lock held, so they stay alive while we unlink from them
+	pthread_mutex_lock(&_movement.lock);
+	CDVector* seenPlayers = (CDVector*) CD_DynamicDeleteSlot(player, _slot.seenPlayers);
 
 	if (seenPlayers) {
-		CD_LIST_FOREACH(seenPlayers, it) {
+		CDList* seen = CD_CreateList();
+
+		CD_VectorReadLock(seenPlayers);
+		CD_VECTOR_FOREACH(seenPlayers, i) {
+			CD_ListPush(seen, CD_VectorGet(seenPlayers, i));
+		}
+		CD_VectorUnlock(seenPlayers);
+
+		CD_LIST_FOREACH(seen, it) {
 			SVPlayer* other            = (SVPlayer*) CD_ListIteratorValue(it);
-			CDList*   otherSeenPlayers = (CDList*) CD_DynamicGet(other, "Player.seenPlayers");
+			CDVector* otherSeenPlayers = (CDVector*) CD_DynamicGetSlot(other, _slot.seenPlayers);
+
+			// Without its list the other player is logging out as well
+			if (!otherSeenPlayers) {
+				continue;
+			}
+
+			CD_VectorWriteLock(otherSeenPlayers);
+			CD_VectorDeleteAll(otherSeenPlayers, (CDPointer) player);
+			CD_VectorUnlock(otherSeenPlayers);
 
 			cdsurvival_SendDestroyEntity(other, &player->entity);
-			CD_ListDeleteAll(otherSeenPlayers, (CDPointer) player);
 		}
 
+		CD_DestroyList(seen);
+	}
+	pthread_mutex_unlock(&_movement.lock);
+
+	if (seenPlayers) {
 		CD_HashDelete(player->world->players, CD_StringContent(player->username));
 		CD_MapDelete(player->world->entities, player->entity.id);
 
-		CD_DestroyList(seenPlayers);
+		CD_DestroyVector(seenPlayers);
 	}
 
-	CDSet* chunks = (CDSet*) CD_DynamicDelete(player, "Player.loadedChunks");
+	CDSurvivalMovement* movement = (CDSurvivalMovement*) CD_DynamicDeleteSlot(player, _slot.movement);
+
+	if (movement) {
+		cdsurvival_DestroyMovement(movement);
+	}
+
+	CDSurvivalChunkStream* stream = (CDSurvivalChunkStream*) CD_DynamicDeleteSlot(player, _slot.chunkStream);
+
+	if (stream) {
+		cdsurvival_ChunkStreamClose(stream);
+	}
+
+	CDSurvivalChunkView* view = (CDSurvivalChunkView*) CD_DynamicDeleteSlot(player, _slot.chunkView);
+
+	if (view) {
+		CDSurvivalChunkView none = { view->center, 0 };
+
+		cdsurvival_ChunkViewMinus(view, &none, (CDSurvivalChunkViewApply) cdsurvival_ChunkRadiusUnpin, (CDPointer) player);
 
-	if (chunks) {
-		CD_SetMap(chunks, (CDSetApply) cdsurvival_ChunkMemberFree, CDNull);
-		CD_DestroySet(chunks);
+		CD_free(view);
 	}
 
 	SV_WorldRemovePlayer(player->world, player);
@@ -830,7 +731,7 @@ cdsurvival_ClientDisconnect (CDServer* server, CDClient* client, bool status)
 	assert(server);
 	assert(client);
 
-	SVPlayer* player = (SVPlayer*) CD_DynamicGet(client, "Client.player");
+	SVPlayer* player = (SVPlayer*) CD_DynamicGetSlot(client, _slot.player);
 
 	if(!player)
 	{
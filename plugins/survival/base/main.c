@@ -36,47 +36,75 @@ static struct {
 	pthread_mutex_t login;
 } _lock;
 
+static struct {
+	struct {
+		int    concurrent;
+		size_t inflight;
+	} chunks;
+
+	struct {
+		int resync;
+	} movement;
+} _config;
+
+static struct {
+	CDDynamicSlot world;
+	CDDynamicSlot player;
+	CDDynamicSlot seenPlayers;
+	CDDynamicSlot movement;
+	CDDynamicSlot chunkView;
+	CDDynamicSlot chunkStream;
+} _slot;
+
+#include "view.c"
+#include "stream.c"
+#include "movement.c"
 #include "callbacks.c"
 
+/**
+ * Advance the World time once a second.
+ */
 static
-void
-cdsurvival_TimeIncrease (void* _, void* __, CDServer* server)
+bool
+cdsurvival_WorldTickSimulate (CDServer* server, SVWorld* world)
 {
-	CDList* worlds = (CDList*) CD_DynamicGet(server, "World.list");
-
-	CD_LIST_FOREACH(worlds, it) {
-		SVWorld* world = (SVWorld*) CD_ListIteratorValue(it);
+	if (world->tick.count % world->tick.rate != 0) {
+		return true;
+	}
 
-		uint16_t current = SV_WorldGetTime(world);
+	uint16_t current = SV_WorldGetTime(world);
 
-		if (current >= 0 && current <= 11999) {
-			SV_WorldSetTime(world, current += world->config.cache.rate.day);
-		}
-		else if (current >= 12000 && current <= 13799) {
-			SV_WorldSetTime(world, current += world->config.cache.rate.sunset);
-		}
-		else if (current >= 13800 && current <= 22199) {
-			SV_WorldSetTime(world, current += world->config.cache.rate.night);
-		}
-		else if (current >= 22200 && current <= 23999) {
-			SV_WorldSetTime(world, current += world->config.cache.rate.sunrise);
-		}
+	if (current >= 0 && current <= 11999) {
+		SV_WorldSetTime(world, current += world->config.cache.rate.day);
+	}
+	else if (current >= 12000 && current <= 13799) {
+		SV_WorldSetTime(world, current += world->config.cache.rate.sunset);
+	}
+	else if (current >= 13800 && current <= 22199) {
+		SV_WorldSetTime(world, current += world->config.cache.rate.night);
+	}
+	else if (current >= 22200 && current <= 23999) {
+		SV_WorldSetTime(world, current += world->config.cache.rate.sunrise);
+	}
 
-		if (current >= 24000) {
-			SV_WorldSetTime(world, current - 24000);
-		}
+	if (current >= 24000) {
+		SV_WorldSetTime(world, current - 24000);
 	}
+
+	return true;
 }
 
+/**
+ * Send the movements every tick, the World time every 30 seconds and a keep
+ * alive every 10 seconds.
+ */
 static
-void
-cdsurvival_TimeUpdate (void* _, void* __, CDServer* server)
+bool
+cdsurvival_WorldTickBroadcast (CDServer* server, SVWorld* world)
 {
-	CDList* worlds = (CDList*) CD_DynamicGet(server, "World.list");
-
-	CD_LIST_FOREACH(worlds, it) {
-		SVWorld* world = (SVWorld*) CD_ListIteratorValue(it);
+	cdsurvival_MovementTick(world);
 
+	if (world->tick.count % (world->tick.rate * 30) == 0) {
 		SVPacketTimeUpdate pkt = {
 			.response = {
 				.time = SV_WorldGetTime(world)
@@ -87,23 +115,26 @@ cdsurvival_TimeUpdate (void* _, void* __, CDServer* server)
 
 		SV_WorldBroadcastPacket(world, &packet);
 	}
-}
 
-static
-void
-cdsurvival_KeepAlive (void* _, void* __, CDServer* server)
-{
-	SVPacketKeepAlive pkt;
-	pkt.keepAliveID = 0;
+	if (world->tick.count % (world->tick.rate * 10) == 0) {
+		SVPacketKeepAlive pkt;
+		pkt.keepAliveID = 0;
+
+		SVPacket        packet = { SVResponse, SVKeepAlive, (CDPointer) &pkt };
+		CDSharedBuffer* data   = SV_PacketToSharedBuffer(&packet);
 
-	SVPacket  packet = { SVResponse, SVKeepAlive, (CDPointer) &pkt };
-	CDBuffer* buffer = SV_PacketToBuffer(&packet);
+		CD_HASH_FOREACH(world->players, it) {
+			SVPlayer* player = (SVPlayer*) CD_HashIteratorValue(it);
 
-	CD_LIST_FOREACH(server->clients, it) {
-		CD_ClientSendBuffer((CDClient*) CD_ListIteratorValue(it), buffer);
+			if (player->pinned) {
+				SV_PlayerSendShared(player, data);
+			}
+		}
+
+		CD_ReleaseSharedBuffer(data);
 	}
 
-	CD_DestroyBuffer(buffer);
+	return true;
 }
 
 static
@@ -135,7 +166,7 @@ cdsurvival_ServerStart (CDServer* server)
 	}
 
 	CD_DynamicPut(self->server, "World.list", (CDPointer) worlds);
-	CD_DynamicPut(self->server, "World.default", (CDPointer) defaultWorld);
+	CD_DynamicPutSlot(self->server, _slot.world, (CDPointer) defaultWorld);
 
 	return true;
 }
@@ -144,7 +175,7 @@ static
 bool
 cdsurvival_ServerStop (CDServer* server)
 {
-	CD_DynamicDelete(server, "World.default");
+	CD_DynamicDeleteSlot(server, _slot.world);
 
 	CDList* worlds = (CDList*) CD_DynamicDelete(server, "World.list");
 
@@ -185,11 +216,41 @@ CD_PluginInitialize (CDPlugin* self)
 
 	CD_InitializeSurvivalProtocol(self->server);
 
+	DO { // Initialize config cache
+		_config.chunks.concurrent = 4;
+		_config.chunks.inflight   = 512;
+
+		C_SAVE(C_PATH(self->config, "chunks.concurrent"), C_INT, _config.chunks.concurrent);
+		C_SAVE(C_PATH(self->config, "chunks.inflight"), C_INT, _config.chunks.inflight);
+
+		// The in-flight limit is given in kilobytes
+		_config.chunks.inflight *= 1024;
+
+		_config.movement.resync = 200;
+
+		C_SAVE(C_PATH(self->config, "movement.resync"), C_INT, _config.movement.resync);
+	}
+
+	_slot.world       = CD_DynamicSlot("World.default");
+	_slot.player      = CD_DynamicSlot("Client.player");
+	_slot.seenPlayers = CD_DynamicSlot("Player.seenPlayers");
+	_slot.movement    = CD_DynamicSlot("Player.movement");
+	_slot.chunkView   = CD_DynamicSlot("Player.chunkView");
+	_slot.chunkStream = CD_DynamicSlot("Player.chunkStream");
+
+	if (!_slot.world || !_slot.player || !_slot.seenPlayers || !_slot.movement || !_slot.chunkView || !_slot.chunkStream) {
+		SERR(self->server, "could not reserve the dynamic properties");
+
+		return false;
+	}
+
 	pthread_mutex_init(&_lock.login, NULL);
+	pthread_mutex_init(&_movement.lock, NULL);
 
-	CD_DynamicPut(self, "Event.timeIncrease", CD_SetInterval(self->server->timeloop, 1,  (event_callback_fn) cdsurvival_TimeIncrease, CDNull));
-	CD_DynamicPut(self, "Event.timeUpdate",   CD_SetInterval(self->server->timeloop, 30, (event_callback_fn) cdsurvival_TimeUpdate, CDNull));
-	CD_DynamicPut(self, "Event.keepAlive",    CD_SetInterval(self->server->timeloop, 10, (event_callback_fn) cdsurvival_KeepAlive, CDNull));
+	_movement.queue = CD_CreateVector();
+
+	CD_EventRegister(self->server, "World.tick.simulate", cdsurvival_WorldTickSimulate);
+	CD_EventRegister(self->server, "World.tick.broadcast", cdsurvival_WorldTickBroadcast);
 
 	#ifdef HAVE_JSON
 	CD_EventRegister(self->server, "RPC.JSON", cdsurvival_JSON);
@@ -221,9 +282,8 @@ extern
 bool
 CD_PluginFinalize (CDPlugin* self)
 {
-	CD_ClearInterval(self->server->timeloop, (int) CD_DynamicDelete(self, "Event.timeIncrease"));
-	CD_ClearInterval(self->server->timeloop, (int) CD_DynamicDelete(self, "Event.timeUpdate"));
-	CD_ClearInterval(self->server->timeloop, (int) CD_DynamicDelete(self, "Event.keepAlive"));
+	CD_EventUnregister(self->server, "World.tick.simulate", cdsurvival_WorldTickSimulate);
+	CD_EventUnregister(self->server, "World.tick.broadcast", cdsurvival_WorldTickBroadcast);
 
 	#ifdef HAVE_JSON
 	CD_EventUnregister(self->server, "RPC.JSON", cdsurvival_JSON);
@@ -244,6 +304,9 @@ CD_PluginFinalize (CDPlugin* self)
 	CD_EventUnregister(self->server, "Client.disconnect", (CDEventCallbackFunction) cdsurvival_ClientDisconnect);
 
 	pthread_mutex_destroy(&_lock.login);
+	pthread_mutex_destroy(&_movement.lock);
+
+	CD_DestroyVector(_movement.queue);
 
 	return true;
 }
@@ -0,0 +1,296 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * Movement broadcast.
+ *
+ * Moves and looks are only recorded when the packets come in. Once per world
+ * tick, in its broadcast phase, every player that changed gets a single
+ * update, serialized once and sent to the players seeing it: a relative move
+ * while the change fits the byte deltas, a teleport when it doesn't or when a
+ * resync is due. Deltas are taken against what was last sent and not against
+ * the real position, so rounding never adds up on the clients, and new
+ * observers are spawned at that same position.
+ *
+ * @inmodule Survival
+ */
+
+typedef struct _CDSurvivalMovement {
+	SVPlayer* player;
+
+	/// The latest position and look of the player
+	SVAbsolutePosition position;
+	SVByte             yaw;
+	SVByte             pitch;
+
+	/// The position and look the observers know of
+	struct {
+		SVAbsolutePosition position;
+		SVByte             yaw;
+		SVByte             pitch;
+	} sent;
+
+	bool queued;
+
+	/// Updates left until the next teleport
+	int resync;
+} CDSurvivalMovement;
+
+static struct {
+	/// Also held to take the seenPlayers slot of a player out and to use the
+	/// one of another player, so neither the tick nor a logout ever reads a
+	/// destroyed one
+	pthread_mutex_t lock;
+
+	/// CDSurvivalMovement changed since the last tick
+	CDVector* queue;
+} _movement;
+
+static inline
+SVByte
+cdsurvival_AngleToByte (SVFloat angle)
+{
+	return (SVByte) (int) (angle * 256.0f / 360.0f);
+}
+
+static inline
+bool
+cdsurvival_FitsRelativeMove (SVInteger delta)
+{
+	return delta >= -128 && delta <= 127;
+}
+
+static
+CDSurvivalMovement*
+cdsurvival_CreateMovement (SVPlayer* player)
+{
+	CDSurvivalMovement* self = CD_malloc(sizeof(CDSurvivalMovement));
+
+	self->player   = player;
+	self->position = SV_PrecisePositionToAbsolutePosition(player->entity.position);
+	self->yaw      = cdsurvival_AngleToByte(player->yaw);
+	self->pitch    = cdsurvival_AngleToByte(player->pitch);
+
+	self->sent.position = self->position;
+	self->sent.yaw      = self->yaw;
+	self->sent.pitch    = self->pitch;
+
+	self->queued = false;
+	self->resync = _config.movement.resync;
+
+	return self;
+}
+
+static
+void
+cdsurvival_DestroyMovement (CDSurvivalMovement* self)
+{
+	pthread_mutex_lock(&_movement.lock);
+	if (self->queued) {
+		CD_VectorDeleteAll(_movement.queue, (CDPointer) self);
+	}
+	pthread_mutex_unlock(&_movement.lock);
+
+	CD_free(self);
+}
+
+/**
+ * Record the player's new position, and look if changed, to be sent on the
+ * next tick.
+ */
+static
+void
+cdsurvival_MovementUpdate (SVPlayer* player, SVPrecisePosition* position, bool andLook, SVFloat pitch, SVFloat yaw)
+{
+	CDSurvivalMovement* self = (CDSurvivalMovement*) CD_DynamicGetSlot(player, _slot.movement);
+
+	if (!self) {
+		return;
+	}
+
+	pthread_mutex_lock(&_movement.lock);
+	if (position) {
+		self->position = SV_PrecisePositionToAbsolutePosition(*position);
+	}
+
+	if (andLook) {
+		self->yaw   = cdsurvival_AngleToByte(yaw);
+		self->pitch = cdsurvival_AngleToByte(pitch);
+	}
+
+	if (!self->queued) {
+		self->queued = true;
+
+		CD_VectorPush(_movement.queue, (CDPointer) self);
+	}
+	pthread_mutex_unlock(&_movement.lock);
+}
+
+/**
+ * Get the position and look the observers know the player at, new observers
+ * have to be spawned there for the next deltas to apply.
+ */
+static
+void
+cdsurvival_MovementSent (SVPlayer* player, SVAbsolutePosition* position, SVByte* yaw, SVByte* pitch)
+{
+	CDSurvivalMovement* self = (CDSurvivalMovement*) CD_DynamicGetSlot(player, _slot.movement);
+
+	if (!self) {
+		*position = SV_PrecisePositionToAbsolutePosition(player->entity.position);
+		*yaw      = cdsurvival_AngleToByte(player->yaw);
+		*pitch    = cdsurvival_AngleToByte(player->pitch);
+
+		return;
+	}
+
+	pthread_mutex_lock(&_movement.lock);
+	*position = self->sent.position;
+	*yaw      = self->sent.yaw;
+	*pitch    = self->sent.pitch;
+	pthread_mutex_unlock(&_movement.lock);
+}
+
+static
+bool
+cdsurvival_MovementPacket (CDSurvivalMovement* self, SVPacket* packet, CDPointer data)
+{
+	SVAbsolutePosition* now   = &self->position;
+	SVAbsolutePosition* sent  = &self->sent.position;
+	SVInteger           x     = now->x - sent->x;
+	SVInteger           y     = now->y - sent->y;
+	SVInteger           z     = now->z - sent->z;
+	bool                moved = x != 0 || y != 0 || z != 0;
+	bool                look  = self->yaw != self->sent.yaw || self->pitch != self->sent.pitch;
+
+	packet->chain = SVResponse;
+	packet->data  = data;
+
+	if (!moved && !look) {
+		return false;
+	}
+
+	if (moved && (--self->resync <= 0 || !cdsurvival_FitsRelativeMove(x) || !cdsurvival_FitsRelativeMove(y) || !cdsurvival_FitsRelativeMove(z))) {
+		SVPacketEntityTeleport* pkt = (SVPacketEntityTeleport*) data;
+
+		pkt->response.entity   = self->player->entity;
+		pkt->response.position = *now;
+		pkt->response.rotation = self->yaw;
+		pkt->response.pitch    = self->pitch;
+
+		packet->type = SVEntityTeleport;
+		self->resync = _config.movement.resync;
+	}
+	else if (moved && look) {
+		SVPacketEntityLookMove* pkt = (SVPacketEntityLookMove*) data;
+
+		pkt->response.entity   = self->player->entity;
+		pkt->response.position = (SVRelativePosition) { x, y, z };
+		pkt->response.yaw      = self->yaw;
+		pkt->response.pitch    = self->pitch;
+
+		packet->type = SVEntityLookMove;
+	}
+	else if (moved) {
+		SVPacketEntityRelativeMove* pkt = (SVPacketEntityRelativeMove*) data;
+
+		pkt->response.entity   = self->player->entity;
+		pkt->response.position = (SVRelativePosition) { x, y, z };
+
+		packet->type = SVEntityRelativeMove;
+	}
+	else {
+		SVPacketEntityLook* pkt = (SVPacketEntityLook*) data;
+
+		pkt->response.entity = self->player->entity;
+		pkt->response.yaw    = self->yaw;
+		pkt->response.pitch  = self->pitch;
+
+		packet->type = SVEntityLook;
+	}
+
+	self->sent.position = *now;
+	self->sent.yaw      = self->yaw;
+	self->sent.pitch    = self->pitch;
+
+	return true;
+}
+
+/**
+ * Send the updates of the World's players that changed since the last tick,
+ * the observers are corked by the tick so each gets one write however many
+ * players it sees moving.
+ */
+static
+void
+cdsurvival_MovementTick (SVWorld* world)
+{
+	size_t waiting = 0;
+
+	pthread_mutex_lock(&_movement.lock);
+	CD_VECTOR_FOREACH(_movement.queue, i) {
+		CDSurvivalMovement* mover = (CDSurvivalMovement*) CD_VectorGet(_movement.queue, i);
+		CDVector*           seen  = (CDVector*) CD_DynamicGetSlot(mover->player, _slot.seenPlayers);
+		SVPacket            packet;
+		CDSharedBuffer*     data;
+
+		union {
+			SVPacketEntityTeleport     teleport;
+			SVPacketEntityLookMove     lookMove;
+			SVPacketEntityRelativeMove relativeMove;
+			SVPacketEntityLook         look;
+		} pkt;
+
+		// Players of other worlds stay queued for their own world's tick, and
+		// players the tick couldn't pin for the next one or their logout
+		if (mover->player->world != world || !mover->player->pinned) {
+			_movement.queue->item[waiting++] = (CDPointer) mover;
+			continue;
+		}
+
+		mover->queued = false;
+
+		if (!seen || !cdsurvival_MovementPacket(mover, &packet, (CDPointer) &pkt)) {
+			continue;
+		}
+
+		data = SV_PacketToSharedBuffer(&packet);
+
+		CD_VectorReadLock(seen);
+		CD_VECTOR_FOREACH(seen, j) {
+			SVPlayer* observer = (SVPlayer*) CD_VectorGet(seen, j);
+
+			if (observer != mover->player) {
+				SV_PlayerSendShared(observer, data);
+			}
+		}
+		CD_VectorUnlock(seen);
+
+		CD_ReleaseSharedBuffer(data);
+	}
+
+	_movement.queue->length = waiting;
+	pthread_mutex_unlock(&_movement.lock);
+}
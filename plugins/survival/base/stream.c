@@ -0,0 +1,447 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * Asynchronous chunk streaming.
+ *
+ * Every player has a stream with the chunks it still has to receive, sent
+ * nearest first. Chunks go through the worker pool in stages: loading (disk or
+ * map generation), then serialization and compression, then they're queued on
+ * the client output by reference. The number of chunks in the pipeline and the
+ * bytes queued but not yet written are capped per player, so a slow link stops
+ * the stream instead of piling up memory.
+ *
+ * @inmodule Survival
+ */
+
+typedef struct _CDSurvivalChunkStream {
+	CDServer* server;
+	SVPlayer* player;
+	SVWorld*  world;
+
+	CDSurvivalChunkView view;
+
+	/// CDSurvivalChunkRequest waiting to enter the pipeline, nearest last
+	CDVector* pending;
+
+	/// Chunks in the pipeline
+	int working;
+
+	/// Bytes queued on the client output and not yet written
+	size_t inflight;
+	bool   stalled;
+
+	bool closed;
+	int  references;
+
+	struct {
+		pthread_mutex_t    state;
+		pthread_spinlock_t counters;
+	} lock;
+} CDSurvivalChunkStream;
+
+typedef struct _CDSurvivalChunkRequest {
+	CDSurvivalChunkStream* stream;
+
+	SVChunkPosition position;
+	int             distance;
+
+	SVChunk*       chunk;
+	SVChunkPacket* packet;
+} CDSurvivalChunkRequest;
+
+static void cdsurvival_ChunkStreamPump (CDSurvivalChunkStream* self);
+
+static
+CDSurvivalChunkStream*
+cdsurvival_CreateChunkStream (SVPlayer* player)
+{
+	CDSurvivalChunkStream* self = CD_malloc(sizeof(CDSurvivalChunkStream));
+
+	if (pthread_mutex_init(&self->lock.state, NULL) != 0) {
+		CD_abort("pthread mutex failed to initialize");
+	}
+
+	if (pthread_spin_init(&self->lock.counters, 0) != 0) {
+		CD_abort("pthread spinlock failed to initialize");
+	}
+
+	self->server = player->client->server;
+	self->player = player;
+	self->world  = player->world;
+
+	self->view.center.x = 0;
+	self->view.center.z = 0;
+	self->view.radius   = 0;
+
+	self->pending    = CD_CreateVector();
+	self->working    = 0;
+	self->inflight   = 0;
+	self->stalled    = false;
+	self->closed     = false;
+	self->references = 1;
+
+	return self;
+}
+
+static
+CDSurvivalChunkStream*
+cdsurvival_ChunkStreamRetain (CDSurvivalChunkStream* self)
+{
+	pthread_spin_lock(&self->lock.counters);
+	self->references++;
+	pthread_spin_unlock(&self->lock.counters);
+
+	return self;
+}
+
+static
+void
+cdsurvival_ChunkStreamRelease (CDSurvivalChunkStream* self)
+{
+	int references;
+
+	pthread_spin_lock(&self->lock.counters);
+	references = --self->references;
+	pthread_spin_unlock(&self->lock.counters);
+
+	if (references > 0) {
+		return;
+	}
+
+	CD_VECTOR_FOREACH(self->pending, i) {
+		CD_free((void*) CD_VectorGet(self->pending, i));
+	}
+
+	CD_DestroyVector(self->pending);
+
+	pthread_mutex_destroy(&self->lock.state);
+	pthread_spin_destroy(&self->lock.counters);
+
+	CD_free(self);
+}
+
+/**
+ * Stop the stream, the chunks still in the pipeline are dropped and the player
+ * isn't touched anymore.
+ */
+static
+void
+cdsurvival_ChunkStreamClose (CDSurvivalChunkStream* self)
+{
+	pthread_mutex_lock(&self->lock.state);
+	self->closed = true;
+	pthread_mutex_unlock(&self->lock.state);
+
+	cdsurvival_ChunkStreamRelease(self);
+}
+
+static
+void
+cdsurvival_ChunkRequestDone (CDSurvivalChunkRequest* request)
+{
+	CDSurvivalChunkStream* stream = request->stream;
+
+	if (request->chunk) {
+		SV_WorldReleaseChunk(stream->world, request->chunk);
+	}
+
+	if (request->packet) {
+		SV_ReleaseChunkPacket(request->packet);
+	}
+
+	CD_free(request);
+
+	pthread_mutex_lock(&stream->lock.state);
+	stream->working--;
+	cdsurvival_ChunkStreamPump(stream);
+	pthread_mutex_unlock(&stream->lock.state);
+
+	cdsurvival_ChunkStreamRelease(stream);
+}
+
+static
+bool
+cdsurvival_ChunkRequestWanted (CDSurvivalChunkRequest* request)
+{
+	CDSurvivalChunkStream* stream = request->stream;
+	bool                   result;
+
+	pthread_mutex_lock(&stream->lock.state);
+	result = !stream->closed && cdsurvival_ChunkViewHas(&stream->view, &request->position);
+	pthread_mutex_unlock(&stream->lock.state);
+
+	return result;
+}
+
+static
+void
+cdsurvival_ChunkStreamSchedule (CDSurvivalChunkStream* self, CDCustomJobCallback callback, CDPointer data)
+{
+	CD_AddJob(self->server->workers, CD_CreateJob(CDCustomJob,
+		(CDPointer) CD_CreateCustomJob(callback, data)));
+}
+
+static
+void
+cdsurvival_ChunkStreamResume (CDSurvivalChunkStream* self)
+{
+	pthread_mutex_lock(&self->lock.state);
+	cdsurvival_ChunkStreamPump(self);
+	pthread_mutex_unlock(&self->lock.state);
+
+	cdsurvival_ChunkStreamRelease(self);
+}
+
+static
+void
+cdsurvival_ChunkStreamDrained (const void* data, size_t length, void* context)
+{
+	CDSurvivalChunkRequest* request = (CDSurvivalChunkRequest*) context;
+	CDSurvivalChunkStream*  stream  = request->stream;
+	bool                    resume  = false;
+
+	SV_ReleaseChunkPacket(request->packet);
+	CD_free(request);
+
+	pthread_spin_lock(&stream->lock.counters);
+	stream->inflight -= length;
+
+	if (stream->stalled && stream->inflight < _config.chunks.inflight) {
+		stream->stalled = false;
+		resume          = true;
+	}
+	pthread_spin_unlock(&stream->lock.counters);
+
+	// This can be called from the event loop, so the stream lock can't be
+	// taken here and the pump goes through the workers
+	if (resume) {
+		cdsurvival_ChunkStreamSchedule(stream, (CDCustomJobCallback) cdsurvival_ChunkStreamResume,
+			(CDPointer) cdsurvival_ChunkStreamRetain(stream));
+	}
+
+	cdsurvival_ChunkStreamRelease(stream);
+}
+
+/**
+ * Last stage, the packet goes on the client output unless the chunk left the
+ * view in the meantime.
+ *
+ * The view check and the sends happen under the stream lock, so the unload of
+ * a chunk leaving the view can't get ahead of its data.
+ */
+static
+void
+cdsurvival_ChunkStreamDeliver (CDSurvivalChunkRequest* request)
+{
+	CDSurvivalChunkStream*  stream   = request->stream;
+	CDSurvivalChunkRequest* delivery = NULL;
+
+	pthread_mutex_lock(&stream->lock.state);
+	if (!stream->closed && cdsurvival_ChunkViewHas(&stream->view, &request->position)) {
+		DO {
+			SVPacketPreChunk pkt = {
+				.response = {
+					.position = request->position,
+					.mode     = true
+				}
+			};
+
+			SVPacket response = { SVResponse, SVPreChunk, (CDPointer) &pkt };
+
+			SV_PlayerSendPacketAndCleanData(stream->player, &response);
+		}
+
+		delivery         = CD_malloc(sizeof(CDSurvivalChunkRequest));
+		*delivery        = *request;
+		delivery->stream = cdsurvival_ChunkStreamRetain(stream);
+		delivery->chunk  = NULL;
+
+		request->packet = NULL;
+
+		pthread_spin_lock(&stream->lock.counters);
+		stream->inflight += delivery->packet->length;
+		pthread_spin_unlock(&stream->lock.counters);
+
+		CD_ClientSendReference(stream->player->client, (CDPointer) delivery->packet->data, delivery->packet->length,
+			cdsurvival_ChunkStreamDrained, (CDPointer) delivery);
+	}
+	pthread_mutex_unlock(&stream->lock.state);
+
+	cdsurvival_ChunkRequestDone(request);
+}
+
+/**
+ * Second stage, serialize and compress the chunk, cached packets make this
+ * free for chunks already sent to someone else.
+ */
+static
+void
+cdsurvival_ChunkStreamEncode (CDSurvivalChunkRequest* request)
+{
+	if (!cdsurvival_ChunkRequestWanted(request)) {
+		cdsurvival_ChunkRequestDone(request);
+
+		return;
+	}
+
+	request->packet = SV_WorldGetChunkPacket(request->stream->world, request->position.x, request->position.z);
+
+	SV_WorldReleaseChunk(request->stream->world, request->chunk);
+	request->chunk = NULL;
+
+	if (!request->packet) {
+		SERR(request->stream->server, "could not build chunk (%d, %d)", request->position.x, request->position.z);
+
+		cdsurvival_ChunkRequestDone(request);
+
+		return;
+	}
+
+	cdsurvival_ChunkStreamDeliver(request);
+}
+
+/**
+ * First stage, get the chunk in memory, from the cache, the disk or the map
+ * generator.
+ */
+static
+void
+cdsurvival_ChunkStreamLoad (CDSurvivalChunkRequest* request)
+{
+	if (!cdsurvival_ChunkRequestWanted(request)) {
+		cdsurvival_ChunkRequestDone(request);
+
+		return;
+	}
+
+	request->chunk = SV_WorldGetChunk(request->stream->world, request->position.x, request->position.z);
+
+	if (!request->chunk) {
+		SERR(request->stream->server, "could not load chunk (%d, %d)", request->position.x, request->position.z);
+
+		cdsurvival_ChunkRequestDone(request);
+
+		return;
+	}
+
+	cdsurvival_ChunkStreamSchedule(request->stream, (CDCustomJobCallback) cdsurvival_ChunkStreamEncode, (CDPointer) request);
+}
+
+/**
+ * Feed the pipeline with the nearest pending chunks, must be called with the
+ * state lock held.
+ */
+static
+void
+cdsurvival_ChunkStreamPump (CDSurvivalChunkStream* self)
+{
+	while (!self->closed && self->working < _config.chunks.concurrent && CD_VectorLength(self->pending) > 0) {
+		bool full;
+
+		pthread_spin_lock(&self->lock.counters);
+		if ((full = self->inflight >= _config.chunks.inflight)) {
+			self->stalled = true;
+		}
+		pthread_spin_unlock(&self->lock.counters);
+
+		if (full) {
+			break;
+		}
+
+		CDSurvivalChunkRequest* request = (CDSurvivalChunkRequest*) CD_VectorPop(self->pending);
+
+		request->stream = cdsurvival_ChunkStreamRetain(self);
+		self->working++;
+
+		cdsurvival_ChunkStreamSchedule(self, (CDCustomJobCallback) cdsurvival_ChunkStreamLoad, (CDPointer) request);
+	}
+}
+
+static
+int
+cdsurvival_ChunkRequestCompare (const void* a, const void* b)
+{
+	return (*(CDSurvivalChunkRequest**) b)->distance - (*(CDSurvivalChunkRequest**) a)->distance;
+}
+
+static
+void
+cdsurvival_ChunkStreamQueue (SVChunkPosition* position, CDSurvivalChunkStream* self)
+{
+	CDSurvivalChunkRequest* request = CD_alloc(sizeof(CDSurvivalChunkRequest));
+
+	request->position = *position;
+
+	CD_VectorPush(self->pending, (CDPointer) request);
+}
+
+/**
+ * Move the view of the stream and queue the chunks that entered it, pending
+ * chunks that left the view are dropped and the rest is sorted from the new
+ * center, farthest first so the nearest one is popped next.
+ */
+static
+void
+cdsurvival_ChunkStreamMove (CDSurvivalChunkStream* self, CDSurvivalChunkView* view)
+{
+	CDSurvivalChunkView old;
+	size_t              kept = 0;
+
+	pthread_mutex_lock(&self->lock.state);
+
+	old        = self->view;
+	self->view = *view;
+
+	CD_VECTOR_FOREACH(self->pending, i) {
+		CDSurvivalChunkRequest* request = (CDSurvivalChunkRequest*) CD_VectorGet(self->pending, i);
+
+		if (cdsurvival_ChunkViewHas(view, &request->position)) {
+			self->pending->item[kept++] = (CDPointer) request;
+		}
+		else {
+			CD_free(request);
+		}
+	}
+
+	self->pending->length = kept;
+
+	cdsurvival_ChunkViewMinus(view, &old, (CDSurvivalChunkViewApply) cdsurvival_ChunkStreamQueue, (CDPointer) self);
+
+	CD_VECTOR_FOREACH(self->pending, i) {
+		CDSurvivalChunkRequest* request = (CDSurvivalChunkRequest*) CD_VectorGet(self->pending, i);
+
+		int x = request->position.x - view->center.x;
+		int z = request->position.z - view->center.z;
+
+		request->distance = x * x + z * z;
+	}
+
+	qsort(self->pending->item, CD_VectorLength(self->pending), sizeof(CDPointer), cdsurvival_ChunkRequestCompare);
+
+	cdsurvival_ChunkStreamPump(self);
+
+	pthread_mutex_unlock(&self->lock.state);
+}
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * The chunks a player has loaded, a circle of radius chunks around center.
+ *
+ * A view is only its center and radius, the chunks in it follow from those.
+ * Moving a view walks the rows of both circles and reports the spans that
+ * differ, so a one chunk move touches the chunks entering and leaving at the
+ * edges and nothing gets allocated.
+ *
+ * @inmodule Survival
+ */
+
+typedef struct _CDSurvivalChunkView {
+	SVChunkPosition center;
+
+	/// 0 when no chunk is in the view
+	int radius;
+} CDSurvivalChunkView;
+
+typedef void (*CDSurvivalChunkViewApply) (SVChunkPosition* position, CDPointer context);
+
+static
+bool
+cdsurvival_ChunkViewHas (CDSurvivalChunkView* self, SVChunkPosition* position)
+{
+	int x = position->x - self->center.x;
+	int z = position->z - self->center.z;
+
+	return x >= -self->radius && x < self->radius && z >= -self->radius && z < self->radius &&
+		(x * x + z * z) <= (self->radius * self->radius);
+}
+
+/**
+ * Get the z span of the view on the row x, false when the row is outside
+ * the view
+ */
+static
+bool
+cdsurvival_ChunkViewRow (CDSurvivalChunkView* self, int x, int* first, int* last)
+{
+	int distance = x - self->center.x;
+	int left;
+	int half = 0;
+
+	if (distance < -self->radius || distance >= self->radius) {
+		return false;
+	}
+
+	// Integer square root, the widest z distance still inside the circle
+	left = self->radius * self->radius - distance * distance;
+
+	for (int bit = 1 << 14; bit > 0; bit >>= 1) {
+		if ((half + bit) * (half + bit) <= left) {
+			half += bit;
+		}
+	}
+
+	*first = self->center.z - half;
+	*last  = self->center.z + CD_Min(half, self->radius - 1);
+
+	return true;
+}
+
+/**
+ * Call apply on every chunk in the view a and not in the view b
+ */
+static
+void
+cdsurvival_ChunkViewMinus (CDSurvivalChunkView* a, CDSurvivalChunkView* b, CDSurvivalChunkViewApply apply, CDPointer context)
+{
+	for (int x = a->center.x - a->radius; x < a->center.x + a->radius; x++) {
+		int  first, last;
+		int  skipFirst, skipLast;
+		bool skip;
+
+		if (!cdsurvival_ChunkViewRow(a, x, &first, &last)) {
+			continue;
+		}
+
+		skip = cdsurvival_ChunkViewRow(b, x, &skipFirst, &skipLast);
+
+		for (int z = first; z <= last; z++) {
+			if (skip && z >= skipFirst && z <= skipLast) {
+				z = skipLast;
+
+				continue;
+			}
+
+			SVChunkPosition position = { x, z };
+
+			apply(&position, context);
+		}
+	}
+}
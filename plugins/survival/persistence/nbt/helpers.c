@@ -96,7 +96,10 @@ cdnbt_GenerateChunk (SVWorld* world, int x, int z, SVChunk* chunk, const char* s
 
 	CD_EventDispatchWithError(status, world->server, "Mapgen.chunk", world, x, z, chunk, seed);
 
-	// TODO: save the generated chunk
+	// Marking it changed gets it saved, so it's generated only once
+	if (status == CDOk) {
+		SV_WorldTouchChunk(world, chunk);
+	}
 
 	end: {
 		CD_DestroyString(chunkPath);
@@ -106,6 +109,116 @@ cdnbt_GenerateChunk (SVWorld* world, int x, int z, SVChunk* chunk, const char* s
 	return status;
 }
 
+static inline
+void
+cdnbt_WriteTag (gzFile file, nbt_type type, const char* name)
+{
+	uint8_t header[] = { type, (strlen(name) >> 8) & 0xff, strlen(name) & 0xff };
+
+	gzwrite(file, header, sizeof(header));
+	gzwrite(file, name, strlen(name));
+}
+
+static inline
+void
+cdnbt_WriteInt (gzFile file, uint32_t value)
+{
+	uint8_t data[] = { (value >> 24) & 0xff, (value >> 16) & 0xff, (value >> 8) & 0xff, value & 0xff };
+
+	gzwrite(file, data, sizeof(data));
+}
+
+static inline
+void
+cdnbt_WriteByteArray (gzFile file, const char* name, uint8_t* data, size_t length)
+{
+	cdnbt_WriteTag(file, TAG_BYTE_ARRAY, name);
+	cdnbt_WriteInt(file, length);
+
+	gzwrite(file, data, length);
+}
+
+/**
+ * Write a chunk next to its file, the written file has to be moved in place
+ * with cdnbt_CommitChunk.
+ *
+ * @return The path of the written file or NULL on failure
+ */
+static
+CDString*
+cdnbt_WriteChunk (SVWorld* world, SVChunk* chunk)
+{
+	CDString* chunkPath = cdnbt_ChunkPath(world, chunk->position.x, chunk->position.z);
+	CDString* directory = CD_StringDirname(chunkPath);
+	CDString* result    = CD_CreateStringFromFormat("%s.tmp", CD_StringContent(chunkPath));
+	gzFile    file;
+	uint8_t   end       = TAG_END;
+	uint8_t   populated = 1;
+
+	CD_mkdir(CD_StringContent(directory), 0755);
+
+	CD_DestroyString(directory);
+	CD_DestroyString(chunkPath);
+
+	if (!(file = gzopen(CD_StringContent(result), "wb"))) {
+		CD_DestroyString(result);
+
+		return NULL;
+	}
+
+	cdnbt_WriteTag(file, TAG_COMPOUND, "");
+	cdnbt_WriteTag(file, TAG_COMPOUND, "Level");
+
+	cdnbt_WriteTag(file, TAG_INT, "xPos");
+	cdnbt_WriteInt(file, chunk->position.x);
+
+	cdnbt_WriteTag(file, TAG_INT, "zPos");
+	cdnbt_WriteInt(file, chunk->position.z);
+
+	cdnbt_WriteTag(file, TAG_BYTE, "TerrainPopulated");
+	gzwrite(file, &populated, 1);
+
+	cdnbt_WriteByteArray(file, "Blocks",     chunk->blocks,     32768);
+	cdnbt_WriteByteArray(file, "Data",       chunk->data,       16384);
+	cdnbt_WriteByteArray(file, "SkyLight",   chunk->skyLight,   16384);
+	cdnbt_WriteByteArray(file, "BlockLight", chunk->blockLight, 16384);
+	cdnbt_WriteByteArray(file, "HeightMap",  chunk->heightMap,  256);
+
+	gzwrite(file, &end, 1);
+	gzwrite(file, &end, 1);
+
+	if (gzclose(file) != Z_OK) {
+		unlink(CD_StringContent(result));
+		CD_DestroyString(result);
+
+		return NULL;
+	}
+
+	return result;
+}
+
+/**
+ * Sync a file written by cdnbt_WriteChunk and move it over the chunk file
+ */
+static
+bool
+cdnbt_CommitChunk (CDString* path)
+{
+	CDString* chunkPath = CD_CreateStringFromBufferCopy(CD_StringContent(path), CD_StringSize(path) - 4);
+	int       fd        = open(CD_StringContent(path), O_RDONLY);
+	bool      result    = false;
+
+	if (fd >= 0) {
+		result = fsync(fd) == 0 && rename(CD_StringContent(path), CD_StringContent(chunkPath)) == 0;
+
+		close(fd);
+	}
+
+	CD_DestroyString(chunkPath);
+
+	return result;
+}
+
 static
 int8_t
 cdnbt_ObjectNotWatched (CDList* self, CDPointer data)
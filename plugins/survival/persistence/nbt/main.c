@@ -25,6 +25,7 @@
 
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <zlib.h>
 
 #include <craftd/Server.h>
 #include <craftd/Plugin.h>
@@ -50,6 +51,9 @@ cdnbt_WorldCreate (CDServer* server, SVWorld* world)
 	CDString* path  = CD_CreateStringFromFormat("%s/%s/level.dat", _config.path, CD_StringContent(world->name));
 	nbt_node* root  = nbt_parse_path(CD_StringContent(path));
 
+	// Chunks written and waiting for the next World.save to be synced
+	CD_DynamicPut(world, "NBT.written", (CDPointer) CD_CreateList());
+
 	if (!root || errno != NBT_OK || !cdnbt_ValidLevel(root)) {
 		goto error;
 	}
@@ -162,15 +166,40 @@ cdnbt_WorldGetChunk (CDServer* server, SVWorld* world, int x, int z, SVChunk* ch
 
 static
 bool
-cdnbt_WorldSetChunk (CDServer* server, SVWorld* world, int x, int z, SVChunk* chunk)
+cdnbt_WorldSetChunk (CDServer* server, SVWorld* world, int x, int z, SVChunk* chunk, CDError* error)
 {
+	CDString* written = cdnbt_WriteChunk(world, chunk);
+
+	if (!written) {
+		WERR(world, "could not save chunk (%d, %d): %s", x, z, strerror(errno));
+
+		*error = 1;
+
+		return true;
+	}
+
+	CD_ListPush((CDList*) CD_DynamicGet(world, "NBT.written"), (CDPointer) written);
+
 	return true;
 }
 
 static
 bool
-cdnbt_WorldSave (CDServer* server, SVWorld* world)
+cdnbt_WorldSave (CDServer* server, SVWorld* world, CDError* error)
 {
+	CDList*   written = (CDList*) CD_DynamicGet(world, "NBT.written");
+	CDString* path;
+
+	while ((path = (CDString*) CD_ListShift(written))) {
+		if (!cdnbt_CommitChunk(path)) {
+			WERR(world, "could not commit '%s': %s", CD_StringContent(path), strerror(errno));
+
+			*error = 1;
+		}
+
+		CD_DestroyString(path);
+	}
+
 	return true;
 }
 
@@ -178,6 +207,12 @@ static
 bool
 cdnbt_WorldDestroy (CDServer* server, SVWorld* world)
 {
+	CDError error = CDOk;
+
+	cdnbt_WorldSave(server, world, &error);
+
+	CD_DestroyList((CDList*) CD_DynamicDelete(world, "NBT.written"));
+
 	return true;
 }
 
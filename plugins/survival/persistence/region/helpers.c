@@ -0,0 +1,432 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * A minimal NBT reader and writer, it only knows what's needed to read and
+ * write chunks and levels.
+ */
+
+typedef enum _CDRegionTagType {
+	CDTagEnd,
+	CDTagByte,
+	CDTagShort,
+	CDTagInt,
+	CDTagLong,
+	CDTagFloat,
+	CDTagDouble,
+	CDTagByteArray,
+	CDTagString,
+	CDTagList,
+	CDTagCompound,
+	CDTagIntArray
+} CDRegionTagType;
+
+static inline
+uint16_t
+cdregion_ReadShort (const uint8_t* data)
+{
+	return (data[0] << 8) | data[1];
+}
+
+static inline
+uint32_t
+cdregion_ReadInt (const uint8_t* data)
+{
+	return ((uint32_t) data[0] << 24) | ((uint32_t) data[1] << 16) | ((uint32_t) data[2] << 8) | data[3];
+}
+
+static inline
+uint64_t
+cdregion_ReadLong (const uint8_t* data)
+{
+	return ((uint64_t) cdregion_ReadInt(data) << 32) | cdregion_ReadInt(data + 4);
+}
+
+static inline
+void
+cdregion_WriteInt (uint8_t* data, uint32_t value)
+{
+	data[0] = value >> 24;
+	data[1] = value >> 16;
+	data[2] = value >> 8;
+	data[3] = value;
+}
+
+/**
+ * Skip the payload of a tag
+ *
+ * @return A pointer past the payload or NULL if the data is truncated or invalid
+ */
+static
+const uint8_t*
+cdregion_TagSkip (uint8_t type, const uint8_t* data, const uint8_t* end)
+{
+	#define CHECK(length) if ((size_t) (end - data) < (size_t) (length)) return NULL
+
+	switch (type) {
+		case CDTagByte:   CHECK(1); return data + 1;
+		case CDTagShort:  CHECK(2); return data + 2;
+		case CDTagInt:    CHECK(4); return data + 4;
+		case CDTagLong:   CHECK(8); return data + 8;
+		case CDTagFloat:  CHECK(4); return data + 4;
+		case CDTagDouble: CHECK(8); return data + 8;
+
+		case CDTagByteArray: {
+			CHECK(4); CHECK(4 + (size_t) cdregion_ReadInt(data));
+
+			return data + 4 + cdregion_ReadInt(data);
+		}
+
+		case CDTagIntArray: {
+			CHECK(4); CHECK(4 + (size_t) cdregion_ReadInt(data) * 4);
+
+			return data + 4 + (size_t) cdregion_ReadInt(data) * 4;
+		}
+
+		case CDTagString: {
+			CHECK(2); CHECK(2 + cdregion_ReadShort(data));
+
+			return data + 2 + cdregion_ReadShort(data);
+		}
+
+		case CDTagList: {
+			CHECK(5);
+
+			uint8_t  inner  = data[0];
+			uint32_t length = cdregion_ReadInt(data + 1);
+
+			data += 5;
+
+			for (uint32_t i = 0; i < length && data; i++) {
+				data = cdregion_TagSkip(inner, data, end);
+			}
+
+			return data;
+		}
+
+		case CDTagCompound: {
+			while (data) {
+				CHECK(1);
+
+				uint8_t inner = *data++;
+
+				if (inner == CDTagEnd) {
+					return data;
+				}
+
+				CHECK(2); CHECK(2 + cdregion_ReadShort(data));
+
+				data = cdregion_TagSkip(inner, data + 2 + cdregion_ReadShort(data), end);
+			}
+
+			return NULL;
+		}
+
+		default: {
+			return NULL;
+		}
+	}
+
+	#undef CHECK
+}
+
+/**
+ * Find a tag in an uncompressed NBT document
+ *
+ * @param path The dot separated names of the tag starting from the root compound, like "Level.Blocks"
+ * @param type Where to put the type of the found tag
+ *
+ * @return A pointer to the payload of the tag or NULL if it wasn't found
+ */
+static
+const uint8_t*
+cdregion_TagFind (const uint8_t* data, size_t length, const char* path, uint8_t* type)
+{
+	const uint8_t* end = data + length;
+
+	if (length < 3 || data[0] != CDTagCompound || (size_t) (3 + cdregion_ReadShort(data + 1)) > length) {
+		return NULL;
+	}
+
+	data += 3 + cdregion_ReadShort(data + 1);
+
+	while (true) {
+		const char* next = strchr(path, '.');
+		size_t      size = next ? (size_t) (next - path) : strlen(path);
+		bool        found = false;
+
+		while (data && !found) {
+			if (data >= end || *data == CDTagEnd || end - data < 3) {
+				return NULL;
+			}
+
+			uint8_t  inner = data[0];
+			uint16_t name  = cdregion_ReadShort(data + 1);
+
+			if ((size_t) (end - data) < 3 + (size_t) name) {
+				return NULL;
+			}
+
+			if (name == size && memcmp(data + 3, path, size) == 0) {
+				found = true;
+				*type = inner;
+			}
+
+			data += 3 + name;
+
+			if (!found) {
+				data = cdregion_TagSkip(inner, data, end);
+			}
+		}
+
+		if (!found) {
+			return NULL;
+		}
+
+		if (!next) {
+			return data;
+		}
+
+		if (*type != CDTagCompound) {
+			return NULL;
+		}
+
+		path = next + 1;
+	}
+}
+
+/**
+ * Copy a byte array tag of exactly the given size
+ */
+static
+bool
+cdregion_TagCopyByteArray (const uint8_t* data, size_t length, const char* path, uint8_t* destination, size_t size)
+{
+	uint8_t        type;
+	const uint8_t* payload = cdregion_TagFind(data, length, path, &type);
+
+	if (!payload || type != CDTagByteArray || cdregion_ReadInt(payload) != size) {
+		return false;
+	}
+
+	memcpy(destination, payload + 4, size);
+
+	return true;
+}
+
+/**
+ * Read a chunk from an uncompressed NBT document
+ */
+static
+bool
+cdregion_ChunkFromNBT (const uint8_t* data, size_t length, SVChunk* chunk)
+{
+	return cdregion_TagCopyByteArray(data, length, "Level.HeightMap",  chunk->heightMap,  256)
+	    && cdregion_TagCopyByteArray(data, length, "Level.Blocks",     chunk->blocks,     32768)
+	    && cdregion_TagCopyByteArray(data, length, "Level.Data",       chunk->data,       16384)
+	    && cdregion_TagCopyByteArray(data, length, "Level.BlockLight", chunk->blockLight, 16384)
+	    && cdregion_TagCopyByteArray(data, length, "Level.SkyLight",   chunk->skyLight,   16384);
+}
+
+static inline
+void
+cdregion_BufferAddTag (CDBuffer* buffer, CDRegionTagType type, const char* name)
+{
+	uint16_t length = strlen(name);
+	uint8_t  header[3] = { type, length >> 8, length };
+
+	CD_BufferAdd(buffer, (CDPointer) header, 3);
+	CD_BufferAdd(buffer, (CDPointer) name, length);
+}
+
+static inline
+void
+cdregion_BufferAddInt (CDBuffer* buffer, uint32_t value)
+{
+	uint8_t data[4];
+
+	cdregion_WriteInt(data, value);
+
+	CD_BufferAdd(buffer, (CDPointer) data, 4);
+}
+
+static inline
+void
+cdregion_BufferAddByteArray (CDBuffer* buffer, const char* name, uint8_t* data, size_t length)
+{
+	cdregion_BufferAddTag(buffer, CDTagByteArray, name);
+	cdregion_BufferAddInt(buffer, length);
+
+	CD_BufferAdd(buffer, (CDPointer) data, length);
+}
+
+/**
+ * Serialize a chunk to an uncompressed NBT document, in the layout used by
+ * the Minecraft chunk files
+ */
+static
+CDBuffer*
+cdregion_ChunkToNBT (SVChunk* chunk)
+{
+	CDBuffer* buffer = CD_CreateBuffer();
+	uint8_t   end    = CDTagEnd;
+	uint8_t   flag   = 1;
+
+	cdregion_BufferAddTag(buffer, CDTagCompound, "");
+	cdregion_BufferAddTag(buffer, CDTagCompound, "Level");
+
+	cdregion_BufferAddTag(buffer, CDTagInt, "xPos");
+	cdregion_BufferAddInt(buffer, chunk->position.x);
+
+	cdregion_BufferAddTag(buffer, CDTagInt, "zPos");
+	cdregion_BufferAddInt(buffer, chunk->position.z);
+
+	cdregion_BufferAddTag(buffer, CDTagByte, "TerrainPopulated");
+	CD_BufferAdd(buffer, (CDPointer) &flag, 1);
+
+	cdregion_BufferAddTag(buffer, CDTagLong, "LastUpdate");
+	cdregion_BufferAddInt(buffer, 0);
+	cdregion_BufferAddInt(buffer, 0);
+
+	cdregion_BufferAddByteArray(buffer, "Blocks",     chunk->blocks,     32768);
+	cdregion_BufferAddByteArray(buffer, "Data",       chunk->data,       16384);
+	cdregion_BufferAddByteArray(buffer, "SkyLight",   chunk->skyLight,   16384);
+	cdregion_BufferAddByteArray(buffer, "BlockLight", chunk->blockLight, 16384);
+	cdregion_BufferAddByteArray(buffer, "HeightMap",  chunk->heightMap,  256);
+
+	DO {
+		uint8_t list[5] = { CDTagCompound, 0, 0, 0, 0 };
+
+		cdregion_BufferAddTag(buffer, CDTagList, "Entities");
+		CD_BufferAdd(buffer, (CDPointer) list, 5);
+
+		cdregion_BufferAddTag(buffer, CDTagList, "TileEntities");
+		CD_BufferAdd(buffer, (CDPointer) list, 5);
+	}
+
+	CD_BufferAdd(buffer, (CDPointer) &end, 1);
+	CD_BufferAdd(buffer, (CDPointer) &end, 1);
+
+	return buffer;
+}
+
+/**
+ * Inflate zlib or gzip data
+ *
+ * @return The inflated data, to be freed with CD_free, or NULL on failure
+ */
+static
+uint8_t*
+cdregion_Inflate (const uint8_t* data, size_t length, size_t* inflated)
+{
+	z_stream stream;
+	size_t   size   = length * 4 + 1024;
+	uint8_t* result = CD_malloc(size);
+
+	memset(&stream, 0, sizeof(stream));
+
+	// 32 enables zlib and gzip header detection
+	if (inflateInit2(&stream, 15 + 32) != Z_OK) {
+		CD_free(result);
+
+		return NULL;
+	}
+
+	stream.next_in  = (Bytef*) data;
+	stream.avail_in = length;
+
+	while (true) {
+		stream.next_out  = result + stream.total_out;
+		stream.avail_out = size - stream.total_out;
+
+		int status = inflate(&stream, Z_NO_FLUSH);
+
+		if (status == Z_STREAM_END) {
+			break;
+		}
+
+		if (status != Z_OK && status != Z_BUF_ERROR) {
+			inflateEnd(&stream);
+			CD_free(result);
+
+			return NULL;
+		}
+
+		if (stream.avail_out == 0) {
+			result = CD_realloc(result, size *= 2);
+		}
+		else if (stream.avail_in == 0) {
+			inflateEnd(&stream);
+			CD_free(result);
+
+			return NULL;
+		}
+	}
+
+	*inflated = stream.total_out;
+
+	inflateEnd(&stream);
+
+	return result;
+}
+
+/**
+ * Read a whole file in memory
+ *
+ * @return The content, to be freed with CD_free, or NULL on failure
+ */
+static
+uint8_t*
+cdregion_ReadFile (const char* path, size_t* length)
+{
+	struct stat info;
+	uint8_t*    result;
+	int         fd;
+
+	if ((fd = open(path, O_RDONLY)) < 0) {
+		return NULL;
+	}
+
+	if (fstat(fd, &info) != 0) {
+		close(fd);
+
+		return NULL;
+	}
+
+	result = CD_malloc(info.st_size + 1);
+
+	if (read(fd, result, info.st_size) != info.st_size) {
+		CD_free(result);
+		close(fd);
+
+		return NULL;
+	}
+
+	close(fd);
+
+	*length = info.st_size;
+
+	return result;
+}
@@ -0,0 +1,412 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <time.h>
+#include <zlib.h>
+
+#include <craftd/Server.h>
+#include <craftd/Plugin.h>
+
+#include <craftd/protocols/survival.h>
+
+static struct {
+	const char* path;
+
+	bool convert;
+	int  base;
+} _config;
+
+static struct {
+	pthread_mutex_t files;
+} _lock;
+
+#include "helpers.c"
+#include "region.c"
+
+/**
+ * Get the region file holding the given chunk, opening it if needed
+ */
+static
+CDRegionFile*
+cdregion_WorldFile (SVWorld* world, int x, int z)
+{
+	CDServer*     server = world->server;
+	CDRegionFile* result;
+	CDMap*        files;
+
+	pthread_mutex_lock(&_lock.files);
+
+	if (!(files = (CDMap*) CD_DynamicGet(world, "Region.files"))) {
+		CD_DynamicPut(world, "Region.files", (CDPointer) (files = CD_CreateMap()));
+	}
+
+	if (!(result = (CDRegionFile*) CD_MapGet(files, cdregion_FileId(x, z)))) {
+		CDString* path = CD_CreateStringFromFormat("%s/%s/region/r.%d.%d.mcr",
+			_config.path, CD_StringContent(world->name), x >> 5, z >> 5);
+
+		CDString* directory = CD_StringDirname(path);
+
+		CD_mkdir(CD_StringContent(directory), 0755);
+
+		if ((result = cdregion_OpenFile(CD_StringContent(path)))) {
+			CD_MapPut(files, cdregion_FileId(x, z), (CDPointer) result);
+		}
+		else {
+			WERR(world, "could not open region file '%s': %s", CD_StringContent(path), strerror(errno));
+		}
+
+		CD_DestroyString(directory);
+		CD_DestroyString(path);
+	}
+
+	pthread_mutex_unlock(&_lock.files);
+
+	return result;
+}
+
+static
+bool
+cdregion_WorldWriteChunk (SVWorld* world, SVChunk* chunk)
+{
+	CDRegionFile* file = cdregion_WorldFile(world, chunk->position.x, chunk->position.z);
+
+	if (!file) {
+		return false;
+	}
+
+	CDBuffer* buffer = cdregion_ChunkToNBT(chunk);
+	uint8_t*  data   = (uint8_t*) CD_BufferContent(buffer);
+	bool      result = cdregion_FileWrite(file, chunk->position.x, chunk->position.z, data, CD_BufferLength(buffer));
+
+	CD_free(data);
+	CD_DestroyBuffer(buffer);
+
+	return result;
+}
+
+/**
+ * Import the chunks from the one file per chunk layout of the nbt persistence
+ * plugin, chunks already in a region file are left alone.
+ *
+ * @return The number of converted chunks
+ */
+static
+size_t
+cdregion_WorldConvert (SVWorld* world)
+{
+	CDServer* server = world->server;
+	CDString* root   = CD_CreateStringFromFormat("%s/%s", _config.path, CD_StringContent(world->name));
+	size_t    result = 0;
+	DIR*      first;
+	DIR*      second;
+	DIR*      files;
+
+	if (!(first = opendir(CD_StringContent(root)))) {
+		CD_DestroyString(root);
+
+		return 0;
+	}
+
+	for (struct dirent* a = readdir(first); a; a = readdir(first)) {
+		if (a->d_name[0] == '.' || CD_CStringIsEqual(a->d_name, "region")) {
+			continue;
+		}
+
+		CDString* aPath = CD_CreateStringFromFormat("%s/%s", CD_StringContent(root), a->d_name);
+
+		if ((second = opendir(CD_StringContent(aPath)))) {
+			for (struct dirent* b = readdir(second); b; b = readdir(second)) {
+				if (b->d_name[0] == '.') {
+					continue;
+				}
+
+				CDString* bPath = CD_CreateStringFromFormat("%s/%s", CD_StringContent(aPath), b->d_name);
+
+				if ((files = opendir(CD_StringContent(bPath)))) {
+					for (struct dirent* file = readdir(files); file; file = readdir(files)) {
+						char  name[256];
+						char* x;
+						char* z;
+						char* end;
+
+						strncpy(name, file->d_name, sizeof(name) - 1);
+						name[sizeof(name) - 1] = '\0';
+
+						// c.<x>.<z>.dat with coordinates in the configured base
+						if (strncmp(name, "c.", 2) != 0 || !(x = strtok(name + 2, ".")) || !(z = strtok(NULL, ".")) || !(end = strtok(NULL, ".")) || !CD_CStringIsEqual(end, "dat")) {
+							continue;
+						}
+
+						SVChunkPosition position = {
+							.x = strtol(x, NULL, _config.base),
+							.z = strtol(z, NULL, _config.base)
+						};
+
+						CDRegionFile* region = cdregion_WorldFile(world, position.x, position.z);
+
+						if (!region || region->locations[cdregion_Index(position.x, position.z)]) {
+							continue;
+						}
+
+						CDString* path = CD_CreateStringFromFormat("%s/%s", CD_StringContent(bPath), file->d_name);
+						size_t    length;
+						size_t    inflated;
+						uint8_t*  compressed;
+						uint8_t*  data = NULL;
+
+						if ((compressed = cdregion_ReadFile(CD_StringContent(path), &length))) {
+							data = cdregion_Inflate(compressed, length, &inflated);
+						}
+
+						if (data && cdregion_FileWrite(region, position.x, position.z, data, inflated)) {
+							result++;
+						}
+						else {
+							WERR(world, "could not convert '%s'", CD_StringContent(path));
+						}
+
+						CD_free(compressed);
+						CD_free(data);
+						CD_DestroyString(path);
+					}
+
+					closedir(files);
+				}
+
+				CD_DestroyString(bPath);
+			}
+
+			closedir(second);
+		}
+
+		CD_DestroyString(aPath);
+	}
+
+	closedir(first);
+
+	CD_DestroyString(root);
+
+	return result;
+}
+
+static
+bool
+cdregion_WorldCreate (CDServer* server, SVWorld* world)
+{
+	CDString* path = CD_CreateStringFromFormat("%s/%s/level.dat", _config.path, CD_StringContent(world->name));
+	size_t    length;
+	size_t    inflated;
+	uint8_t*  compressed = cdregion_ReadFile(CD_StringContent(path), &length);
+	uint8_t*  data       = NULL;
+
+	if (compressed) {
+		data = cdregion_Inflate(compressed, length, &inflated);
+	}
+
+	DO {
+		const uint8_t* spawn[3];
+		const uint8_t* time;
+		uint8_t        types[4];
+
+		if (!data
+		||  !(spawn[0] = cdregion_TagFind(data, inflated, "Data.SpawnX", &types[0])) || types[0] != CDTagInt
+		||  !(spawn[1] = cdregion_TagFind(data, inflated, "Data.SpawnY", &types[1])) || types[1] != CDTagInt
+		||  !(spawn[2] = cdregion_TagFind(data, inflated, "Data.SpawnZ", &types[2])) || types[2] != CDTagInt
+		||  !(time     = cdregion_TagFind(data, inflated, "Data.Time",   &types[3])) || types[3] != CDTagLong) {
+			CDError status;
+
+			CD_EventDispatchWithError(status, server, "Mapgen.level", world, NULL);
+
+			if (status != CDOk) {
+				WERR(world, "Couldn't load world base data from '%s'", CD_StringContent(path));
+			}
+
+			break;
+		}
+
+		world->spawnPosition = (SVBlockPosition) {
+			.x = (int32_t) cdregion_ReadInt(spawn[0]),
+			.y = (int32_t) cdregion_ReadInt(spawn[1]),
+			.z = (int32_t) cdregion_ReadInt(spawn[2])
+		};
+
+		SV_WorldSetTime(world, cdregion_ReadLong(time));
+	}
+
+	WDEBUG(world, "spawn position: (%d, %d, %d)",
+		world->spawnPosition.x,
+		world->spawnPosition.y,
+		world->spawnPosition.z);
+
+	if (_config.convert) {
+		WLOG(world, LOG_NOTICE, "converted %zu chunks to region files", cdregion_WorldConvert(world));
+	}
+
+	CD_free(compressed);
+	CD_free(data);
+	CD_DestroyString(path);
+
+	return true;
+}
+
+static
+bool
+cdregion_WorldGetChunk (CDServer* server, SVWorld* world, int x, int z, SVChunk* chunk, CDError* error)
+{
+	CDRegionFile* file = cdregion_WorldFile(world, x, z);
+	uint8_t*      data = NULL;
+	size_t        length;
+
+	if (file && (data = cdregion_FileRead(file, x, z, &length)) && cdregion_ChunkFromNBT(data, length, chunk)) {
+		CD_free(data);
+
+		return true;
+	}
+
+	CD_free(data);
+
+	CDError status;
+
+	CD_EventDispatchWithError(status, world->server, "Mapgen.chunk", world, x, z, chunk, NULL);
+
+	if (status != CDOk) {
+		WERR(world, "could not load or generate chunk (%d, %d)", x, z);
+
+		*error = status;
+
+		return true;
+	}
+
+	WDEBUG(world, "generated chunk: %d,%d", x, z);
+
+	// Marking it changed gets it saved, so it's generated only once
+	SV_WorldTouchChunk(world, chunk);
+
+	return true;
+}
+
+static
+bool
+cdregion_WorldSetChunk (CDServer* server, SVWorld* world, int x, int z, SVChunk* chunk, CDError* error)
+{
+	if (!cdregion_WorldWriteChunk(world, chunk)) {
+		WERR(world, "could not save chunk (%d, %d)", x, z);
+
+		*error = 1;
+	}
+
+	return true;
+}
+
+static
+bool
+cdregion_WorldSave (CDServer* server, SVWorld* world, CDError* error)
+{
+	CDMap* files = (CDMap*) CD_DynamicGet(world, "Region.files");
+
+	// Syncing only here groups the syncs of a whole batch of chunks
+	if (files) {
+		CD_MAP_FOREACH(files, it) {
+			CDRegionFile* file = (CDRegionFile*) CD_MapIteratorValue(it);
+
+			if (fdatasync(file->fd) != 0) {
+				WERR(world, "could not sync region file: %s", strerror(errno));
+
+				*error = 1;
+			}
+		}
+	}
+
+	return true;
+}
+
+static
+bool
+cdregion_WorldDestroy (CDServer* server, SVWorld* world)
+{
+	CDMap* files = (CDMap*) CD_DynamicDelete(world, "Region.files");
+
+	if (files) {
+		CD_MAP_FOREACH(files, it) {
+			cdregion_DestroyFile((CDRegionFile*) CD_MapIteratorValue(it));
+		}
+
+		CD_DestroyMap(files);
+	}
+
+	return true;
+}
+
+extern
+bool
+CD_PluginInitialize (CDPlugin* self)
+{
+	self->description = CD_CreateStringFromCString("Region File Persistence");
+
+	DO { // Initialize configuration stuff
+		_config.path    = "/usr/share/craftd/worlds";
+		_config.convert = false;
+		_config.base    = 36;
+
+		C_SAVE(C_PATH(self->config, "path"), C_STRING, _config.path);
+		C_SAVE(C_PATH(self->config, "convert"), C_BOOL, _config.convert);
+		C_SAVE(C_PATH(self->config, "base"), C_INT, _config.base);
+	}
+
+	if (pthread_mutex_init(&_lock.files, NULL) != 0) {
+		CD_abort("pthread mutex failed to initialize");
+	}
+
+	CD_EventRegister(self->server, "World.create",  cdregion_WorldCreate);
+	CD_EventRegister(self->server, "World.chunk",   cdregion_WorldGetChunk);
+	CD_EventRegister(self->server, "World.chunk=",  cdregion_WorldSetChunk);
+	CD_EventRegister(self->server, "World.save",    cdregion_WorldSave);
+	CD_EventRegister(self->server, "World.destroy", cdregion_WorldDestroy);
+
+	CD_EventProvides(self->server, "Persistence.initialized", CD_CreateEventParameters("CDPlugin", NULL));
+
+	CD_EventDispatch(self->server, "Persistence.initialized", self);
+
+	return true;
+}
+
+extern
+bool
+CD_PluginFinalize (CDPlugin* self)
+{
+	CD_EventUnregister(self->server, "World.create",  cdregion_WorldCreate);
+	CD_EventUnregister(self->server, "World.chunk",   cdregion_WorldGetChunk);
+	CD_EventUnregister(self->server, "World.chunk=",  cdregion_WorldSetChunk);
+	CD_EventUnregister(self->server, "World.save",    cdregion_WorldSave);
+	CD_EventUnregister(self->server, "World.destroy", cdregion_WorldDestroy);
+
+	pthread_mutex_destroy(&_lock.files);
+
+	return true;
+}
@@ -0,0 +1,370 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * Region files, each one holds 32x32 chunks.
+ *
+ * The file starts with two tables of 1024 big endian integers, the first has
+ * the location of every chunk (sector offset in the upper 24 bits and sector
+ * count in the lower 8), the second has the time of its last write. Sectors
+ * are 4096 bytes, a chunk starts with its length, then the compression type
+ * and the compressed NBT data.
+ *
+ * The file is memory mapped for reading, writes go through pwrite.
+ */
+
+#define CDREGION_SECTOR      4096
+#define CDREGION_HEADER      2
+#define CDREGION_CHUNKS      1024
+#define CDREGION_MAX_SECTORS 255
+
+typedef enum _CDRegionCompression {
+	CDRegionGZip = 1,
+	CDRegionZlib = 2
+} CDRegionCompression;
+
+typedef struct _CDRegionFile {
+	int fd;
+
+	uint8_t* map;
+	size_t   mapped;
+
+	uint32_t locations[CDREGION_CHUNKS];
+
+	/// Which sectors are used, one byte per sector
+	uint8_t* used;
+	size_t   sectors;
+
+	pthread_rwlock_t lock;
+} CDRegionFile;
+
+static inline
+int
+cdregion_Index (int x, int z)
+{
+	return (x & 31) + (z & 31) * 32;
+}
+
+static inline
+CDMapId
+cdregion_FileId (int x, int z)
+{
+	SVChunkPosition position = { x >> 5, z >> 5 };
+
+	return SV_ChunkPositionToId(position);
+}
+
+/**
+ * Map the whole file, must be called with the write lock held or before the
+ * file is shared
+ */
+static
+bool
+cdregion_FileMap (CDRegionFile* self)
+{
+	struct stat info;
+
+	if (fstat(self->fd, &info) != 0) {
+		return false;
+	}
+
+	if (self->map) {
+		munmap(self->map, self->mapped);
+
+		self->map    = NULL;
+		self->mapped = 0;
+	}
+
+	if (info.st_size == 0) {
+		return true;
+	}
+
+	if ((self->map = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, self->fd, 0)) == MAP_FAILED) {
+		self->map = NULL;
+
+		return false;
+	}
+
+	self->mapped = info.st_size;
+
+	return true;
+}
+
+static
+void
+cdregion_DestroyFile (CDRegionFile* self)
+{
+	if (self->map) {
+		munmap(self->map, self->mapped);
+	}
+
+	close(self->fd);
+
+	pthread_rwlock_destroy(&self->lock);
+
+	CD_free(self->used);
+	CD_free(self);
+}
+
+static
+CDRegionFile*
+cdregion_OpenFile (const char* path)
+{
+	CDRegionFile* self = CD_alloc(sizeof(CDRegionFile));
+	struct stat   info;
+
+	if ((self->fd = open(path, O_RDWR | O_CREAT, 0644)) < 0) {
+		CD_free(self);
+
+		return NULL;
+	}
+
+	if (pthread_rwlock_init(&self->lock, NULL) != 0) {
+		CD_abort("pthread rwlock failed to initialize");
+	}
+
+	if (fstat(self->fd, &info) != 0) {
+		goto error;
+	}
+
+	// New or truncated files get an empty header
+	if (info.st_size < CDREGION_HEADER * CDREGION_SECTOR) {
+		static const uint8_t header[CDREGION_HEADER * CDREGION_SECTOR];
+
+		if (pwrite(self->fd, header, sizeof(header), 0) != sizeof(header)) {
+			goto error;
+		}
+	}
+
+	// Keep the file sector aligned
+	if (fstat(self->fd, &info) != 0) {
+		goto error;
+	}
+
+	if (info.st_size % CDREGION_SECTOR != 0) {
+		if (ftruncate(self->fd, (info.st_size / CDREGION_SECTOR + 1) * CDREGION_SECTOR) != 0) {
+			goto error;
+		}
+	}
+
+	if (!cdregion_FileMap(self)) {
+		goto error;
+	}
+
+	self->sectors = self->mapped / CDREGION_SECTOR;
+	self->used    = CD_alloc(self->sectors);
+
+	for (size_t i = 0; i < CDREGION_HEADER; i++) {
+		self->used[i] = 1;
+	}
+
+	for (int i = 0; i < CDREGION_CHUNKS; i++) {
+		uint32_t location = cdregion_ReadInt(self->map + i * 4);
+		uint32_t offset   = location >> 8;
+		uint32_t count    = location & 0xFF;
+
+		if (location == 0 || offset < CDREGION_HEADER || offset + count > self->sectors) {
+			self->locations[i] = 0;
+
+			continue;
+		}
+
+		self->locations[i] = location;
+
+		for (uint32_t sector = offset; sector < offset + count; sector++) {
+			self->used[sector] = 1;
+		}
+	}
+
+	return self;
+
+	error: {
+		cdregion_DestroyFile(self);
+
+		return NULL;
+	}
+}
+
+/**
+ * Read the uncompressed NBT document of a chunk
+ *
+ * @return The document, to be freed with CD_free, or NULL if the chunk isn't there
+ */
+static
+uint8_t*
+cdregion_FileRead (CDRegionFile* self, int x, int z, size_t* length)
+{
+	uint8_t* result = NULL;
+
+	pthread_rwlock_rdlock(&self->lock);
+
+	DO {
+		uint32_t location = self->locations[cdregion_Index(x, z)];
+		size_t   offset   = (size_t) (location >> 8) * CDREGION_SECTOR;
+		size_t   size     = (size_t) (location & 0xFF) * CDREGION_SECTOR;
+
+		if (location == 0 || offset + size > self->mapped) {
+			break;
+		}
+
+		uint8_t* data    = self->map + offset;
+		uint32_t written = cdregion_ReadInt(data);
+
+		if (written < 1 || written + 4 > size) {
+			break;
+		}
+
+		if (data[4] != CDRegionZlib && data[4] != CDRegionGZip) {
+			break;
+		}
+
+		result = cdregion_Inflate(data + 5, written - 1, length);
+	}
+
+	pthread_rwlock_unlock(&self->lock);
+
+	return result;
+}
+
+/**
+ * Find a run of free sectors, extending the file if needed, must be called
+ * with the write lock held
+ */
+static
+size_t
+cdregion_FileAllocate (CDRegionFile* self, size_t count)
+{
+	size_t run = 0;
+
+	for (size_t i = CDREGION_HEADER; i < self->sectors; i++) {
+		run = self->used[i] ? 0 : run + 1;
+
+		if (run == count) {
+			return i - count + 1;
+		}
+	}
+
+	// Extend the file, reusing the free sectors at its end
+	size_t result = self->sectors - run;
+
+	self->sectors = result + count;
+	self->used    = CD_realloc(self->used, self->sectors);
+
+	memset(self->used + result, 0, count);
+
+	return result;
+}
+
+/**
+ * Write the uncompressed NBT document of a chunk
+ */
+static
+bool
+cdregion_FileWrite (CDRegionFile* self, int x, int z, const uint8_t* data, size_t length)
+{
+	uLongf   size       = compressBound(length);
+	uint8_t* compressed = CD_malloc(size + 5);
+	bool     result     = false;
+	int      index      = cdregion_Index(x, z);
+
+	if (compress2(compressed + 5, &size, data, length, Z_DEFAULT_COMPRESSION) != Z_OK) {
+		CD_free(compressed);
+
+		return false;
+	}
+
+	cdregion_WriteInt(compressed, size + 1);
+	compressed[4] = CDRegionZlib;
+
+	size_t count = (size + 5 + CDREGION_SECTOR - 1) / CDREGION_SECTOR;
+
+	if (count > CDREGION_MAX_SECTORS) {
+		CD_free(compressed);
+
+		errno = EFBIG;
+
+		return false;
+	}
+
+	pthread_rwlock_wrlock(&self->lock);
+
+	DO {
+		uint32_t location = self->locations[index];
+		size_t   previous = location >> 8;
+		size_t   current  = location & 0xFF;
+		size_t   offset;
+
+		// The old sectors stay in use until the header points to the new ones, so
+		// a failed or torn write leaves the old chunk readable
+		offset = cdregion_FileAllocate(self, count);
+
+		for (size_t sector = offset; sector < offset + count; sector++) {
+			self->used[sector] = 1;
+		}
+
+		// Pad the last sector so the file stays sector aligned
+		compressed = CD_realloc(compressed, count * CDREGION_SECTOR);
+		memset(compressed + size + 5, 0, count * CDREGION_SECTOR - (size + 5));
+
+		uint8_t header[4];
+
+		cdregion_WriteInt(header, (offset << 8) | count);
+
+		// The data goes first, the location only points to it once it's there
+		if (pwrite(self->fd, compressed, count * CDREGION_SECTOR, offset * CDREGION_SECTOR) != (ssize_t) (count * CDREGION_SECTOR)
+		||  pwrite(self->fd, header, 4, index * 4) != 4) {
+			for (size_t sector = offset; sector < offset + count; sector++) {
+				self->used[sector] = 0;
+			}
+
+			break;
+		}
+
+		self->locations[index] = (offset << 8) | count;
+
+		for (size_t sector = previous; location && sector < previous + current; sector++) {
+			self->used[sector] = 0;
+		}
+
+		// The chunk is already saved, a stale timestamp only gets logged
+		cdregion_WriteInt(header, time(NULL));
+
+		if (pwrite(self->fd, header, 4, CDREGION_SECTOR + index * 4) != 4) {
+			ERR("could not write the timestamp of chunk (%d, %d): %s", x, z, strerror(errno));
+		}
+
+		if ((offset + count) * CDREGION_SECTOR > self->mapped) {
+			cdregion_FileMap(self);
+		}
+
+		result = true;
+	}
+
+	pthread_rwlock_unlock(&self->lock);
+
+	CD_free(compressed);
+
+	return result;
+}
@@ -33,6 +33,17 @@
 
 CDServer* _server = NULL;
 
+static inline
+double
+cdtest_Elapsed (struct timespec* start)
+{
+	struct timespec end;
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
 static
 void
 cdtest_String_fromBuffer (void* data)
@@ -82,9 +93,100 @@ cdtest_String_UTF8_charAt (void* data)
 	}
 }
 
+static
+void
+cdtest_String_UTF8_valid (void* data)
+{
+	tt_assert(CD_UTF8_valid("Æ§Ð plain text", 17));
+	tt_assert(CD_UTF8_valid("\xf0\x9f\x98\x80", 4));
+
+	tt_assert(!CD_UTF8_valid("\xc0\xaf", 2));         // overlong
+	tt_assert(!CD_UTF8_valid("\xed\xa0\x80", 3));     // surrogate
+	tt_assert(!CD_UTF8_valid("\xf4\x90\x80\x80", 4)); // past U+10FFFF
+	tt_assert(!CD_UTF8_valid("Æ\xc3", 3));             // truncated
+	tt_assert(!CD_UTF8_valid("a stray \x80 byte", 14));
+
+	end: {}
+}
+
+static
+void
+cdtest_String_UTF8_ascii (void* data)
+{
+	CDString* test  = CD_CreateStringFromCString("lol wut");
+	CDString* other = CD_CreateStringFromCString("Æ§Ð");
+	CDString* ch    = NULL;
+
+	tt_assert(test->ascii);
+	tt_assert(!other->ascii);
+
+	ch = CD_CharAt(test, 4);
+	tt_assert(CD_StringIsEqual(ch, "w"));
+
+	CD_AppendString(test, other);
+
+	tt_assert(!test->ascii);
+	tt_int_op(CD_StringLength(test), ==, 10);
+
+	end: {
+		CD_DestroyString(test);
+		CD_DestroyString(other);
+
+		if (ch) {
+			CD_DestroyString(ch);
+		}
+	}
+}
+
+#define CDTEST_UTF8_SIZE   (1 << 20)
+#define CDTEST_UTF8_ROUNDS 100
+
+static
+void
+cdtest_String_UTF8_benchmark (void* data)
+{
+	char*           text   = CD_malloc(CDTEST_UTF8_SIZE + 1);
+	size_t          length = 0;
+	bool            valid  = true;
+	struct timespec start;
+	double          count, check;
+
+	// Mostly ASCII with a two byte character every 64 bytes, like chat
+	for (size_t i = 0; i < CDTEST_UTF8_SIZE; i += 64) {
+		memset(text + i, 'a', 62);
+		memcpy(text + i + 62, "Æ", 2);
+	}
+
+	text[CDTEST_UTF8_SIZE] = '\0';
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int round = 0; round < CDTEST_UTF8_ROUNDS; round++) {
+		length += CD_UTF8_strnlen(text, CDTEST_UTF8_SIZE);
+	}
+	count = cdtest_Elapsed(&start);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int round = 0; round < CDTEST_UTF8_ROUNDS; round++) {
+		valid = valid && CD_UTF8_valid(text, CDTEST_UTF8_SIZE);
+	}
+	check = cdtest_Elapsed(&start);
+
+	tt_int_op(length, ==, (size_t) CDTEST_UTF8_ROUNDS * (CDTEST_UTF8_SIZE - CDTEST_UTF8_SIZE / 64));
+	tt_assert(valid);
+
+	printf("\n%d MB: count %.3fs, validate %.3fs\n", CDTEST_UTF8_ROUNDS * CDTEST_UTF8_SIZE >> 20, count, check);
+
+	end: {
+		CD_free(text);
+	}
+}
+
 static struct testcase_t cd_utils_String_UTF8_tests[] = {
-	{ "length", cdtest_String_UTF8_length, },
-	{ "charAt", cdtest_String_UTF8_charAt, },
+	{ "length",    cdtest_String_UTF8_length, },
+	{ "charAt",    cdtest_String_UTF8_charAt, },
+	{ "valid",     cdtest_String_UTF8_valid, },
+	{ "ascii",     cdtest_String_UTF8_ascii, },
+	{ "benchmark", cdtest_String_UTF8_benchmark, },
 
 	END_OF_TESTCASES
 };
@@ -120,9 +222,31 @@ cdtest_String_Minecraft_valid (void* data)
 	}
 }
 
+static
+void
+cdtest_String_Minecraft_UTF16 (void* data)
+{
+	CDString* string = CD_CreateStringFromCString("hé⌂ƒ\xc1\x81ß§2x§x");
+	uint8_t   output[64];
+
+	const uint8_t expected[] = {
+		0x00, 'h', 0x00, 0xE9, 0x23, 0x02, 0x01, 0x92, 0x00, '?', 0x00, '?', 0x00, '?',
+		0x00, 0xA7, 0x00, '2', 0x00, 'x'
+	};
+
+	// The overlong sequence is two bad bytes and the trailing color code is cut
+	tt_int_op(SV_StringToUTF16(string, output), ==, sizeof(expected) / 2);
+	tt_assert(memcmp(output, expected, sizeof(expected)) == 0);
+
+	end: {
+		CD_DestroyString(string);
+	}
+}
+
 static struct testcase_t cd_utils_String_Minecraft_tests[] = {
 	{ "sanitize", cdtest_String_Minecraft_sanitize, },
 	{ "valid",    cdtest_String_Minecraft_valid, },
+	{ "UTF16",    cdtest_String_Minecraft_UTF16, },
 
 	END_OF_TESTCASES
 };
@@ -453,10 +577,919 @@ cdtest_Set_length (void* data)
 	}
 }
 
+static
+void
+cdtest_Set_grow (void* data)
+{
+	CDSet* set = CD_CreateSetWith(0, NULL, NULL);
+
+	for (CDPointer i = 1; i <= 10000; i++) {
+		CD_SetPut(set, i);
+	}
+
+	// Deleting shifts back the following values, they must stay reachable
+	for (CDPointer i = 1; i <= 10000; i += 2) {
+		tt_int_op(CD_SetDelete(set, i), ==, i);
+	}
+
+	tt_int_op(CD_SetLength(set), ==, 5000);
+
+	for (CDPointer i = 1; i <= 10000; i++) {
+		tt_int_op(CD_SetHas(set, i), ==, i % 2 == 0);
+	}
+
+	end: {
+		CD_DestroySet(set);
+	}
+}
+
+static
+void
+cdtest_Set_minus (void* data)
+{
+	SVChunkPosition positions[] = { { 0, 0 }, { 0, 1 }, { 1, 0 }, { -1, 0 } };
+	SVChunkPosition other       = { 0, 1 };
+
+	CDSet* a = CD_CreateSetWith(0, (CDSetCompare) SV_CompareChunkPosition, (CDSetHash) SV_HashChunkPosition);
+	CDSet* b = CD_CreateSetWith(0, (CDSetCompare) SV_CompareChunkPosition, (CDSetHash) SV_HashChunkPosition);
+	CDSet* result = NULL;
+
+	for (size_t i = 0; i < 4; i++) {
+		CD_SetPut(a, (CDPointer) &positions[i]);
+	}
+
+	CD_SetPut(b, (CDPointer) &other);
+
+	result = CD_SetMinus(a, b);
+
+	tt_int_op(CD_SetLength(result), ==, 3);
+	tt_assert(!CD_SetHas(result, (CDPointer) &other));
+	tt_assert(CD_SetHas(result, (CDPointer) &positions[3]));
+
+	end: {
+		CD_DestroySet(a);
+		CD_DestroySet(b);
+
+		if (result) {
+			CD_DestroySet(result);
+		}
+	}
+}
+
+/**
+ * Time putting, finding and diffing square areas of chunk positions, the way
+ * the view distance code uses the set
+ */
+static
+void
+cdtest_Set_benchmark (void* data)
+{
+	int sides[] = { 32, 100, 317 };
+
+	printf("\n");
+
+	for (size_t s = 0; s < sizeof(sides) / sizeof(int); s++) {
+		int              side      = sides[s];
+		int              length    = side * side;
+		SVChunkPosition* positions = CD_malloc(sizeof(SVChunkPosition) * length * 2);
+		CDSet*           a         = CD_CreateSetWith(0, (CDSetCompare) SV_CompareChunkPosition, (CDSetHash) SV_HashChunkPosition);
+		CDSet*           b         = CD_CreateSetWith(0, (CDSetCompare) SV_CompareChunkPosition, (CDSetHash) SV_HashChunkPosition);
+		CDSet*           minus;
+		int              found     = 0;
+		struct timespec  start;
+		double           put, has, diff;
+
+		// The second area is the first one moved by one chunk
+		for (int i = 0; i < length; i++) {
+			positions[i]          = (SVChunkPosition) { i / side - side / 2, i % side - side / 2 };
+			positions[length + i] = (SVChunkPosition) { positions[i].x + 1, positions[i].z };
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (int i = 0; i < length; i++) {
+			CD_SetPut(a, (CDPointer) &positions[i]);
+			CD_SetPut(b, (CDPointer) &positions[length + i]);
+		}
+		put = cdtest_Elapsed(&start);
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (int i = 0; i < length * 2; i++) {
+			found += CD_SetHas(a, (CDPointer) &positions[i]);
+		}
+		has = cdtest_Elapsed(&start);
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		minus = CD_SetMinus(a, b);
+		diff  = cdtest_Elapsed(&start);
+
+		printf("%d chunks: %d puts %.3fs, %d lookups %.3fs, minus %.3fs\n",
+			length, length * 2, put, length * 2, has, diff);
+
+		tt_int_op(found, ==, length * 2 - side);
+		tt_int_op(CD_SetLength(minus), ==, side);
+
+		CD_DestroySet(minus);
+		CD_DestroySet(a);
+		CD_DestroySet(b);
+		CD_free(positions);
+	}
+
+	end: {}
+}
+
 static struct testcase_t cd_utils_Set_tests[] = {
-	{ "put",    cdtest_Set_put, },
-	{ "delete", cdtest_Set_delete, },
-	{ "length", cdtest_Set_length, },
+	{ "put",       cdtest_Set_put, },
+	{ "delete",    cdtest_Set_delete, },
+	{ "length",    cdtest_Set_length, },
+	{ "grow",      cdtest_Set_grow, },
+	{ "minus",     cdtest_Set_minus, },
+	{ "benchmark", cdtest_Set_benchmark, },
+
+	END_OF_TESTCASES
+};
+
+static
+void
+cdtest_Vector_push (void* data)
+{
+	CDVector* vector = CD_CreateVector();
+
+	for (CDPointer i = 0; i < 100; i++) {
+		CD_VectorPush(vector, i);
+	}
+
+	tt_int_op(CD_VectorLength(vector), ==, 100);
+	tt_int_op(CD_VectorGet(vector, 42), ==, 42);
+	tt_int_op(CD_VectorPop(vector), ==, 99);
+	tt_int_op(CD_VectorLength(vector), ==, 99);
+
+	end: {
+		CD_DestroyVector(vector);
+	}
+}
+
+static
+void
+cdtest_Vector_delete (void* data)
+{
+	CDVector* vector = CD_CreateVector();
+
+	CD_VectorPush(vector, 23);
+	CD_VectorPush(vector, 42);
+	CD_VectorPush(vector, 9001);
+	CD_VectorPush(vector, 42);
+	CD_VectorPush(vector, 911);
+
+	tt_int_op(CD_VectorDeleteAll(vector, 42), ==, 2);
+	tt_int_op(CD_VectorLength(vector), ==, 3);
+	tt_assert(!CD_VectorContains(vector, 42));
+
+	tt_int_op(CD_VectorDeleteAt(vector, 0), ==, 23);
+	tt_int_op(CD_VectorGet(vector, 0), ==, 9001);
+
+	tt_int_op(CD_VectorDelete(vector, 9001), ==, 9001);
+	tt_int_op(CD_VectorDelete(vector, 9001), ==, CDNull);
+	tt_int_op(CD_VectorGet(vector, 0), ==, 911);
+
+	end: {
+		CD_DestroyVector(vector);
+	}
+}
+
+static
+void
+cdtest_Vector_foreach (void* data)
+{
+	CDVector* vector = CD_CreateVector();
+	int       total  = 0;
+
+	CD_VectorPush(vector, 23);
+	CD_VectorPush(vector, 42);
+	CD_VectorPush(vector, 9001);
+
+	CD_VECTOR_FOREACH(vector, i) {
+		total += CD_VectorGet(vector, i);
+	}
+
+	tt_int_op(total, ==, 23 + 42 + 9001);
+
+	end: {
+		CD_DestroyVector(vector);
+	}
+}
+
+#define CDTEST_VECTOR_VALUES 100000
+#define CDTEST_VECTOR_ROUNDS 100
+
+/**
+ * Compare List and Vector on the operations the hot containers do: pushing,
+ * walking every value and deleting values from the middle
+ */
+static
+void
+cdtest_Vector_benchmark (void* data)
+{
+	CDList*         list   = CD_CreateList();
+	CDVector*       vector = CD_CreateVector();
+	CDPointer       listTotal   = 0;
+	CDPointer       vectorTotal = 0;
+	struct timespec start;
+	double          push[2], iterate[2], delete[2];
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (CDPointer i = 1; i <= CDTEST_VECTOR_VALUES; i++) {
+		CD_ListPush(list, i);
+	}
+	push[0] = cdtest_Elapsed(&start);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (CDPointer i = 1; i <= CDTEST_VECTOR_VALUES; i++) {
+		CD_VectorPush(vector, i);
+	}
+	push[1] = cdtest_Elapsed(&start);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int round = 0; round < CDTEST_VECTOR_ROUNDS; round++) {
+		CD_LIST_FOREACH(list, it) {
+			listTotal += CD_ListIteratorValue(it);
+		}
+	}
+	iterate[0] = cdtest_Elapsed(&start);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int round = 0; round < CDTEST_VECTOR_ROUNDS; round++) {
+		CD_VECTOR_FOREACH(vector, i) {
+			vectorTotal += CD_VectorGet(vector, i);
+		}
+	}
+	iterate[1] = cdtest_Elapsed(&start);
+
+	tt_int_op(listTotal, ==, vectorTotal);
+
+	// Every thousandth value, so the searches go deep into the containers
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (CDPointer i = CDTEST_VECTOR_VALUES; i > 0; i -= 1000) {
+		CD_ListDelete(list, i);
+	}
+	delete[0] = cdtest_Elapsed(&start);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (CDPointer i = CDTEST_VECTOR_VALUES; i > 0; i -= 1000) {
+		CD_VectorDelete(vector, i);
+	}
+	delete[1] = cdtest_Elapsed(&start);
+
+	tt_int_op(CD_ListLength(list), ==, CD_VectorLength(vector));
+
+	printf("\n%d values: push list %.3fs vector %.3fs, %d walks list %.3fs vector %.3fs, %d deletes list %.3fs vector %.3fs\n",
+		CDTEST_VECTOR_VALUES, push[0], push[1], CDTEST_VECTOR_ROUNDS, iterate[0], iterate[1],
+		CDTEST_VECTOR_VALUES / 1000, delete[0], delete[1]);
+
+	end: {
+		CD_DestroyList(list);
+		CD_DestroyVector(vector);
+	}
+}
+
+static struct testcase_t cd_utils_Vector_tests[] = {
+	{ "push",      cdtest_Vector_push, },
+	{ "delete",    cdtest_Vector_delete, },
+	{ "foreach",   cdtest_Vector_foreach, },
+	{ "benchmark", cdtest_Vector_benchmark, },
+
+	END_OF_TESTCASES
+};
+
+static
+void
+cdtest_Queue_push (void* data)
+{
+	CDQueue* queue = CD_CreateQueue(4);
+
+	// The last ones go in the overflow
+	for (CDPointer i = 1; i <= 10; i++) {
+		CD_QueuePush(queue, i);
+	}
+
+	tt_int_op(CD_QueueLength(queue), ==, 10);
+
+	for (CDPointer i = 1; i <= 10; i++) {
+		tt_int_op(CD_QueueShift(queue), ==, i);
+	}
+
+	tt_assert(CD_QueueIsEmpty(queue));
+	tt_int_op(CD_QueueShift(queue), ==, CDNull);
+
+	end: {
+		CD_DestroyQueue(queue);
+	}
+}
+
+static
+void
+cdtest_Queue_shiftMany (void* data)
+{
+	CDQueue*  queue = CD_CreateQueue(16);
+	CDPointer values[8];
+
+	for (CDPointer i = 1; i <= 5; i++) {
+		CD_QueuePush(queue, i);
+	}
+
+	tt_int_op(CD_QueueShiftMany(queue, values, 8), ==, 5);
+	tt_int_op(values[0], ==, 1);
+	tt_int_op(values[4], ==, 5);
+
+	end: {
+		CD_DestroyQueue(queue);
+	}
+}
+
+#define CDTEST_QUEUE_THREADS 4
+#define CDTEST_QUEUE_VALUES  10000
+
+typedef struct _CDTestQueue {
+	CDQueue* queue;
+
+	/// The list, mutex and condition the workers used before CDQueue, for
+	/// comparison
+	CDList*         list;
+	pthread_mutex_t mutex;
+	pthread_cond_t  condition;
+
+	bool     running;
+	uint64_t total;
+} CDTestQueue;
+
+static
+void*
+cdtest_QueueProducer (CDTestQueue* test)
+{
+	for (CDPointer i = 1; i <= CDTEST_QUEUE_VALUES; i++) {
+		if (test->queue) {
+			CD_QueuePush(test->queue, i);
+		}
+		else {
+			pthread_mutex_lock(&test->mutex);
+			CD_ListPush(test->list, i);
+			pthread_cond_signal(&test->condition);
+			pthread_mutex_unlock(&test->mutex);
+		}
+	}
+
+	return NULL;
+}
+
+static
+void*
+cdtest_QueueConsumer (CDTestQueue* test)
+{
+	CDPointer values[CD_WORKERS_BATCH];
+	uint64_t  total = 0;
+	size_t    length;
+
+	while (true) {
+		if (test->queue) {
+			length = CD_QueueShiftMany(test->queue, values, CD_WORKERS_BATCH);
+		}
+		else {
+			pthread_mutex_lock(&test->mutex);
+			while (CD_ListLength(test->list) == 0 && __atomic_load_n(&test->running, __ATOMIC_SEQ_CST)) {
+				pthread_cond_wait(&test->condition, &test->mutex);
+			}
+
+			length = (values[0] = CD_ListShift(test->list)) ? 1 : 0;
+			pthread_mutex_unlock(&test->mutex);
+		}
+
+		if (length == 0) {
+			if (!__atomic_load_n(&test->running, __ATOMIC_SEQ_CST)) {
+				break;
+			}
+
+			if (test->queue) {
+				CD_QueueWait(test->queue, &test->running);
+			}
+
+			continue;
+		}
+
+		for (size_t i = 0; i < length; i++) {
+			total += values[i];
+		}
+	}
+
+	__atomic_add_fetch(&test->total, total, __ATOMIC_SEQ_CST);
+
+	return NULL;
+}
+
+/**
+ * Run producers and consumers on the queue, or on the list with a mutex and
+ * condition like the old workers if queue is NULL, and check every value came
+ * out once
+ *
+ * @return The elapsed seconds
+ */
+static
+double
+cdtest_QueueContend (CDQueue* queue)
+{
+	CDTestQueue     test = { queue, CD_CreateList() };
+	pthread_t       producers[CDTEST_QUEUE_THREADS];
+	pthread_t       consumers[CDTEST_QUEUE_THREADS];
+	struct timespec start;
+	struct timespec end;
+
+	pthread_mutex_init(&test.mutex, NULL);
+	pthread_cond_init(&test.condition, NULL);
+
+	test.running = true;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (int i = 0; i < CDTEST_QUEUE_THREADS; i++) {
+		pthread_create(&consumers[i], NULL, (void *(*)(void *)) cdtest_QueueConsumer, &test);
+		pthread_create(&producers[i], NULL, (void *(*)(void *)) cdtest_QueueProducer, &test);
+	}
+
+	for (int i = 0; i < CDTEST_QUEUE_THREADS; i++) {
+		pthread_join(producers[i], NULL);
+	}
+
+	__atomic_store_n(&test.running, false, __ATOMIC_SEQ_CST);
+
+	if (queue) {
+		CD_QueueWakeAll(queue);
+	}
+	else {
+		pthread_mutex_lock(&test.mutex);
+		pthread_cond_broadcast(&test.condition);
+		pthread_mutex_unlock(&test.mutex);
+	}
+
+	for (int i = 0; i < CDTEST_QUEUE_THREADS; i++) {
+		pthread_join(consumers[i], NULL);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	pthread_cond_destroy(&test.condition);
+	pthread_mutex_destroy(&test.mutex);
+	CD_DestroyList(test.list);
+
+	if (test.total != (uint64_t) CDTEST_QUEUE_THREADS * CDTEST_QUEUE_VALUES * (CDTEST_QUEUE_VALUES + 1) / 2) {
+		return -1;
+	}
+
+	return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+static
+void
+cdtest_Queue_contention (void* data)
+{
+	CDQueue* small  = CD_CreateQueue(CD_WORKERS_QUEUE);
+	CDQueue* large  = CD_CreateQueue(CDTEST_QUEUE_THREADS * CDTEST_QUEUE_VALUES);
+	double   locked = cdtest_QueueContend(NULL);
+	double   ring   = cdtest_QueueContend(large);
+	double   spill  = cdtest_QueueContend(small);
+
+	tt_assert(locked >= 0);
+	tt_assert(ring >= 0);
+	tt_assert(spill >= 0);
+
+	// The spilling run goes mostly through the overflow list, producers that
+	// never stop outrun any ring
+	printf("\n%d producers, %d consumers, %d values each: mutex and condition %.3fs, queue %.3fs, queue overflowing %.3fs\n",
+		CDTEST_QUEUE_THREADS, CDTEST_QUEUE_THREADS, CDTEST_QUEUE_VALUES, locked, ring, spill);
+
+	end: {
+		CD_DestroyQueue(small);
+		CD_DestroyQueue(large);
+	}
+}
+
+typedef struct _CDTestQueueWake {
+	CDQueue* queue;
+
+	bool   running;
+	size_t woken;
+} CDTestQueueWake;
+
+static
+void*
+cdtest_QueueSleeper (CDTestQueueWake* test)
+{
+	CD_QueueWait(test->queue, &test->running);
+
+	__atomic_add_fetch(&test->woken, 1, __ATOMIC_SEQ_CST);
+
+	return NULL;
+}
+
+static
+void
+cdtest_Queue_wake (void* data)
+{
+	CDTestQueueWake test = { CD_CreateQueue(16), true, 0 };
+	pthread_t       sleepers[CDTEST_QUEUE_THREADS];
+
+	for (int i = 0; i < CDTEST_QUEUE_THREADS; i++) {
+		pthread_create(&sleepers[i], NULL, (void *(*)(void *)) cdtest_QueueSleeper, &test);
+	}
+
+	while (__atomic_load_n(&test.queue->park.waiters, __ATOMIC_SEQ_CST) < CDTEST_QUEUE_THREADS) {
+		usleep(1000);
+	}
+
+	// Give the last one to count itself the time to park
+	usleep(10000);
+
+	for (CDPointer i = 1; i <= CDTEST_QUEUE_THREADS; i++) {
+		CD_QueuePush(test.queue, i);
+	}
+
+	for (int i = 0; i < 1000 && __atomic_load_n(&test.woken, __ATOMIC_SEQ_CST) < CDTEST_QUEUE_THREADS; i++) {
+		usleep(1000);
+	}
+
+	tt_int_op(__atomic_load_n(&test.woken, __ATOMIC_SEQ_CST), ==, CDTEST_QUEUE_THREADS);
+
+	end: {
+		__atomic_store_n(&test.running, false, __ATOMIC_SEQ_CST);
+		CD_QueueWakeAll(test.queue);
+
+		for (int i = 0; i < CDTEST_QUEUE_THREADS; i++) {
+			pthread_join(sleepers[i], NULL);
+		}
+
+		CD_DestroyQueue(test.queue);
+	}
+}
+
+static struct testcase_t cd_utils_Queue_tests[] = {
+	{ "push",       cdtest_Queue_push, },
+	{ "shift many", cdtest_Queue_shiftMany, },
+	{ "wake",       cdtest_Queue_wake, },
+	{ "contention", cdtest_Queue_contention, },
+
+	END_OF_TESTCASES
+};
+
+#define CDTEST_TIMELOOP_FIRED 16
+
+typedef struct _CDTestTimeLoop {
+	CDTimeLoop* loop;
+
+	/// Ticks the callback ran at and what it was passed, in order
+	size_t   length;
+	uint64_t ticks[CDTEST_TIMELOOP_FIRED];
+	int      tags[CDTEST_TIMELOOP_FIRED];
+} CDTestTimeLoop;
+
+typedef struct _CDTestTimer {
+	CDTestTimeLoop* test;
+
+	int tag;
+
+	/// The timer the callback clears, 0 for none
+	int clear;
+} CDTestTimer;
+
+static
+void
+cdtest_TimeLoopFired (evutil_socket_t fd, short event, CDTestTimer* timer)
+{
+	CDTestTimeLoop* test = timer->test;
+
+	if (test->length < CDTEST_TIMELOOP_FIRED) {
+		test->ticks[test->length] = test->loop->wheel.now;
+		test->tags[test->length]  = timer->tag;
+		test->length++;
+	}
+
+	if (timer->clear) {
+		CD_ClearInterval(test->loop, timer->clear);
+	}
+}
+
+/**
+ * Run the wheel one tick at a time, so every timer is seen at the tick it
+ * fires
+ */
+static
+void
+cdtest_TimeLoopStep (CDTimeLoop* loop, uint64_t ticks)
+{
+	for (uint64_t target = loop->wheel.now + ticks; loop->wheel.now < target;) {
+		CD_TimeLoopAdvance(loop, loop->wheel.now + 1);
+	}
+}
+
+static
+void
+cdtest_TimeLoop_order (void* data)
+{
+	CDTestTimeLoop test  = { CD_CreateTimeLoop(_server) };
+	CDTestTimer    timers[] = { { &test, 700 }, { &test, 5 }, { &test, 5000 }, { &test, 100 }, { &test, 30 }, { &test, 64 } };
+
+	// One per level, and more than one in the first two, added out of order
+	for (size_t i = 0; i < sizeof(timers) / sizeof(timers[0]); i++) {
+		CD_SetTimeout(test.loop, timers[i].tag / 100.0, (event_callback_fn) cdtest_TimeLoopFired, (CDPointer) &timers[i]);
+	}
+
+	// A single jump still runs them in the order they expire
+	CD_TimeLoopAdvance(test.loop, 5000);
+
+	tt_int_op(test.length, ==, 6);
+	tt_int_op(test.tags[0], ==, 5);
+	tt_int_op(test.tags[1], ==, 30);
+	tt_int_op(test.tags[2], ==, 64);
+	tt_int_op(test.tags[3], ==, 100);
+	tt_int_op(test.tags[4], ==, 700);
+	tt_int_op(test.tags[5], ==, 5000);
+
+	tt_int_op(CD_MapLength(test.loop->callbacks), ==, 0);
+
+	end: {
+		CD_DestroyTimeLoop(test.loop);
+	}
+}
+
+static
+void
+cdtest_TimeLoop_cascade (void* data)
+{
+	CDTestTimeLoop test  = { CD_CreateTimeLoop(_server) };
+	CDTestTimer    timers[] = { { &test, 130 }, { &test, 4096 }, { &test, 300000 } };
+
+	// Off a slot boundary, so the timers are cascaded before reaching theirs
+	cdtest_TimeLoopStep(test.loop, 37);
+
+	for (size_t i = 0; i < sizeof(timers) / sizeof(timers[0]); i++) {
+		CD_SetTimeout(test.loop, timers[i].tag / 100.0, (event_callback_fn) cdtest_TimeLoopFired, (CDPointer) &timers[i]);
+	}
+
+	cdtest_TimeLoopStep(test.loop, 37 + 130 - 1 - test.loop->wheel.now);
+	tt_int_op(test.length, ==, 0);
+
+	cdtest_TimeLoopStep(test.loop, 300000 + 37 - test.loop->wheel.now);
+
+	tt_int_op(test.length, ==, 3);
+	tt_int_op(test.ticks[0], ==, 37 + 130);
+	tt_int_op(test.ticks[1], ==, 37 + 4096);
+	tt_int_op(test.ticks[2], ==, 37 + 300000);
+
+	end: {
+		CD_DestroyTimeLoop(test.loop);
+	}
+}
+
+static
+void
+cdtest_TimeLoop_cascadeBoundary (void* data)
+{
+	CDTestTimeLoop test  = { CD_CreateTimeLoop(_server) };
+	CDTestTimer    timers[] = { { &test, 64 }, { &test, 4096 }, { &test, 262144 } };
+
+	// Each lands on the first slot of an upper level and expires on the tick
+	// that slot is cascaded
+	for (size_t i = 0; i < sizeof(timers) / sizeof(timers[0]); i++) {
+		CD_SetTimeout(test.loop, timers[i].tag / 100.0, (event_callback_fn) cdtest_TimeLoopFired, (CDPointer) &timers[i]);
+	}
+
+	cdtest_TimeLoopStep(test.loop, 262144);
+
+	tt_int_op(test.length, ==, 3);
+	tt_int_op(test.ticks[0], ==, 64);
+	tt_int_op(test.ticks[1], ==, 4096);
+	tt_int_op(test.ticks[2], ==, 262144);
+
+	end: {
+		CD_DestroyTimeLoop(test.loop);
+	}
+}
+
+static
+void
+cdtest_TimeLoop_clearInside (void* data)
+{
+	CDTestTimeLoop test  = { CD_CreateTimeLoop(_server) };
+	CDTestTimer    timer = { &test, 1 };
+	CDTestTimer    other = { &test, 2 };
+
+	timer.clear = CD_SetInterval(test.loop, 0.1, (event_callback_fn) cdtest_TimeLoopFired, (CDPointer) &timer);
+	other.clear = CD_SetTimeout(test.loop, 0.1, (event_callback_fn) cdtest_TimeLoopFired, (CDPointer) &other);
+
+	// Both expire in the same batch and clear themselves while running
+	cdtest_TimeLoopStep(test.loop, 10);
+
+	tt_int_op(test.length, ==, 2);
+
+	cdtest_TimeLoopStep(test.loop, 100);
+
+	tt_int_op(test.length, ==, 2);
+	tt_int_op(CD_MapLength(test.loop->callbacks), ==, 0);
+
+	end: {
+		CD_DestroyTimeLoop(test.loop);
+	}
+}
+
+static
+void
+cdtest_TimeLoop_interval (void* data)
+{
+	CDTestTimeLoop test  = { CD_CreateTimeLoop(_server) };
+	CDTestTimer    timer = { &test, 1 };
+	int            id;
+
+	id = CD_SetInterval(test.loop, 0.1, (event_callback_fn) cdtest_TimeLoopFired, (CDPointer) &timer);
+
+	cdtest_TimeLoopStep(test.loop, 55);
+
+	tt_int_op(test.length, ==, 5);
+
+	for (size_t i = 0; i < test.length; i++) {
+		tt_int_op(test.ticks[i], ==, (i + 1) * 10);
+	}
+
+	// A late run doesn't make up for the missed ones, the next keeps the phase
+	CD_TimeLoopAdvance(test.loop, 95);
+
+	tt_int_op(test.length, ==, 6);
+	tt_int_op(test.ticks[5], ==, 95);
+
+	cdtest_TimeLoopStep(test.loop, 4);
+	tt_int_op(test.length, ==, 6);
+
+	cdtest_TimeLoopStep(test.loop, 1);
+	tt_int_op(test.length, ==, 7);
+	tt_int_op(test.ticks[6], ==, 100);
+
+	CD_ClearInterval(test.loop, id);
+
+	cdtest_TimeLoopStep(test.loop, 50);
+
+	tt_int_op(test.length, ==, 7);
+	tt_int_op(CD_MapLength(test.loop->callbacks), ==, 0);
+
+	end: {
+		CD_DestroyTimeLoop(test.loop);
+	}
+}
+
+static struct testcase_t cd_utils_TimeLoop_tests[] = {
+	{ "order",        cdtest_TimeLoop_order, },
+	{ "cascade",      cdtest_TimeLoop_cascade, },
+	{ "boundary",     cdtest_TimeLoop_cascadeBoundary, },
+	{ "clear inside", cdtest_TimeLoop_clearInside, },
+	{ "interval",     cdtest_TimeLoop_interval, },
+
+	END_OF_TESTCASES
+};
+
+typedef struct _CDTestDynamic {
+	CD_DEFINE_DYNAMIC;
+} CDTestDynamic;
+
+static
+void
+cdtest_Dynamic_slot (void* data)
+{
+	CDTestDynamic object;
+	CDDynamicSlot slot = CD_DynamicSlot("Test.slot");
+
+	CD_InitDynamic(DYNAMIC(&object));
+
+	tt_int_op(slot, !=, 0);
+	tt_int_op(CD_DynamicSlot("Test.slot"), ==, slot);
+	tt_int_op(CD_DYNAMIC_SLOT("Test.slot"), ==, slot);
+
+	CD_DynamicPutSlot(&object, slot, 42);
+
+	// The names go through the same slots
+	tt_int_op(CD_DynamicGet(&object, "Test.slot"), ==, 42);
+	tt_int_op(CD_DynamicDelete(&object, "Test.slot"), ==, 42);
+	tt_int_op(CD_DynamicGetSlot(&object, slot), ==, CDNull);
+
+	end: {
+		CD_FinalizeDynamic(DYNAMIC(&object));
+	}
+}
+
+static
+void
+cdtest_Dynamic_name (void* data)
+{
+	CDTestDynamic object;
+
+	CD_InitDynamic(DYNAMIC(&object));
+
+	tt_int_op(CD_DynamicFindSlot("Test.name"), ==, 0);
+	tt_int_op(CD_DynamicGet(&object, "Test.name"), ==, CDNull);
+
+	CD_DynamicPut(&object, "Test.name", 9001);
+
+	tt_int_op(CD_DynamicFindSlot("Test.name"), !=, 0);
+	tt_int_op(CD_DynamicGetSlot(&object, CD_DynamicFindSlot("Test.name")), ==, 9001);
+
+	end: {
+		CD_FinalizeDynamic(DYNAMIC(&object));
+	}
+}
+
+static
+void
+cdtest_Dynamic_overflow (void* data)
+{
+	CDTestDynamic object;
+	CDDynamicSlot slots[CD_DYNAMIC_SLOTS + 1];
+
+	CD_InitDynamic(DYNAMIC(&object));
+
+	// Whatever the other tests reserved, this goes past the inline slots
+	for (int i = 0; i <= CD_DYNAMIC_SLOTS; i++) {
+		char name[32];
+
+		snprintf(name, sizeof(name), "Test.overflow.%d", i);
+
+		tt_int_op((slots[i] = CD_DynamicSlot(name)), !=, 0);
+		tt_int_op(CD_DynamicSlot(name), ==, slots[i]);
+
+		CD_DynamicPutSlot(&object, slots[i], i + 1);
+	}
+
+	tt_int_op(slots[CD_DYNAMIC_SLOTS], >=, CD_DYNAMIC_SLOTS);
+
+	for (int i = 0; i <= CD_DYNAMIC_SLOTS; i++) {
+		tt_int_op(CD_DynamicGetSlot(&object, slots[i]), ==, i + 1);
+	}
+
+	// Nothing aliases the unused slot 0
+	tt_int_op(object._dynamic.slots[0], ==, CDNull);
+	tt_int_op(CD_DynamicGetSlot(&object, 0), ==, CDNull);
+
+	tt_int_op(CD_DynamicGet(&object, "Test.overflow.32"), ==, CD_DYNAMIC_SLOTS + 1);
+	tt_int_op(CD_DynamicDelete(&object, "Test.overflow.32"), ==, CD_DYNAMIC_SLOTS + 1);
+	tt_int_op(CD_DynamicGetSlot(&object, slots[CD_DYNAMIC_SLOTS]), ==, CDNull);
+
+	end: {
+		CD_FinalizeDynamic(DYNAMIC(&object));
+	}
+}
+
+#define CDTEST_DYNAMIC_LOOKUPS 10000000
+
+/**
+ * Compare a lookup in the old per object hash with a slot load
+ */
+static
+void
+cdtest_Dynamic_benchmark (void* data)
+{
+	CDTestDynamic   object;
+	CDHash*         hash     = CD_CreateHash();
+	CDDynamicSlot   slot     = CD_DynamicSlot("Test.benchmark");
+	CDPointer       total[2] = { 0, 0 };
+	struct timespec start;
+	double          elapsed[2];
+
+	CD_InitDynamic(DYNAMIC(&object));
+
+	CD_HashPut(hash, "Test.benchmark", 1);
+	CD_DynamicPutSlot(&object, slot, 1);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < CDTEST_DYNAMIC_LOOKUPS; i++) {
+		total[0] += CD_HashGet(hash, "Test.benchmark");
+	}
+	elapsed[0] = cdtest_Elapsed(&start);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < CDTEST_DYNAMIC_LOOKUPS; i++) {
+		total[1] += CD_DynamicGetSlot(&object, slot);
+	}
+	elapsed[1] = cdtest_Elapsed(&start);
+
+	tt_int_op(total[0], ==, total[1]);
+
+	printf("\n%d lookups: hash %.3fs slot %.3fs\n", CDTEST_DYNAMIC_LOOKUPS, elapsed[0], elapsed[1]);
+
+	end: {
+		CD_DestroyHash(hash);
+		CD_FinalizeDynamic(DYNAMIC(&object));
+	}
+}
+
+static struct testcase_t cd_utils_Dynamic_tests[] = {
+	{ "slot",      cdtest_Dynamic_slot, },
+	{ "name",      cdtest_Dynamic_name, },
+	{ "benchmark", cdtest_Dynamic_benchmark, },
+
+	// Last, it uses up the inline slots
+	{ "overflow",  cdtest_Dynamic_overflow, },
 
 	END_OF_TESTCASES
 };
@@ -552,6 +1585,10 @@ static struct testgroup_t cd_groups[] = {
 	{ "utils/Map/",              cd_utils_Map_tests },
 	{ "utils/List/",             cd_utils_List_tests },
 	{ "utils/Set/",              cd_utils_Set_tests },
+	{ "utils/Vector/",           cd_utils_Vector_tests },
+	{ "utils/Queue/",            cd_utils_Queue_tests },
+	{ "utils/TimeLoop/",         cd_utils_TimeLoop_tests },
+	{ "utils/Dynamic/",          cd_utils_Dynamic_tests },
 	{ "utils/Regexp/",           cd_utils_Regexp_tests },
 
 //    { "events/", cd_events_tests },
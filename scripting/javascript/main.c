@@ -31,10 +31,6 @@
 bool
 cdjs_EventDispatcher (CDServer* server, const char* event, va_list args)
 {
-    if (!CD_HashHasKey(server->event.provided, event)) {
-        return true;
-    }
-
     JSRuntime* runtime   = (JSRuntime*) CD_DynamicGet(server, "JavaScript.runtime");
     CDMap*     contextes = (CDMap*) CD_DynamicGet(server, "JavaScript.contextes");
     JSContext* context   = (JSContext*) CD_MapGet(contextes, pthread_self());
@@ -66,7 +62,8 @@ CD_ScriptingEngineInitialize (CDScriptingEngine* self)
     CD_DynamicPut(self->server, "JavaScript.contextes", (CDPointer) contextes);
     CD_DynamicPut(self->server, "JavaScript.context",   (CDPointer) context);
 
-    CD_EventRegister(self->server, "Event.dispatch:before", cdjs_EventDispatcher);
+    // Only the provided events have known parameters to hand to the scripts
+    CD_EventRegisterHook(self->server, "Event.dispatch:before", cdjs_EventDispatcher, NULL, true);
 
     return true;
 }
@@ -34,10 +34,6 @@ static
 bool
 cdcl_EventDispatcher (CDServer* server, const char* event, va_list args)
 {
-    if (!CD_HashHasKey(server->event.provided, event)) {
-        return true;
-    }
-
     CDString* parameters = cdcl_MakeParameters((CDList*) CD_HashGet(server->event.provided, event), args);
 
     if (!parameters) {
@@ -135,7 +131,7 @@ CD_ScriptingEngineInitialize (CDScriptingEngine* self)
         cdcl_eval("(asdf:load-system \"%s\")", C_TO_STRING(script));
     }
 
-    CD_EventRegister(self->server, "Event.dispatch:before", cdcl_EventDispatcher);
+    CD_EventRegisterHook(self->server, "Event.dispatch:before", cdcl_EventDispatcher, NULL, true);
 
     if (C_TO_BOOL(C_PATH(self->config, "shell"))) {
         cdcl_eval("ashella");
@@ -105,6 +105,30 @@ CD_BufferAddBuffer (CDBuffer* self, CDBuffer* data)
 	CD_free((void*) stuff);
 }
 
+void
+CD_BufferAddReference (CDBuffer* self, CDPointer data, size_t length, CDBufferCleanup cleanup, CDPointer context)
+{
+	if (evbuffer_add_reference(self->raw, (void*) data, length, cleanup, (void*) context) != 0) {
+		cleanup((void*) data, length, (void*) context);
+	}
+}
+
+static
+void
+cd_BufferSharedCleanup (const void* data, size_t length, void* shared)
+{
+	CD_ReleaseSharedBuffer((CDSharedBuffer*) shared);
+}
+
+void
+CD_BufferAddShared (CDBuffer* self, CDSharedBuffer* data)
+{
+	assert(data);
+
+	CD_BufferAddReference(self, data->data, data->length, cd_BufferSharedCleanup,
+		(CDPointer) CD_RetainSharedBuffer(data));
+}
+
 CDPointer
 CD_BufferRemove (CDBuffer* self, size_t length)
 {
@@ -129,3 +153,52 @@ CD_BufferRemoveBuffer (CDBuffer* self)
 
 	return result;
 }
+
+CDSharedBuffer*
+CD_CreateSharedBuffer (CDBuffer* data)
+{
+	CDSharedBuffer* self = CD_malloc(sizeof(CDSharedBuffer));
+
+	if (pthread_spin_init(&self->lock, PTHREAD_PROCESS_PRIVATE) != 0) {
+		CD_abort("pthread spinlock failed to initialize");
+	}
+
+	self->references = 1;
+	self->length     = CD_BufferLength(data);
+	self->data       = CD_BufferContent(data);
+
+	return self;
+}
+
+CDSharedBuffer*
+CD_RetainSharedBuffer (CDSharedBuffer* self)
+{
+	assert(self);
+
+	pthread_spin_lock(&self->lock);
+	self->references++;
+	pthread_spin_unlock(&self->lock);
+
+	return self;
+}
+
+void
+CD_ReleaseSharedBuffer (CDSharedBuffer* self)
+{
+	int references;
+
+	assert(self);
+
+	pthread_spin_lock(&self->lock);
+	references = --self->references;
+	pthread_spin_unlock(&self->lock);
+
+	if (references > 0) {
+		return;
+	}
+
+	pthread_spin_destroy(&self->lock);
+
+	CD_free((void*) self->data);
+	CD_free(self);
+}
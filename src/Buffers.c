@@ -36,6 +36,9 @@ CD_CreateBuffers (void)
 	self->raw      = NULL;
 	self->external = false;
 
+	self->frame.packet = NULL;
+	CD_BuffersResetFrame(self);
+
 	return self;
 }
 
@@ -50,6 +53,9 @@ CD_WrapBuffers (CDRawBuffers buffers)
 	self->raw      = buffers;
 	self->external = true;
 
+	self->frame.packet = NULL;
+	CD_BuffersResetFrame(self);
+
 	return self;
 }
 
@@ -61,6 +67,10 @@ CD_DestroyBuffers (CDBuffers* self)
 	CD_DestroyBuffer(self->input);
 	CD_DestroyBuffer(self->output);
 
+	if (self->frame.packet) {
+		evbuffer_free(self->frame.packet);
+	}
+
 	CD_free(self);
 }
 
@@ -85,3 +95,16 @@ CD_BuffersFlush (CDBuffers* self)
 {
 	bufferevent_flush(self->raw, EV_READ | EV_WRITE, BEV_FLUSH);
 }
+
+void
+CD_BuffersResetFrame (CDBuffers* self)
+{
+	assert(self);
+
+	self->frame.type     = -1;
+	self->frame.step     = 0;
+	self->frame.complete = false;
+	self->frame.offset   = 0;
+	self->frame.variable = 0;
+	self->frame.count    = 0;
+}
@@ -35,15 +35,21 @@ CD_CreateClient (CDServer* server)
 		CD_abort("pthread rwlock failed to initialize");
 	}
 
-	self->server = server;
+	self->server  = server;
+	self->reactor = NULL;
 
 	self->status = CDClientConnect;
 	self->jobs   = 0;
 
 	self->buffers = NULL;
 
-	DYNAMIC(self) = CD_CreateDynamic();
-	ERROR(self)   = CDNull;
+	self->output.pending   = CD_CreateBuffer();
+	self->output.flush     = NULL;
+	self->output.scheduled = false;
+	self->output.corked    = 0;
+
+	CD_InitDynamic(DYNAMIC(self));
+	ERROR(self) = CDNull;
 
 	return self;
 }
@@ -55,7 +61,16 @@ CD_DestroyClient (CDClient* self)
 
 	CD_EventDispatch(self->server, "Client.destroy", self);
 
+	if (self->output.flush) {
+		event_free(self->output.flush);
+	}
+
 	if (self->buffers) {
+		// Whatever is still corked (a kick message for instance) goes out last
+		bufferevent_lock(self->buffers->raw);
+		evbuffer_add_buffer(self->buffers->output->raw, self->output.pending->raw);
+		bufferevent_unlock(self->buffers->raw);
+
 		bufferevent_flush(self->buffers->raw, EV_READ | EV_WRITE, BEV_FINISHED);
 		bufferevent_disable(self->buffers->raw, EV_READ | EV_WRITE);
 		bufferevent_free(self->buffers->raw);
@@ -63,13 +78,111 @@ CD_DestroyClient (CDClient* self)
 		CD_DestroyBuffers(self->buffers);
 	}
 
-	CD_DestroyDynamic(DYNAMIC(self));
+	CD_DestroyBuffer(self->output.pending);
+
+	CD_FinalizeDynamic(DYNAMIC(self));
 
 	pthread_rwlock_destroy(&self->lock.status);
 
 	CD_free(self);
 }
 
+static
+void
+cd_ClientWrite (evutil_socket_t fd, short what, CDClient* self)
+{
+	CDReactor*       reactor = self->reactor;
+	struct evbuffer* output;
+	size_t           length;
+	int              error   = 0;
+
+	// Cleared first so data added from now on schedules another write
+	__atomic_store_n(&self->output.scheduled, false, __ATOMIC_SEQ_CST);
+
+	if (!self->buffers) {
+		return;
+	}
+
+	bufferevent_lock(self->buffers->raw);
+
+	output = self->buffers->output->raw;
+	length = CD_BufferLength(self->output.pending);
+
+	if (length > 0) {
+		reactor->statistics.flushes++;
+		reactor->statistics.bytes += length;
+
+		// Nothing is waiting on the socket, so the whole batch goes out with a
+		// single writev right away. Writing past the bufferevent is safe only
+		// because client bufferevents are plain sockets, with no filter or
+		// rate limit that these bytes would skip.
+		if (evbuffer_get_length(output) == 0) {
+			if (evbuffer_write(self->output.pending->raw, self->socket) >= 0) {
+				reactor->statistics.writes++;
+			}
+			else {
+				error = EVUTIL_SOCKET_ERROR();
+
+				if (error == EAGAIN || error == EWOULDBLOCK || error == EINTR) {
+					error = 0;
+				}
+			}
+		}
+
+		// The socket is gone, so there's nothing worth keeping
+		if (error) {
+			evbuffer_drain(self->output.pending->raw, CD_BufferLength(self->output.pending));
+		}
+
+		// The rest is moved without copying and written once the socket is
+		// writable again
+		reactor->statistics.deferred += CD_BufferLength(self->output.pending);
+
+		evbuffer_add_buffer(output, self->output.pending->raw);
+	}
+
+	bufferevent_unlock(self->buffers->raw);
+
+	// Taken after the bufferevent lock is dropped, as kicks hold the status
+	// lock while they write
+	if (error) {
+		pthread_rwlock_wrlock(&self->lock.status);
+
+		if (CD_ClientDisconnect(self)) {
+			SLOG(self->server, LOG_INFO, "%s[%p] write failed: %s", self->ip, self,
+				evutil_socket_error_to_string(error));
+		}
+
+		pthread_rwlock_unlock(&self->lock.status);
+	}
+}
+
+void
+CD_ClientSetReactor (CDClient* self, CDReactor* reactor)
+{
+	assert(self);
+	assert(reactor);
+
+	self->reactor      = reactor;
+	self->output.flush = event_new(reactor->event.base, -1, 0, (event_callback_fn) cd_ClientWrite, self);
+}
+
+static inline
+CDBuffer*
+cd_ClientOutput (CDClient* self)
+{
+	return self->output.flush ? self->output.pending : self->buffers->output;
+}
+
+static inline
+void
+cd_ClientSent (CDClient* self)
+{
+	if (__atomic_load_n(&self->output.corked, __ATOMIC_SEQ_CST) == 0) {
+		CD_ClientFlush(self);
+	}
+}
+
 void
 CD_ClientSendBuffer (CDClient* self, CDBuffer* buffer)
 {
@@ -80,7 +193,115 @@ CD_ClientSendBuffer (CDClient* self, CDBuffer* buffer)
 		return;
 	}
 
-	CD_BufferAddBuffer(self->buffers->output, buffer);
+	CD_BufferAddBuffer(cd_ClientOutput(self), buffer);
+
+	cd_ClientSent(self);
+}
 
-	CD_BuffersFlush(self->buffers);
+void
+CD_ClientSendReference (CDClient* self, CDPointer data, size_t length, CDBufferCleanup cleanup, CDPointer context)
+{
+	assert(self);
+	assert(cleanup);
+
+	if (!self->buffers) {
+		cleanup((void*) data, length, (void*) context);
+
+		return;
+	}
+
+	CD_BufferAddReference(cd_ClientOutput(self), data, length, cleanup, context);
+
+	cd_ClientSent(self);
+}
+
+void
+CD_ClientSendShared (CDClient* self, CDSharedBuffer* data)
+{
+	assert(self);
+	assert(data);
+
+	if (!self->buffers) {
+		return;
+	}
+
+	CD_BufferAddShared(cd_ClientOutput(self), data);
+
+	cd_ClientSent(self);
+}
+
+void
+CD_ClientFlush (CDClient* self)
+{
+	assert(self);
+
+	if (!self->output.flush) {
+		CD_BuffersFlush(self->buffers);
+
+		return;
+	}
+
+	if (CD_BufferEmpty(self->output.pending)) {
+		return;
+	}
+
+	if (__atomic_exchange_n(&self->output.scheduled, true, __ATOMIC_SEQ_CST)) {
+		return;
+	}
+
+	event_active(self->output.flush, EV_WRITE, 0);
+}
+
+void
+CD_ClientCork (CDClient* self)
+{
+	assert(self);
+
+	__atomic_add_fetch(&self->output.corked, 1, __ATOMIC_SEQ_CST);
+}
+
+void
+CD_ClientUncork (CDClient* self)
+{
+	assert(self);
+
+	if (__atomic_sub_fetch(&self->output.corked, 1, __ATOMIC_SEQ_CST) == 0) {
+		CD_ClientFlush(self);
+	}
+}
+
+static inline
+void
+cd_ClientScheduleDisconnect (CDClient* self)
+{
+	CD_AddJob(self->server->workers, CD_CreateExternalJob(CDClientDisconnectJob, (CDPointer) self));
+}
+
+bool
+CD_ClientDisconnect (CDClient* self)
+{
+	assert(self);
+
+	if (self->status == CDClientDisconnect) {
+		return false;
+	}
+
+	self->status = CDClientDisconnect;
+
+	if (self->jobs == 0) {
+		cd_ClientScheduleDisconnect(self);
+	}
+
+	return true;
+}
+
+void
+CD_ClientReleaseJob (CDClient* self)
+{
+	assert(self);
+	assert(self->jobs > 0);
+
+	if (--self->jobs == 0 && self->status == CDClientDisconnect) {
+		cd_ClientScheduleDisconnect(self);
+	}
 }
@@ -43,8 +43,9 @@ CD_ParseConfig (const char* path)
 
 	self->cache.daemonize = true;
 
-	self->cache.connection.port    = 25565;
-	self->cache.connection.backlog = 16;
+	self->cache.connection.port      = 25565;
+	self->cache.connection.backlog   = 16;
+	self->cache.connection.reuseport = false;
 
 	self->cache.connection.bind.ipv4.sin_family      = AF_INET;
 	self->cache.connection.bind.ipv4.sin_addr.s_addr = INADDR_ANY;
@@ -56,7 +57,8 @@ CD_ParseConfig (const char* path)
 
 	self->cache.files.motd = "/etc/craftd/motd.conf";
 
-	self->cache.workers = 2;
+	self->cache.workers  = 2;
+	self->cache.reactors = 1;
 
 	self->cache.game.protocol.standard    = true;
 	self->cache.game.clients.max          = 0;
@@ -65,11 +67,13 @@ CD_ParseConfig (const char* path)
 	C_IN(server, C_ROOT(self), "server") {
 		C_SAVE(C_GET(server, "daemonize"), C_BOOL, self->cache.daemonize);
 
-		C_SAVE(C_GET(server, "workers"), C_INT, self->cache.workers);
+		C_SAVE(C_GET(server, "workers"),  C_INT, self->cache.workers);
+		C_SAVE(C_GET(server, "reactors"), C_INT, self->cache.reactors);
 
 		C_IN(connection, server, "connection") {
-			C_SAVE(C_GET(connection, "port"),    C_INT, self->cache.connection.port);
-			C_SAVE(C_GET(connection, "backlog"), C_INT, self->cache.connection.backlog);
+			C_SAVE(C_GET(connection, "port"),      C_INT,  self->cache.connection.port);
+			C_SAVE(C_GET(connection, "backlog"),   C_INT,  self->cache.connection.backlog);
+			C_SAVE(C_GET(connection, "reuseport"), C_BOOL, self->cache.connection.reuseport);
 
 			self->cache.connection.bind.ipv4.sin_port  = htons(self->cache.connection.port);
 			self->cache.connection.bind.ipv6.sin6_port = htons(self->cache.connection.port);
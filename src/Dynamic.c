@@ -23,3 +23,151 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+
+#include <craftd/Server.h>
+
+static struct {
+	pthread_mutex_t lock;
+
+	CDHash*       names;
+	CDDynamicSlot last;
+} _slots = { PTHREAD_MUTEX_INITIALIZER, NULL, 0 };
+
+void
+CD_InitDynamic (CDDynamic* self)
+{
+	assert(self);
+
+	memset(self->slots, 0, sizeof(self->slots));
+
+	self->overflow = NULL;
+}
+
+void
+CD_FinalizeDynamic (CDDynamic* self)
+{
+	assert(self);
+
+	if (self->overflow) {
+		CD_DestroyMap(self->overflow);
+	}
+}
+
+CDDynamicSlot
+CD_DynamicSlot (const char* name)
+{
+	CDDynamicSlot result;
+
+	assert(name);
+
+	if ((result = CD_DynamicFindSlot(name))) {
+		return result;
+	}
+
+	pthread_mutex_lock(&_slots.lock);
+	if (!_slots.names) {
+		__atomic_store_n(&_slots.names, CD_CreateHash(), __ATOMIC_RELEASE);
+	}
+
+	if (!(result = (CDDynamicSlot) CD_HashGet(_slots.names, name))) {
+		if (_slots.last == UINT16_MAX) {
+			ERR("no dynamic slot left for %s", name);
+		}
+		else {
+			CD_HashPut(_slots.names, name, (CDPointer) (result = ++_slots.last));
+
+			if (result >= CD_DYNAMIC_SLOTS) {
+				ERR("too many dynamic properties, %s will be slow", name);
+			}
+		}
+	}
+	pthread_mutex_unlock(&_slots.lock);
+
+	return result;
+}
+
+CDDynamicSlot
+CD_DynamicFindSlot (const char* name)
+{
+	assert(name);
+
+	if (!__atomic_load_n(&_slots.names, __ATOMIC_ACQUIRE)) {
+		return 0;
+	}
+
+	return (CDDynamicSlot) CD_HashGet(_slots.names, name);
+}
+
+/**
+ * Get the map for the overflowing slots, it's created on first use
+ */
+static
+CDMap*
+cd_DynamicOverflow (CDDynamic* self)
+{
+	CDMap* overflow = __atomic_load_n(&self->overflow, __ATOMIC_ACQUIRE);
+
+	if (!overflow) {
+		CDMap* created = CD_CreateMap();
+
+		if (__atomic_compare_exchange_n(&self->overflow, &overflow, created, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+			overflow = created;
+		}
+		else {
+			CD_DestroyMap(created);
+		}
+	}
+
+	return overflow;
+}
+
+CDPointer
+cd_DynamicGetOverflow (CDDynamic* self, CDDynamicSlot slot)
+{
+	CDMap* overflow;
+
+	// No slot never has a value
+	if (slot == 0) {
+		return CDNull;
+	}
+
+	if ((overflow = __atomic_load_n(&self->overflow, __ATOMIC_ACQUIRE))) {
+		return CD_MapGet(overflow, slot);
+	}
+
+	return CDNull;
+}
+
+CDPointer
+cd_DynamicPutOverflow (CDDynamic* self, CDDynamicSlot slot, CDPointer value)
+{
+	if (slot == 0) {
+		return CDNull;
+	}
+
+	if (value == CDNull) {
+		CDMap* overflow = __atomic_load_n(&self->overflow, __ATOMIC_ACQUIRE);
+
+		return overflow ? CD_MapDelete(overflow, slot) : CDNull;
+	}
+
+	return CD_MapPut(cd_DynamicOverflow(self), slot, value);
+}
+
+CDPointer
+cd_DynamicGet (CDDynamic* self, const char* name)
+{
+	return cd_DynamicGetSlot(self, CD_DynamicFindSlot(name));
+}
+
+CDPointer
+cd_DynamicPut (CDDynamic* self, const char* name, CDPointer value)
+{
+	return cd_DynamicPutSlot(self, CD_DynamicSlot(name), value);
+}
+
+CDPointer
+cd_DynamicDelete (CDDynamic* self, const char* name)
+{
+	return cd_DynamicPutSlot(self, CD_DynamicFindSlot(name), CDNull);
+}
@@ -25,31 +25,6 @@
 
 #include <craftd/Event.h>
 
-static
-int8_t
-cd_EventIsEqual (CDEventCallbackFunction a, CDEventCallback* b)
-{
-	if (a == b->function) {
-		return 0;
-	}
-
-	return 1;
-}
-
-int8_t
-cd_EventCompare (CDEventCallback* a, CDEventCallback* b)
-{
-	if (a->priority > b->priority) {
-		return 1;
-	}
-	else if (a->priority < b->priority) {
-		return -1;
-	}
-	else {
-		return 0;
-	}
-}
-
 CDEventCallback*
 CD_CreateEventCallback (CDEventCallbackFunction function, int priority)
 {
@@ -57,6 +32,7 @@ CD_CreateEventCallback (CDEventCallbackFunction function, int priority)
 
 	self->function = function;
 	self->priority = priority;
+	self->filter   = NULL;
 
 	return self;
 }
@@ -110,6 +86,171 @@ cd_EventParameterCompare (char* a, char* b)
 	return 1;
 }
 
+/**
+ * Event names are interned process wide, dispatches cache the ids at their
+ * call sites.
+ */
+static struct {
+	pthread_mutex_t lock;
+
+	CDHash*   ids;
+	CDEventId last;
+} _events = { PTHREAD_MUTEX_INITIALIZER, NULL, 0 };
+
+CDEventId
+CD_EventId (const char* eventName)
+{
+	CDEventId result;
+
+	assert(eventName);
+
+	if (_events.ids && (result = (CDEventId) CD_HashGet(_events.ids, eventName))) {
+		return result;
+	}
+
+	pthread_mutex_lock(&_events.lock);
+	if (!_events.ids) {
+		_events.ids = CD_CreateHash();
+	}
+
+	if (!(result = (CDEventId) CD_HashGet(_events.ids, eventName))) {
+		// Dispatches of an event without an id would be dropped without a
+		// word, so running out is fatal
+		if (_events.last + 1 >= CD_EVENTS_MAX) {
+			CD_abort("too many events, %s can't be interned, raise CD_EVENTS_MAX", eventName);
+		}
+
+		CD_HashPut(_events.ids, eventName, (CDPointer) (result = ++_events.last));
+	}
+	pthread_mutex_unlock(&_events.lock);
+
+	return result;
+}
+
+static inline
+bool
+cd_EventFilterHas (CDServer* self, CDEventFilter* filter, CDEventId id)
+{
+	if (!filter) {
+		return true;
+	}
+
+	if (filter->events[id / 64] & ((uint64_t) 1 << (id % 64))) {
+		return true;
+	}
+
+	return filter->provided && (self->event.hooks.provided[id / 64] & ((uint64_t) 1 << (id % 64)));
+}
+
+bool
+cd_EventBeforeDispatch (CDServer* self, CDEventId id, const char* eventName, ...)
+{
+	CDEventCallbacks* callbacks = CD_EventCallbacks(self, CD_EVENT_ID("Event.dispatch:before"));
+	bool              result    = true;
+	va_list           ap;
+
+	if (!callbacks) {
+		return true;
+	}
+
+	for (size_t i = 0; i < callbacks->length; i++) {
+		if (!cd_EventFilterHas(self, callbacks->item[i].filter, id)) {
+			continue;
+		}
+
+		va_start(ap, eventName);
+		result = callbacks->item[i].function(self, eventName, ap);
+		va_end(ap);
+
+		if (!result) {
+			break;
+		}
+	}
+
+	return result;
+}
+
+bool
+cd_EventAfterDispatch (CDServer* self, CDEventId id, const char* eventName, bool interrupted, ...)
+{
+	CDEventCallbacks* callbacks = CD_EventCallbacks(self, CD_EVENT_ID("Event.dispatch:after"));
+	bool              result    = true;
+	va_list           ap;
+
+	if (!callbacks) {
+		return true;
+	}
+
+	for (size_t i = 0; i < callbacks->length; i++) {
+		if (!cd_EventFilterHas(self, callbacks->item[i].filter, id)) {
+			continue;
+		}
+
+		va_start(ap, interrupted);
+		result = callbacks->item[i].function(self, eventName, interrupted, ap);
+		va_end(ap);
+
+		if (!result) {
+			break;
+		}
+	}
+
+	return result;
+}
+
+static inline
+uint8_t
+cd_EventHookOf (CDEventId id)
+{
+	if (id == CD_EVENT_ID("Event.dispatch:before")) {
+		return CDEventHookBefore;
+	}
+	else if (id == CD_EVENT_ID("Event.dispatch:after")) {
+		return CDEventHookAfter;
+	}
+	else {
+		return 0;
+	}
+}
+
+/**
+ * Compute which hooks each event has to run, must be called with the events
+ * lock held whenever the hooks or the provided events change.
+ */
+static
+void
+cd_EventUpdateHooks (CDServer* self)
+{
+	uint8_t all = 0;
+	uint8_t events[CD_EVENTS_MAX] = { 0 };
+
+	CDEventId hooks[] = { CD_EVENT_ID("Event.dispatch:before"), CD_EVENT_ID("Event.dispatch:after") };
+
+	for (size_t h = 0; h < ARRAY_SIZE(hooks); h++) {
+		CDEventCallbacks* callbacks = self->event.callbacks[hooks[h]];
+		uint8_t           bit       = cd_EventHookOf(hooks[h]);
+
+		for (size_t i = 0; callbacks && i < callbacks->length; i++) {
+			if (!callbacks->item[i].filter) {
+				all |= bit;
+				continue;
+			}
+
+			for (CDEventId id = 1; id < CD_EVENTS_MAX; id++) {
+				if (cd_EventFilterHas(self, callbacks->item[i].filter, id)) {
+					events[id] |= bit;
+				}
+			}
+		}
+	}
+
+	for (CDEventId id = 0; id < CD_EVENTS_MAX; id++) {
+		__atomic_store_n(&self->event.hooks.events[id], events[id], __ATOMIC_RELAXED);
+	}
+
+	__atomic_store_n(&self->event.hooks.all, all, __ATOMIC_RELAXED);
+}
+
 bool
 CD_EventProvides (CDServer* server, const char* eventName, CDList* parameters)
 {
@@ -125,55 +266,129 @@ CD_EventProvides (CDServer* server, const char* eventName, CDList* parameters)
 
 	CD_HashPut(server->event.provided, eventName, (CDPointer) parameters);
 
+	CDEventId id = CD_EventId(eventName);
+
+	if (id) {
+		pthread_mutex_lock(&server->lock.events);
+		server->event.hooks.provided[id / 64] |= (uint64_t) 1 << (id % 64);
+
+		cd_EventUpdateHooks(server);
+		pthread_mutex_unlock(&server->lock.events);
+	}
+
 	return true;
 }
 
-bool
-cd_EventBeforeDispatch (CDServer* self, const char* eventName, ...)
+/**
+ * Free what was retired during the previous epoch once no dispatch started in
+ * it is left, and move on to the next epoch. Must be called with the events
+ * lock held.
+ *
+ * A dispatch counted in an epoch keeps it from ending, so everything it could
+ * have loaded stays allocated until it's done.
+ */
+static
+void
+cd_EventReclaim (CDServer* self)
 {
-	CDList* callbacks = (CDList*) CD_HashGet(self->event.callbacks, "Event.dispatch:before");
-	bool    result    = true;
-	va_list ap;
+	// Twice, so nothing is left behind when no dispatch is running
+	for (int i = 0; i < 2; i++) {
+		uint64_t  epoch = self->event.retired.epoch;
+		CDList*   previous;
+		CDPointer pointer;
+
+		// Pairs with the readers increment in cd_EventEnter, either the
+		// dispatch is counted or it loads the new callbacks
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+		if (__atomic_load_n(&self->event.retired.readers[(epoch - 1) & 1], __ATOMIC_SEQ_CST) > 0) {
+			return;
+		}
 
-	va_start(ap, eventName);
+		previous = self->event.retired.previous;
 
-	CD_LIST_FOREACH(callbacks, it) {
-		if (!CD_ListIteratorValue(it)) {
-			continue;
+		while ((pointer = CD_ListShift(previous))) {
+			CD_free((void*) pointer);
 		}
 
-		if (!((CDEventCallback*) CD_ListIteratorValue(it))->function(self, eventName, ap)) {
-			result = CD_LIST_BREAK(callbacks);
-		}
+		self->event.retired.previous = self->event.retired.current;
+		self->event.retired.current  = previous;
+
+		__atomic_store_n(&self->event.retired.epoch, epoch + 1, __ATOMIC_SEQ_CST);
 	}
+}
+
+/**
+ * Retire replaced callbacks or a filter, they're freed once no dispatch can
+ * be walking them. Must be called with the events lock held.
+ */
+static
+void
+cd_EventRetire (CDServer* self, void* pointer)
+{
+	CD_ListPush(self->event.retired.current, (CDPointer) pointer);
+}
+
+/**
+ * Publish the new callbacks of an event, the old ones are retired since a
+ * dispatch could be walking them. Must be called with the events lock held.
+ */
+static
+void
+cd_EventPublish (CDServer* self, CDEventId id, CDEventCallbacks* callbacks)
+{
+	CDEventCallbacks* old = self->event.callbacks[id];
 
-	va_end(ap);
+	__atomic_store_n(&self->event.callbacks[id], callbacks, __ATOMIC_SEQ_CST);
 
-	return result;
+	if (old) {
+		cd_EventRetire(self, old);
+	}
+
+	if (cd_EventHookOf(id)) {
+		cd_EventUpdateHooks(self);
+	}
 }
 
-bool
-cd_EventAfterDispatch (CDServer* self, const char* eventName, bool interrupted, ...)
+static
+void
+cd_EventRegister (CDServer* self, const char* eventName, int priority, CDEventCallbackFunction callback, CDEventFilter* filter)
 {
-	CDList* callbacks = (CDList*) CD_HashGet(self->event.callbacks, "Event.dispatch:after");
-	bool    result    = true;
-	va_list ap;
+	CDEventId         id = CD_EventId(eventName);
+	CDEventCallbacks* old;
+	CDEventCallbacks* callbacks;
+	size_t            length;
+	size_t            position;
 
-	va_start(ap, interrupted);
+	if (!id) {
+		CD_free(filter);
 
-	CD_LIST_FOREACH(callbacks, it) {
-		if (!CD_ListIteratorValue(it)) {
-			continue;
-		}
+		return;
+	}
 
-		if (!((CDEventCallback*) CD_ListIteratorValue(it))->function(self, eventName, interrupted, ap)) {
-			result = CD_LIST_BREAK(callbacks);
-		}
+	pthread_mutex_lock(&self->lock.events);
+	old    = self->event.callbacks[id];
+	length = old ? old->length : 0;
+
+	callbacks         = CD_malloc(sizeof(CDEventCallbacks) + (length + 1) * sizeof(CDEventCallback));
+	callbacks->length = length + 1;
+
+	// Callbacks with the same priority run in registration order
+	for (position = 0; position < length && old->item[position].priority <= priority; position++) {
+		callbacks->item[position] = old->item[position];
 	}
 
-	va_end(ap);
+	callbacks->item[position].function = callback;
+	callbacks->item[position].priority = priority;
+	callbacks->item[position].filter   = filter;
 
-	return result;
+	for (; position < length; position++) {
+		callbacks->item[position + 1] = old->item[position];
+	}
+
+	cd_EventPublish(self, id, callbacks);
+	cd_EventReclaim(self);
+	pthread_mutex_unlock(&self->lock.events);
 }
 
 void
@@ -181,53 +396,88 @@ CD_EventRegister (CDServer* self, const char* eventName, CDEventCallbackFunction
 {
 	assert(self);
 
-	CDList* callbacks = (CDList*) CD_HashGet(self->event.callbacks, eventName);
+	cd_EventRegister(self, eventName, 0, callback, NULL);
+}
 
-	if (!callbacks) {
-		callbacks = CD_CreateList();
-		CD_HashPut(self->event.callbacks, eventName, (CDPointer) callbacks);
-	}
+void
+CD_EventRegisterWithPriority (CDServer* self, const char* eventName, int priority, CDEventCallbackFunction callback)
+{
+	assert(self);
 
-	CD_ListSortedPush(callbacks, (CDPointer) CD_CreateEventCallback(callback, 0), (CDListCompareCallback) cd_EventCompare);
+	cd_EventRegister(self, eventName, priority, callback, NULL);
 }
 
 void
-CD_EventRegisterWithPriority (CDServer* self, const char* eventName, int priority, CDEventCallbackFunction callback)
+CD_EventRegisterHook (CDServer* self, const char* hookName, CDEventCallbackFunction callback, CDList* events, bool provided)
 {
 	assert(self);
+	assert(cd_EventHookOf(CD_EventId(hookName)));
 
-	CDList* callbacks = (CDList*) CD_HashGet(self->event.callbacks, eventName);
+	CDEventFilter* filter = CD_alloc(sizeof(CDEventFilter));
 
-	if (!callbacks) {
-		callbacks = CD_CreateList();
-		CD_HashPut(self->event.callbacks, eventName, (CDPointer) callbacks);
+	filter->provided = provided;
+
+	CD_LIST_FOREACH(events, it) {
+		CDEventId id = CD_EventId((const char*) CD_ListIteratorValue(it));
+
+		filter->events[id / 64] |= (uint64_t) 1 << (id % 64);
 	}
 
-	CD_ListSortedPush(callbacks, (CDPointer) CD_CreateEventCallback(callback, priority), (CDListCompareCallback) cd_EventCompare);
+	cd_EventRegister(self, hookName, 0, callback, filter);
 }
 
-CDEventCallback**
+size_t
 CD_EventUnregister (CDServer* self, const char* eventName, CDEventCallbackFunction callback)
 {
-	CDList*           callbacks = (CDList*) CD_HashGet(self->event.callbacks, eventName);
-	CDEventCallback** result    = NULL;
+	CDEventId         id = CD_EventId(eventName);
+	CDEventCallbacks* old;
+	CDEventCallbacks* callbacks = NULL;
+	size_t            length    = 0;
 
-	if (!callbacks) {
-		return NULL;
+	if (!id) {
+		return 0;
+	}
+
+	pthread_mutex_lock(&self->lock.events);
+	if (!(old = self->event.callbacks[id])) {
+		pthread_mutex_unlock(&self->lock.events);
+
+		return 0;
 	}
 
 	if (callback) {
-		result    = CD_calloc(2, sizeof(CDEventCallback));
-		result[0] = (CDEventCallback*) CD_ListDeleteAllIf(callbacks, (CDPointer) callback,
-			(CDListCompareCallback) cd_EventIsEqual);
+		for (size_t i = 0; i < old->length; i++) {
+			if (old->item[i].function != callback) {
+				length++;
+			}
+		}
 	}
-	else {
-		result = (CDEventCallback**) CD_ListClear(callbacks);
+
+	if (length > 0) {
+		callbacks         = CD_malloc(sizeof(CDEventCallbacks) + length * sizeof(CDEventCallback));
+		callbacks->length = 0;
+
+		for (size_t i = 0; i < old->length; i++) {
+			if (old->item[i].function != callback) {
+				callbacks->item[callbacks->length++] = old->item[i];
+			}
+		}
+	}
+
+	for (size_t i = 0; i < old->length; i++) {
+		if ((!callback || old->item[i].function == callback) && old->item[i].filter) {
+			cd_EventRetire(self, old->item[i].filter);
+		}
 	}
 
-	if (CD_ListLength(callbacks) == 0) {
-		CD_DestroyList(callbacks);
+	length = old->length - length;
+
+	if (length > 0) {
+		cd_EventPublish(self, id, callbacks);
 	}
 
-	return result;
+	cd_EventReclaim(self);
+	pthread_mutex_unlock(&self->lock.events);
+
+	return length;
 }
@@ -63,8 +63,8 @@ CD_CreatePlugin (CDServer* server, const char* name)
 	self->initialize = lt_dlsym(self->handle, "CD_PluginInitialize");
 	self->finalize   = lt_dlsym(self->handle, "CD_PluginFinalize");
 
-	DYNAMIC(self) = CD_CreateDynamic();
-	ERROR(self)   = CDNull;
+	CD_InitDynamic(DYNAMIC(self));
+	ERROR(self) = CDNull;
 
 	C_FOREACH(plugin, C_PATH(self->server->config, "server.plugins.load")) {
 		 if (CD_CStringIsEqual(name, C_TO_STRING(C_GET(plugin, "name")))) {
@@ -105,9 +105,7 @@ CD_DestroyPlugin (CDPlugin* self)
 		CD_DestroyString(self->description);
 	}
 
-	if (DYNAMIC(self)) {
-		CD_DestroyDynamic(DYNAMIC(self));
-	}
+	CD_FinalizeDynamic(DYNAMIC(self));
 
 	if (self->config) {
 		config_unexport(self->config);
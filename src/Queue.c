@@ -0,0 +1,313 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include <craftd/common.h>
+#include <craftd/Queue.h>
+
+static inline
+void
+cd_QueueFutexWait (CDQueue* self, uint32_t epoch)
+{
+	#ifdef __linux__
+	syscall(SYS_futex, &self->park.epoch, FUTEX_WAIT_PRIVATE, epoch, NULL, NULL, 0);
+	#else
+	pthread_mutex_lock(&self->park.mutex);
+	if (__atomic_load_n(&self->park.epoch, __ATOMIC_SEQ_CST) == epoch) {
+		pthread_cond_wait(&self->park.condition, &self->park.mutex);
+	}
+	pthread_mutex_unlock(&self->park.mutex);
+	#endif
+}
+
+static inline
+void
+cd_QueueFutexWake (CDQueue* self, int waiters)
+{
+	#ifdef __linux__
+	__atomic_add_fetch(&self->park.epoch, 1, __ATOMIC_SEQ_CST);
+
+	syscall(SYS_futex, &self->park.epoch, FUTEX_WAKE_PRIVATE, waiters, NULL, NULL, 0);
+	#else
+	pthread_mutex_lock(&self->park.mutex);
+	__atomic_add_fetch(&self->park.epoch, 1, __ATOMIC_SEQ_CST);
+
+	if (waiters == 1) {
+		pthread_cond_signal(&self->park.condition);
+	}
+	else {
+		pthread_cond_broadcast(&self->park.condition);
+	}
+	pthread_mutex_unlock(&self->park.mutex);
+	#endif
+}
+
+CDQueue*
+CD_CreateQueue (size_t size)
+{
+	CDQueue* self = CD_malloc(sizeof(CDQueue));
+	size_t   length;
+
+	assert(self);
+
+	for (length = 2; length < size; length <<= 1) {
+		continue;
+	}
+
+	self->mask  = length - 1;
+	self->cells = CD_malloc(sizeof(CDQueueCell) * length);
+	self->head  = 0;
+	self->tail  = 0;
+
+	// A cell is free to write at position p when its sequence is p, and ready
+	// to read when it's p + 1
+	for (size_t i = 0; i < length; i++) {
+		self->cells[i].sequence = i;
+		self->cells[i].value    = CDNull;
+	}
+
+	self->park.epoch    = 0;
+	self->park.waiters = 0;
+
+	#ifndef __linux__
+	if (pthread_mutex_init(&self->park.mutex, NULL) != 0) {
+		CD_abort("pthread mutex failed to initialize");
+	}
+
+	if (pthread_cond_init(&self->park.condition, NULL) != 0) {
+		CD_abort("pthread cond failed to initialize");
+	}
+	#endif
+
+	self->overflow.values = CD_CreateList();
+	self->overflow.length = 0;
+
+	return self;
+}
+
+void
+CD_DestroyQueue (CDQueue* self)
+{
+	assert(self);
+
+	CD_DestroyList(self->overflow.values);
+
+	#ifndef __linux__
+	pthread_mutex_destroy(&self->park.mutex);
+	pthread_cond_destroy(&self->park.condition);
+	#endif
+
+	CD_free(self->cells);
+	CD_free(self);
+}
+
+static inline
+bool
+cd_QueueRingPush (CDQueue* self, CDPointer value)
+{
+	size_t       position = __atomic_load_n(&self->head, __ATOMIC_RELAXED);
+	CDQueueCell* cell;
+
+	while (true) {
+		cell = &self->cells[position & self->mask];
+
+		size_t   sequence   = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+		intptr_t difference = (intptr_t) sequence - (intptr_t) position;
+
+		if (difference == 0) {
+			if (__atomic_compare_exchange_n(&self->head, &position, position + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				break;
+			}
+		}
+		else if (difference < 0) {
+			return false;
+		}
+		else {
+			position = __atomic_load_n(&self->head, __ATOMIC_RELAXED);
+		}
+	}
+
+	cell->value = value;
+	__atomic_store_n(&cell->sequence, position + 1, __ATOMIC_RELEASE);
+
+	return true;
+}
+
+void
+CD_QueuePush (CDQueue* self, CDPointer value)
+{
+	assert(self);
+	assert(value);
+
+	// Once something overflowed everything goes after it until it's drained,
+	// so the order is kept
+	if (__atomic_load_n(&self->overflow.length, __ATOMIC_ACQUIRE) > 0 || !cd_QueueRingPush(self, value)) {
+		__atomic_add_fetch(&self->overflow.length, 1, __ATOMIC_SEQ_CST);
+
+		CD_ListPush(self->overflow.values, value);
+	}
+
+	// Pairs with the increment of the waiters in CD_QueueWait, either the
+	// consumer sees the value or the producer sees the consumer
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	// Every push wakes a consumer, so a burst spreads over as many consumers
+	// as there are values and not only the first one woken
+	if (__atomic_load_n(&self->park.waiters, __ATOMIC_SEQ_CST) > 0) {
+		cd_QueueFutexWake(self, 1);
+	}
+}
+
+CDPointer
+CD_QueueShift (CDQueue* self)
+{
+	CDPointer result;
+
+	if (CD_QueueShiftMany(self, &result, 1) == 0) {
+		return CDNull;
+	}
+
+	return result;
+}
+
+size_t
+CD_QueueShiftMany (CDQueue* self, CDPointer* values, size_t length)
+{
+	size_t position;
+	size_t result = 0;
+
+	assert(self);
+
+	position = __atomic_load_n(&self->tail, __ATOMIC_RELAXED);
+
+	while (length > 0) {
+		size_t sequence = 0;
+
+		// Count the ready cells, they can only be taken by whoever moves the
+		// tail past them
+		for (result = 0; result < length; result++) {
+			sequence = __atomic_load_n(&self->cells[(position + result) & self->mask].sequence, __ATOMIC_ACQUIRE);
+
+			if (sequence != position + result + 1) {
+				break;
+			}
+		}
+
+		if (result == 0) {
+			if ((intptr_t) sequence - (intptr_t) (position + 1) < 0) {
+				break;
+			}
+
+			position = __atomic_load_n(&self->tail, __ATOMIC_RELAXED);
+
+			continue;
+		}
+
+		if (__atomic_compare_exchange_n(&self->tail, &position, position + result, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+			break;
+		}
+
+		result = 0;
+	}
+
+	for (size_t i = 0; i < result; i++) {
+		CDQueueCell* cell = &self->cells[(position + i) & self->mask];
+
+		values[i] = cell->value;
+		__atomic_store_n(&cell->sequence, position + i + self->mask + 1, __ATOMIC_RELEASE);
+	}
+
+	// The overflow only has values newer than the ones in the ring
+	while (result < length && __atomic_load_n(&self->overflow.length, __ATOMIC_ACQUIRE) > 0) {
+		CDPointer value = CD_ListShift(self->overflow.values);
+
+		if (!value) {
+			break;
+		}
+
+		__atomic_sub_fetch(&self->overflow.length, 1, __ATOMIC_SEQ_CST);
+
+		values[result++] = value;
+	}
+
+	return result;
+}
+
+size_t
+CD_QueueLength (CDQueue* self)
+{
+	assert(self);
+
+	// The tail is read first so it's never past the head
+	size_t tail = __atomic_load_n(&self->tail, __ATOMIC_SEQ_CST);
+	size_t head = __atomic_load_n(&self->head, __ATOMIC_SEQ_CST);
+
+	return (head - tail) + __atomic_load_n(&self->overflow.length, __ATOMIC_SEQ_CST);
+}
+
+bool
+CD_QueueIsEmpty (CDQueue* self)
+{
+	return CD_QueueLength(self) == 0;
+}
+
+void
+CD_QueueWait (CDQueue* self, bool* running)
+{
+	uint32_t epoch;
+
+	assert(self);
+
+	epoch = __atomic_load_n(&self->park.epoch, __ATOMIC_SEQ_CST);
+
+	__atomic_add_fetch(&self->park.waiters, 1, __ATOMIC_SEQ_CST);
+
+	// The flag is read after the epoch, so a CD_QueueWakeAll following its
+	// clearing either shows here or changes the epoch
+	if (CD_QueueIsEmpty(self) && (!running || __atomic_load_n(running, __ATOMIC_SEQ_CST))) {
+		cd_QueueFutexWait(self, epoch);
+	}
+
+	__atomic_sub_fetch(&self->park.waiters, 1, __ATOMIC_SEQ_CST);
+
+	// A stopping consumer won't take what it was woken for, pass the wake up
+	// on to one that will
+	if (running && !__atomic_load_n(running, __ATOMIC_SEQ_CST) && !CD_QueueIsEmpty(self) &&
+	    __atomic_load_n(&self->park.waiters, __ATOMIC_SEQ_CST) > 0) {
+		cd_QueueFutexWake(self, 1);
+	}
+}
+
+void
+CD_QueueWakeAll (CDQueue* self)
+{
+	assert(self);
+
+	cd_QueueFutexWake(self, INT_MAX);
+}
@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <craftd/Reactor.h>
+#include <craftd/Server.h>
+#include <craftd/Logger.h>
+
+static
+void
+cd_KeepReactorAlive (evutil_socket_t fd, short what, CDReactor* self)
+{
+	// A break requested before the loop started is lost, pick it up here
+	if (!self->running) {
+		event_base_loopbreak(self->event.base);
+	}
+}
+
+/**
+ * Report the output counters since the last report, nothing is logged for a
+ * Reactor that had nothing to flush.
+ */
+static
+void
+cd_ReactorReport (evutil_socket_t fd, short what, CDReactor* self)
+{
+	uint64_t flushes  = self->statistics.flushes  - self->statistics.reported.flushes;
+	uint64_t writes   = self->statistics.writes   - self->statistics.reported.writes;
+	uint64_t bytes    = self->statistics.bytes    - self->statistics.reported.bytes;
+	uint64_t deferred = self->statistics.deferred - self->statistics.reported.deferred;
+
+	if (flushes == 0) {
+		return;
+	}
+
+	SDEBUG(self->server, "reactor %zu> %llu bytes in %llu flushes, %llu direct writes, %llu bytes deferred", self->id,
+		(unsigned long long) bytes, (unsigned long long) flushes,
+		(unsigned long long) writes, (unsigned long long) deferred);
+
+	self->statistics.reported.flushes  = self->statistics.flushes;
+	self->statistics.reported.writes   = self->statistics.writes;
+	self->statistics.reported.bytes    = self->statistics.bytes;
+	self->statistics.reported.deferred = self->statistics.deferred;
+}
+
+CDReactor*
+CD_CreateReactor (struct _CDServer* server, size_t id)
+{
+	CDReactor* self = CD_malloc(sizeof(CDReactor));
+
+	if (pthread_attr_init(&self->attributes) != 0) {
+		CD_abort("pthread attribute failed to initialize");
+	}
+
+	if (pthread_attr_setdetachstate(&self->attributes, PTHREAD_CREATE_JOINABLE) != 0) {
+		CD_abort("pthread attribute failed to set in joinable state");
+	}
+
+	self->server        = server;
+	self->id            = id;
+	self->running       = false;
+	self->disconnecting = CD_CreateList();
+	self->socket        = -1;
+
+	self->statistics.flushes  = 0;
+	self->statistics.writes   = 0;
+	self->statistics.bytes    = 0;
+	self->statistics.deferred = 0;
+
+	self->statistics.reported.flushes  = 0;
+	self->statistics.reported.writes   = 0;
+	self->statistics.reported.bytes    = 0;
+	self->statistics.reported.deferred = 0;
+
+	self->event.base     = event_base_new();
+	self->event.listener = NULL;
+
+	// An event base without events returns right away, keep one around for
+	// when the Reactor has no clients
+	DO {
+		struct timeval interval = { 1, 0 };
+
+		self->event.alive = event_new(self->event.base, -1, EV_PERSIST, (event_callback_fn) cd_KeepReactorAlive, self);
+
+		event_add(self->event.alive, &interval);
+	}
+
+	DO {
+		struct timeval interval = { 60, 0 };
+
+		self->event.report = event_new(self->event.base, -1, EV_PERSIST, (event_callback_fn) cd_ReactorReport, self);
+
+		event_add(self->event.report, &interval);
+	}
+
+	return self;
+}
+
+void
+CD_DestroyReactor (CDReactor* self)
+{
+	assert(self);
+
+	CD_StopReactor(self);
+
+	if (self->event.listener) {
+		event_free(self->event.listener);
+	}
+
+	if (self->socket >= 0) {
+		evutil_closesocket(self->socket);
+	}
+
+	event_free(self->event.alive);
+	event_free(self->event.report);
+	event_base_free(self->event.base);
+
+	CD_DestroyList(self->disconnecting);
+
+	pthread_attr_destroy(&self->attributes);
+
+	CD_free(self);
+}
+
+void*
+CD_RunReactor (CDReactor* self)
+{
+	assert(self);
+
+	SDEBUG(self->server, "reactor %zu started", self->id);
+
+	while (self->running) {
+		event_base_loop(self->event.base, 0);
+
+		CD_ReactorCleanDisconnects(self);
+	}
+
+	SDEBUG(self->server, "reactor %zu stopped, %llu bytes in %llu flushes, %llu direct writes, %llu bytes deferred", self->id,
+		(unsigned long long) self->statistics.bytes, (unsigned long long) self->statistics.flushes,
+		(unsigned long long) self->statistics.writes, (unsigned long long) self->statistics.deferred);
+
+	return NULL;
+}
+
+bool
+CD_StartReactor (CDReactor* self)
+{
+	assert(self);
+
+	self->running = true;
+
+	if (pthread_create(&self->thread, &self->attributes, (void *(*)(void *)) CD_RunReactor, self) != 0) {
+		self->running = false;
+
+		return false;
+	}
+
+	return true;
+}
+
+void
+CD_StopReactor (CDReactor* self)
+{
+	assert(self);
+
+	if (!self->running) {
+		return;
+	}
+
+	self->running = false;
+
+	CD_ReactorFlush(self, true);
+
+	if (!pthread_equal(self->thread, pthread_self())) {
+		pthread_join(self->thread, NULL);
+	}
+}
+
+void
+CD_ReactorFlush (CDReactor* self, bool now)
+{
+	if (now) {
+		event_base_loopbreak(self->event.base);
+	}
+	else {
+		struct timeval interval = { 0, 0 };
+
+		event_base_loopexit(self->event.base, &interval);
+	}
+}
+
+void
+CD_ReactorDisconnect (CDReactor* self, CDClient* client)
+{
+	assert(self);
+	assert(client);
+
+	CD_ListPush(self->disconnecting, (CDPointer) client);
+
+	CD_ReactorFlush(self, false);
+}
+
+void
+CD_ReactorCleanDisconnects (CDReactor* self)
+{
+	CDClient* client;
+
+	// Shifting one at a time doesn't lose clients pushed while cleaning
+	while ((client = (CDClient*) CD_ListShift(self->disconnecting))) {
+		CD_VectorWriteLock(self->server->clients);
+		client = (CDClient*) CD_VectorDelete(self->server->clients, (CDPointer) client);
+		CD_VectorUnlock(self->server->clients);
+
+		if (client) {
+			CD_DestroyClient(client);
+		}
+	}
+}
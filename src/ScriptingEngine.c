@@ -63,8 +63,8 @@ CD_CreateScriptingEngine (CDServer* server, const char* name)
 	self->initialize = lt_dlsym(self->handle, "CD_ScriptingEngineInitialize");
 	self->finalize   = lt_dlsym(self->handle, "CD_ScriptingEngineFinalize");
 
-	DYNAMIC(self) = CD_CreateDynamic();
-	ERROR(self)   = CDNull;
+	CD_InitDynamic(DYNAMIC(self));
+	ERROR(self) = CDNull;
 
 	C_FOREACH(engine, C_PATH(server->config, "server.scripting.engines")) {
 		if (CD_CStringIsEqual(name, C_TO_STRING(C_GET(engine, "name")))) {
@@ -105,9 +105,7 @@ CD_DestroyScriptingEngine (CDScriptingEngine* self)
 		CD_DestroyString(self->description);
 	}
 
-	if (DYNAMIC(self)) {
-		CD_DestroyDynamic(DYNAMIC(self));
-	}
+	CD_FinalizeDynamic(DYNAMIC(self));
 
 	if (self->config) {
 		config_unexport(self->config);
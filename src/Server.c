@@ -55,8 +55,22 @@ CD_CreateServer (const char* path)
 		return NULL;
 	}
 
-	self->event.callbacks = CD_CreateHash();
-	self->event.provided  = CD_CreateHash();
+	self->event.base     = NULL;
+	self->event.listener = NULL;
+	self->event.provided = CD_CreateHash();
+
+	self->event.retired.epoch      = 0;
+	self->event.retired.readers[0] = 0;
+	self->event.retired.readers[1] = 0;
+	self->event.retired.previous   = CD_CreateList();
+	self->event.retired.current    = CD_CreateList();
+
+	memset(self->event.callbacks, 0, sizeof(self->event.callbacks));
+	memset(&self->event.hooks, 0, sizeof(self->event.hooks));
+
+	if (pthread_mutex_init(&self->lock.events, NULL) != 0) {
+		CD_abort("pthread mutex failed to initialize");
+	}
 
 	self->protocol = NULL;
 
@@ -65,13 +79,20 @@ CD_CreateServer (const char* path)
 	self->plugins          = CD_CreatePlugins(self);
 	self->scriptingEngines = CD_CreateScriptingEngines(self);
 
-	self->clients       = CD_CreateList();
-	self->disconnecting = CD_CreateList();
+	self->clients = CD_CreateVector();
+
+	self->reactors.length = (self->config->cache.reactors > 0) ? self->config->cache.reactors : 1;
+	self->reactors.item   = CD_malloc(sizeof(CDReactor*) * self->reactors.length);
+	self->reactors.next   = 0;
+
+	for (size_t i = 0; i < self->reactors.length; i++) {
+		self->reactors.item[i] = CD_CreateReactor(self, i);
+	}
 
 	self->running = false;
 
-	DYNAMIC(self) = CD_CreateDynamic();
-	ERROR(self)   = CDNull;
+	CD_InitDynamic(DYNAMIC(self));
+	ERROR(self) = CDNull;
         
         //Server Events
 	CD_EventProvides(self, "Server.create",     CD_CreateEventParameters(NULL));
@@ -98,9 +119,11 @@ CD_DestroyServer (CDServer* self)
 
 	CD_StopTimeLoop(self->timeloop);
 
-	CD_LIST_FOREACH(self->clients, it) {
-		CD_ServerKick(self, (CDClient*) CD_ListIteratorValue(it), CD_CreateStringFromCString("shutting down"));
+	CD_VectorReadLock(self->clients);
+	CD_VECTOR_FOREACH(self->clients, i) {
+		CD_ServerKick(self, (CDClient*) CD_VectorGet(self->clients, i), CD_CreateStringFromCString("shutting down"));
 	}
+	CD_VectorUnlock(self->clients);
 
 	if (self->plugins) {
 		CD_DestroyPlugins(self->plugins);
@@ -118,6 +141,12 @@ CD_DestroyServer (CDServer* self)
 		CD_DestroyWorkers(self->workers);
 	}
 
+	for (size_t i = 0; i < self->reactors.length; i++) {
+		CD_DestroyReactor(self->reactors.item[i]);
+	}
+
+	CD_free(self->reactors.item);
+
 	if (self->event.listener) {
 		event_free(self->event.listener);
 		self->event.listener = NULL;
@@ -132,7 +161,30 @@ CD_DestroyServer (CDServer* self)
 		CD_DestroyConfig(self->config);
 	}
 
-	CD_DestroyHash(self->event.callbacks);
+	for (size_t i = 0; i < CD_EVENTS_MAX; i++) {
+		if (!self->event.callbacks[i]) {
+			continue;
+		}
+
+		for (size_t h = 0; h < self->event.callbacks[i]->length; h++) {
+			CD_free(self->event.callbacks[i]->item[h].filter);
+		}
+
+		CD_free(self->event.callbacks[i]);
+	}
+
+	CD_LIST_FOREACH(self->event.retired.previous, it) {
+		CD_free((void*) CD_ListIteratorValue(it));
+	}
+
+	CD_LIST_FOREACH(self->event.retired.current, it) {
+		CD_free((void*) CD_ListIteratorValue(it));
+	}
+
+	CD_DestroyList(self->event.retired.previous);
+	CD_DestroyList(self->event.retired.current);
+
+	pthread_mutex_destroy(&self->lock.events);
 
 	CD_HASH_FOREACH(self->event.provided, it) {
 		CD_DestroyEventParameters((CDList*) CD_HashIteratorValue(it));
@@ -140,9 +192,7 @@ CD_DestroyServer (CDServer* self)
 
 	CD_DestroyHash(self->event.provided);
 
-	if (DYNAMIC(self)) {
-		CD_DestroyDynamic(DYNAMIC(self));
-	}
+	CD_FinalizeDynamic(DYNAMIC(self));
 
 	if (self->name) {
 		CD_free(self->name);
@@ -176,32 +226,34 @@ cd_ReadCallback (struct bufferevent* event, CDClient* client)
 	  return;
 	}
 
+	bool invalid = false;
+
 	pthread_rwlock_wrlock(&client->lock.status);
 
 	SDEBUG(self, "read data from %s, %d byte/s available", client->ip, CD_BufferLength(client->buffers->input));
 
+	// While the client's lane is running it picks up the new data itself, see
+	// CD_ClientNextPacket
 	if (client->status == CDClientIdle) {
-		void* packet;
-
 		if (self->protocol->parsable(client->buffers)) {
-			if ((packet = self->protocol->parse(client->buffers, false))) {
-				CD_BufferReadIn(client->buffers, CDNull, CDNull);
+			client->status = CDClientProcess;
+			client->jobs++;
 
-				client->status = CDClientProcess;
-				client->jobs++;
+			CD_ClientCork(client);
 
-				CD_AddJob(self->workers, CD_CreateJob(CDClientProcessJob,
-					(CDPointer) CD_CreateClientProcessJob(client, packet)));
-			}
+			CD_AddJob(self->workers, CD_CreateJob(CDClientProcessJob,
+				(CDPointer) CD_CreateClientProcessJob(client, NULL)));
 		}
 		else {
-			if (errno == EILSEQ) {
-				CD_ServerKick(self, client, CD_CreateStringFromCString("bad packet"));
-			}
+			invalid = (errno == EILSEQ);
 		}
 	}
 
 	pthread_rwlock_unlock(&client->lock.status);
+
+	if (invalid) {
+		CD_ServerKick(self, client, CD_CreateStringFromCString("bad packet"));
+	}
 }
 
 static
@@ -216,7 +268,12 @@ cd_ErrorCallback (struct bufferevent* event, short error, CDClient* client)
 
 	pthread_rwlock_wrlock(&client->lock.status);
 
-	client->status = CDClientDisconnect;
+	// Already kicked, the disconnection is on its way
+	if (!CD_ClientDisconnect(client)) {
+		pthread_rwlock_unlock(&client->lock.status);
+
+		return;
+	}
 
 	CDServer* self = client->server;
 
@@ -231,8 +288,6 @@ cd_ErrorCallback (struct bufferevent* event, short error, CDClient* client)
 
 	SLOG(self, LOG_INFO, "%s[%p] errored/disconnected", client->ip, client);
 
-	CD_AddJob(client->server->workers, CD_CreateExternalJob(CDClientDisconnectJob, (CDPointer) client));
-
 	pthread_rwlock_unlock(&client->lock.status);
 }
 
@@ -256,7 +311,7 @@ cd_LogCallback (int priority, const char* message)
 
 static
 void
-cd_Accept (evutil_socket_t listener, short event, CDServer* self)
+cd_AcceptOn (CDServer* self, CDReactor* reactor, evutil_socket_t listener)
 {
 	CDClient*               client;
 	struct sockaddr_storage storage;
@@ -286,10 +341,11 @@ cd_Accept (evutil_socket_t listener, short event, CDServer* self)
 		SERR(self, "weird address family");
 		close(fd);
 		CD_DestroyClient(client);
+		return;
 	}
 
 	if (self->config->cache.game.clients.max > 0) {
-		if (CD_ListLength(self->clients) >= self->config->cache.game.clients.max) {
+		if (CD_VectorLength(self->clients) >= self->config->cache.game.clients.max) {
 			SERR(self, "too many clients");
 			close(fd);
 			CD_DestroyClient(client);
@@ -300,17 +356,19 @@ cd_Accept (evutil_socket_t listener, short event, CDServer* self)
 	if (self->config->cache.game.clients.simultaneous > 0) {
 		size_t same = 0;
 
-		CD_LIST_FOREACH(self->clients, it) {
-			CDClient* tmp = (CDClient*) CD_ListIteratorValue(it);
+		CD_VectorReadLock(self->clients);
+		CD_VECTOR_FOREACH(self->clients, i) {
+			CDClient* tmp = (CDClient*) CD_VectorGet(self->clients, i);
 
 			if (CD_CStringIsEqual(tmp->ip, client->ip)) {
 				same++;
 			}
 
 			if (same >= self->config->cache.game.clients.simultaneous) {
-				CD_LIST_BREAK(self->clients);
+				break;
 			}
 		}
+		CD_VectorUnlock(self->clients);
 
 		if (same >= self->config->cache.game.clients.simultaneous) {
 			SERR(self, "too many connections from %s", client->ip);
@@ -323,57 +381,125 @@ cd_Accept (evutil_socket_t listener, short event, CDServer* self)
 	client->socket = fd;
 	evutil_make_socket_nonblocking(client->socket);
 
-	client->buffers = CD_WrapBuffers(bufferevent_socket_new(self->event.base, client->socket, BEV_OPT_CLOSE_ON_FREE | BEV_OPT_THREADSAFE));
+	CD_ClientSetReactor(client, reactor);
+
+	// The connect job is counted before any callback can disconnect the client,
+	// its output is flushed once it's done
+	client->jobs = 1;
+
+	CD_ClientCork(client);
+
+	// The bufferevent lives on the reactor's base, so its callbacks always run on
+	// the reactor's thread. It must stay a plain socket bufferevent, with no
+	// filter or rate limit, as cd_ClientWrite writes batches past it.
+	client->buffers = CD_WrapBuffers(bufferevent_socket_new(reactor->event.base, client->socket, BEV_OPT_CLOSE_ON_FREE | BEV_OPT_THREADSAFE));
 
 	bufferevent_setcb(client->buffers->raw, (bufferevent_data_cb) cd_ReadCallback, NULL, (bufferevent_event_cb) cd_ErrorCallback, client);
 	bufferevent_enable(client->buffers->raw, EV_READ | EV_WRITE);
 
-	CD_ListPush(self->clients, (CDPointer) client);
+	CD_VectorWriteLock(self->clients);
+	CD_VectorPush(self->clients, (CDPointer) client);
+	CD_VectorUnlock(self->clients);
 
 	CD_AddJob(self->workers, CD_CreateExternalJob(CDClientConnectJob, (CDPointer) client));
 }
 
-bool
-CD_RunServer (CDServer* self)
+static
+void
+cd_Accept (evutil_socket_t listener, short event, CDServer* self)
 {
-	event_set_mem_functions(CD_malloc, CD_realloc, CD_free);
-	event_set_log_callback(cd_LogCallback);
+	CDReactor* reactor = self->reactors.item[self->reactors.next];
 
-	if ((self->event.base = event_base_new()) == NULL) {
-		SERR(self, "could not create MC libevent base!");
+	self->reactors.next = (self->reactors.next + 1) % self->reactors.length;
 
-		return false;
-	}
+	cd_AcceptOn(self, reactor, listener);
+}
 
-	event_add(evsignal_new(self->event.base, SIGINT, (event_callback_fn) cd_HandleSignal, self), NULL);
+static
+void
+cd_ReactorAccept (evutil_socket_t listener, short event, CDReactor* reactor)
+{
+	cd_AcceptOn(reactor->server, reactor, listener);
+}
 
-	if ((self->socket = socket(PF_INET, SOCK_STREAM, 0)) < 0) {
-		SERR(self, "could not create socket: %s", strerror(-self->socket));
+static
+evutil_socket_t
+cd_Listen (CDServer* self, bool reuseport)
+{
+	evutil_socket_t result;
 
-		return false;
+	if ((result = socket(PF_INET, SOCK_STREAM, 0)) < 0) {
+		SERR(self, "could not create socket: %s", strerror(-result));
+
+		return -1;
 	}
 
-	evutil_make_socket_nonblocking(self->socket);
+	evutil_make_socket_nonblocking(result);
 
 	#ifndef WIN32
 	DO {
 		int one = 1;
-		setsockopt(self->socket, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+		setsockopt(result, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+		#ifdef SO_REUSEPORT
+		if (reuseport) {
+			setsockopt(result, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+		}
+		#endif
 	}
 	#endif
 
-	if ((ERROR(self) = bind(self->socket, (struct sockaddr*) &self->config->cache.connection.bind.ipv4, sizeof(self->config->cache.connection.bind.ipv4))) < 0) {
+	if ((ERROR(self) = bind(result, (struct sockaddr*) &self->config->cache.connection.bind.ipv4, sizeof(self->config->cache.connection.bind.ipv4))) < 0) {
 		SERR(self, "cannot bind: %s", strerror(ABS(ERROR(self))));
-		return false;
+		evutil_closesocket(result);
+		return -1;
 	}
 
-	if ((ERROR(self) = listen(self->socket, self->config->cache.connection.backlog)) < 0) {
+	if ((ERROR(self) = listen(result, self->config->cache.connection.backlog)) < 0) {
 		SERR(self, "listen error: %s", strerror(ABS(ERROR(self))));
+		evutil_closesocket(result);
+		return -1;
+	}
+
+	return result;
+}
+
+bool
+CD_RunServer (CDServer* self)
+{
+	event_set_log_callback(cd_LogCallback);
+
+	if ((self->event.base = event_base_new()) == NULL) {
+		SERR(self, "could not create MC libevent base!");
+
+		return false;
+	}
+
+	event_add(evsignal_new(self->event.base, SIGINT, (event_callback_fn) cd_HandleSignal, self), NULL);
+
+	self->socket = -1;
+
+	#ifdef SO_REUSEPORT
+	// Every reactor accepts on its own socket and the kernel balances them
+	if (self->config->cache.connection.reuseport) {
+		for (size_t i = 0; i < self->reactors.length; i++) {
+			CDReactor* reactor = self->reactors.item[i];
+
+			if ((reactor->socket = cd_Listen(self, true)) < 0) {
+				return false;
+			}
+
+			reactor->event.listener = event_new(reactor->event.base, reactor->socket, EV_READ | EV_PERSIST, (event_callback_fn) cd_ReactorAccept, reactor);
+		}
+	}
+	else
+	#endif
+	if ((self->socket = cd_Listen(self, false)) < 0) {
 		return false;
 	}
 
-	SLOG(self, LOG_INFO, "server listening on port %d (%s gameplay)", self->config->cache.connection.port,
-		self->config->cache.game.protocol.standard ? "standard" : "custom");
+	SLOG(self, LOG_INFO, "server listening on port %d (%s gameplay, %zu reactor/s)", self->config->cache.connection.port,
+		self->config->cache.game.protocol.standard ? "standard" : "custom", self->reactors.length);
 
 	if (self->config->cache.game.clients.max > 0) {
 		SLOG(self, LOG_INFO, "server can host max %d clients", self->config->cache.game.clients.max);
@@ -384,9 +510,25 @@ CD_RunServer (CDServer* self)
 	// Start the TimeLoop for timed events
 	pthread_create(&self->timeloop->thread, &self->timeloop->attributes, (void *(*)(void *)) CD_RunTimeLoop, self->timeloop);
 
-	self->event.listener = event_new(self->event.base, self->socket, EV_READ | EV_PERSIST, (event_callback_fn) cd_Accept, self);
+	for (size_t i = 0; i < self->reactors.length; i++) {
+		CDReactor* reactor = self->reactors.item[i];
+
+		if (reactor->event.listener) {
+			event_add(reactor->event.listener, NULL);
+		}
+
+		if (!CD_StartReactor(reactor)) {
+			SERR(self, "could not start reactor %zu", i);
+
+			return false;
+		}
+	}
+
+	if (self->socket >= 0) {
+		self->event.listener = event_new(self->event.base, self->socket, EV_READ | EV_PERSIST, (event_callback_fn) cd_Accept, self);
 
-	event_add(self->event.listener, NULL);
+		event_add(self->event.listener, NULL);
+	}
 
 	CD_LoadPlugins(self->plugins);
 	CD_LoadScriptingEngines(self->scriptingEngines);
@@ -397,8 +539,6 @@ CD_RunServer (CDServer* self)
 
 	while (self->running) {
 		event_base_loop(self->event.base, 0);
-
-		CD_ServerCleanDisconnects(self);
 	}
 
 	return true;
@@ -419,6 +559,12 @@ CD_StopServer (CDServer* self)
 
 	CD_StopWorkers(self->workers);
 
+	// Stopped after the workers, so the disconnections they hand over land on a
+	// running reactor
+	for (size_t i = 0; i < self->reactors.length; i++) {
+		CD_StopReactor(self->reactors.item[i]);
+	}
+
 	return true;
 }
 
@@ -433,22 +579,61 @@ CD_ServerFlush (CDServer* self, bool now)
 
 		event_base_loopexit(self->event.base, &interval);
 	}
+
+	for (size_t i = 0; i < self->reactors.length; i++) {
+		CD_ReactorFlush(self->reactors.item[i], now);
+	}
 }
 
-void
-CD_ServerCleanDisconnects (CDServer* self)
+void*
+CD_ClientNextPacket (CDClient* client)
 {
-	if (CD_ListLength(self->disconnecting) > 0) {
-		CD_LIST_FOREACH(self->disconnecting, it) {
-			CDClient* client = (CDClient*) CD_ListDelete(self->clients, CD_ListIteratorValue(it));
+	CDServer* self    = client->server;
+	void*     result  = NULL;
+	bool      invalid = false;
+
+	bufferevent_lock(client->buffers->raw);
+	pthread_rwlock_wrlock(&client->lock.status);
 
-			if (client) {
-				CD_DestroyClient(client);
+	if (client->status == CDClientProcess) {
+		if (self->protocol->parsable(client->buffers)) {
+			if ((result = self->protocol->parse(client->buffers, false))) {
+				CD_BufferReadIn(client->buffers, CDNull, CDNull);
 			}
 		}
+		else {
+			invalid = (errno == EILSEQ);
+		}
+
+		// Going idle under the bufferevent lock means data arriving from now
+		// on is seen by the read callback, which will start a new lane
+		if (!result) {
+			client->status = CDClientIdle;
+		}
+	}
 
-		CD_free(CD_ListClear(self->disconnecting));
+	// The lane is over, everything it sent goes out together
+	if (!result) {
+		CD_ClientUncork(client);
 	}
+
+	if (!result && !invalid) {
+		CD_ClientReleaseJob(client);
+	}
+
+	pthread_rwlock_unlock(&client->lock.status);
+	bufferevent_unlock(client->buffers->raw);
+
+	// The lane's job is kept until the kick so the client can't go away
+	if (invalid) {
+		CD_ServerKick(self, client, CD_CreateStringFromCString("bad packet"));
+
+		pthread_rwlock_wrlock(&client->lock.status);
+		CD_ClientReleaseJob(client);
+		pthread_rwlock_unlock(&client->lock.status);
+	}
+
+	return result;
 }
 
 void
@@ -481,9 +666,7 @@ CD_ServerKick (CDServer* self, CDClient* client, CDString* reason)
 
 	CD_EventDispatch(self, "Client.kick", client, reason);
 
-	client->status = CDClientDisconnect;
-
-	CD_AddJob(client->server->workers, CD_CreateExternalJob(CDClientDisconnectJob, (CDPointer) client));
+	CD_ClientDisconnect(client);
 
 	pthread_rwlock_unlock(&client->lock.status);
 }
@@ -20,44 +20,84 @@ cmpAtom (CDSet* self, CDPointer a, CDPointer b)
 }
 
 static
-unsigned int
+uint64_t
 hashAtom (CDSet* self, CDPointer pointer)
 {
 	assert(self);
 
-	return (unsigned long) pointer >> 2;
+	return CD_SetMix((uint64_t) pointer);
 }
 
-CDSet*
-CD_CreateSet (void)
+/**
+ * Find the slot holding the value or the empty slot where it would go
+ */
+static inline
+size_t
+cd_SetSlot (CDSet* self, CDPointer value)
 {
-	return CD_CreateSetWith(4000, NULL, NULL);
+	size_t mask  = self->size - 1;
+	size_t index = self->hash(self, value) & mask;
+
+	while (self->values[index] != CDNull && !self->cmp(self, value, self->values[index])) {
+		index = (index + 1) & mask;
+	}
+
+	return index;
 }
 
-CDSet*
-CD_CreateSetWith (int hint, CDSetCompare cmp, CDSetHash hash)
+static
+void
+cd_SetResize (CDSet* self, size_t size)
 {
-	CDSet*     self;
-	static int primes[] = { 509, 1021, 2053, 4093, 8191, 16381, 32771, 65521, INT_MAX };
-	size_t     i;
+	CDPointer* values = self->values;
+	size_t     old    = self->size;
 
-	assert(hint >= 0);
+	self->size   = size;
+	self->values = CD_calloc(size, sizeof(CDPointer));
 
-	for (i = 1; primes[i] < hint; i++) {
-		continue;
+	for (size_t i = 0; i < old; i++) {
+		if (values[i] != CDNull) {
+			self->values[cd_SetSlot(self, values[i])] = values[i];
+		}
 	}
 
-	self = CD_malloc(sizeof(CDSet) + primes[i - 1] * sizeof(self->buckets[0]));
+	CD_free(values);
+}
 
-	self->size    = primes[i - 1];
-	self->cmp     = cmp  ? cmp  : cmpAtom;
-	self->hash    = hash ? hash : hashAtom;
-	self->buckets = (CDSetMember**) (self + 1);
+/**
+ * Get the number of slots needed to hold length values under the load limit
+ */
+static inline
+size_t
+cd_SetSizeFor (size_t length)
+{
+	size_t size = 16;
 
-	for (size_t i = 0; i < self->size; i++) {
-		self->buckets[i] = NULL;
+	while (size * 3 < length * 4) {
+		size <<= 1;
 	}
 
+	return size;
+}
+
+CDSet*
+CD_CreateSet (void)
+{
+	return CD_CreateSetWith(0, NULL, NULL);
+}
+
+CDSet*
+CD_CreateSetWith (int hint, CDSetCompare cmp, CDSetHash hash)
+{
+	CDSet* self = CD_malloc(sizeof(CDSet));
+
+	assert(hint >= 0);
+
+	self->size   = cd_SetSizeFor(hint);
+	self->values = CD_calloc(self->size, sizeof(CDPointer));
+	self->cmp    = cmp  ? cmp  : cmpAtom;
+	self->hash   = hash ? hash : hashAtom;
+
 	self->length    = 0;
 	self->timestamp = 0;
 
@@ -67,31 +107,18 @@ CD_CreateSetWith (int hint, CDSetCompare cmp, CDSetHash hash)
 CDSet*
 CD_CloneSet (CDSet* self, int hint)
 {
-	CDSet* cloned = CD_CreateSetWith(hint, self->cmp, self->hash);
-
 	assert(self);
-	assert(cloned);
-
-	DO {
-		CDSetMember* oldMember;
-
-		for (size_t i = 0; i < self->size; i++) {
-			for (oldMember = self->buckets[i]; oldMember != NULL; oldMember = oldMember->next) {
-				CDSetMember* newMember = CD_malloc(sizeof(CDSetMember));
-				CDPointer    value     = oldMember->value;
-				int          index     = cloned->hash(cloned, value) % cloned->size;
-
-				assert(newMember);
 
-				newMember->value = value;
-				newMember->next  = cloned->buckets[index];
+	CDSet* cloned = CD_CreateSetWith(CD_Max(hint, (int) self->length), self->cmp, self->hash);
 
-				cloned->buckets[i] = newMember;
-				cloned->length++;
-			}
+	for (size_t i = 0; i < self->size; i++) {
+		if (self->values[i] != CDNull) {
+			cloned->values[cd_SetSlot(cloned, self->values[i])] = self->values[i];
 		}
 	}
 
+	cloned->length = self->length;
+
 	return cloned;
 }
 
@@ -100,104 +127,76 @@ CD_DestroySet (CDSet* self)
 {
 	assert(self);
 
-	if (self->length > 0) {
-		CDSetMember* currentMember;
-		CDSetMember* nextMember;
-
-		for (size_t i = 0; i < self->size; i++) {
-			for (currentMember = self->buckets[i]; currentMember != NULL; currentMember = nextMember) {
-				nextMember = currentMember->next;
-
-				CD_free(currentMember);
-			}
-		}
-	}
-
+	CD_free(self->values);
 	CD_free(self);
 }
 
 bool
 CD_SetHas (CDSet* self, CDPointer value)
 {
-	int          index;
-	CDSetMember* member;
-
 	assert(self);
 	assert(value);
 
-	index = self->hash(self, value) % self->size;
-
-	for (member = self->buckets[index]; member != NULL; member = member->next) {
-		if (self->cmp(self, value, member->value)) {
-			return true;
-		}
-	}
-
-	return false;
+	return self->values[cd_SetSlot(self, value)] != CDNull;
 }
 
 void
 CD_SetPut (CDSet* self, CDPointer value)
 {
-	int          index;
-	CDSetMember* member;
+	size_t index;
 
 	assert(self);
 	assert(value);
 
-	index = self->hash(self, value) % self->size;
-
-	for (member = self->buckets[index]; member != NULL; member = member->next) {
-		if (self->cmp(self, value, member->value)) {
-			break;
-		}
+	if ((self->length + 1) * 4 > self->size * 3) {
+		cd_SetResize(self, self->size << 1);
 	}
 
-	if (member == NULL) {
-		member = CD_malloc(sizeof(CDSetMember));
-
-		assert(member);
+	index = cd_SetSlot(self, value);
 
-		member->value        = value;
-		member->next         = self->buckets[index];
-		self->buckets[index] = member;
+	if (self->values[index] == CDNull) {
 		self->length++;
 	}
-	else {
-		member->value = value;
-	}
 
+	self->values[index] = value;
 	self->timestamp++;
 }
 
 CDPointer
 CD_SetDelete (CDSet* self, CDPointer value)
 {
-	int           index;
-	CDSetMember** members;
+	size_t mask = self->size - 1;
+	size_t index;
+	size_t next;
 
 	assert(self);
 	assert(value);
 
 	self->timestamp++;
 
-	index = self->hash(self, value) % self->size;
+	index = cd_SetSlot(self, value);
 
-	for (members = &self->buckets[index]; *members != NULL; members = &(*members)->next) {
-		if (self->cmp(self, value, (*members)->value)) {
-			CDSetMember* member = *members;
-			*members            = member->next;
-			value               = member->value;
+	if (self->values[index] == CDNull) {
+		return CDNull;
+	}
 
-			CD_free(member);
+	value = self->values[index];
 
-			self->length--;
+	// Shift back the following values of the cluster that would be
+	// unreachable with a hole before them, so no tombstones are needed
+	for (next = (index + 1) & mask; self->values[next] != CDNull; next = (next + 1) & mask) {
+		size_t home = self->hash(self, self->values[next]) & mask;
 
-			return (CDPointer) value;
+		if (((next - home) & mask) >= ((next - index) & mask)) {
+			self->values[index] = self->values[next];
+			index               = next;
 		}
 	}
 
-	return CDNull;
+	self->values[index] = CDNull;
+	self->length--;
+
+	return value;
 }
 
 int
@@ -212,7 +211,6 @@ void
 CD_SetMap (CDSet* self, CDSetApply apply, CDPointer context)
 {
 	unsigned int stamp;
-	CDSetMember* member;
 
 	assert(self);
 	assert(apply);
@@ -220,8 +218,8 @@ CD_SetMap (CDSet* self, CDSetApply apply, CDPointer context)
 	stamp = self->timestamp;
 
 	for (size_t i = 0; i < self->size; i++) {
-		for (member = self->buckets[i]; member != NULL; member = member->next) {
-			apply(self, member->value, context);
+		if (self->values[i] != CDNull) {
+			apply(self, self->values[i], context);
 
 			assert(self->timestamp == stamp);
 		}
@@ -231,17 +229,16 @@ CD_SetMap (CDSet* self, CDSetApply apply, CDPointer context)
 CDPointer*
 CD_SetToArray (CDSet* self, CDPointer end)
 {
-	int          j = 0;
-	CDPointer*   array;
-	CDSetMember* member;
+	int        j = 0;
+	CDPointer* array;
 
 	assert(self);
 
 	array = CD_malloc((self->length + 1) * sizeof(CDPointer));
 
 	for (size_t i = 0; i < self->size; i++) {
-		for (member = self->buckets[i]; member != NULL; member = member->next) {
-			array[j++] = member->value;
+		if (self->values[i] != CDNull) {
+			array[j++] = self->values[i];
 		}
 	}
 
@@ -256,24 +253,20 @@ CD_SetUnion (CDSet* a, CDSet* b)
 	if (a == NULL) {
 		assert(b);
 
-		return CD_CloneSet(b, b->size);
+		return CD_CloneSet(b, 0);
 	}
 
 	if (b == NULL) {
-		return CD_CloneSet(a, a->size);
+		return CD_CloneSet(a, 0);
 	}
 
-	CDSet* result = CD_CloneSet(a, CD_Max(a->size, b->size));
+	CDSet* result = CD_CloneSet(a, a->length + b->length);
 
 	assert(a->cmp == b->cmp && a->hash == b->hash);
 
-	DO {
-		CDSetMember* member;
-
-		for (size_t i = 0; i < b->size; i++) {
-			for (member = b->buckets[i]; member != NULL; member = member->next) {
-				CD_SetPut(result, member->value);
-			}
+	for (size_t i = 0; i < b->size; i++) {
+		if (b->values[i] != CDNull) {
+			CD_SetPut(result, b->values[i]);
 		}
 	}
 
@@ -286,39 +279,24 @@ CD_SetIntersect (CDSet* a, CDSet* b)
 	if (a == NULL) {
 		assert(b);
 
-		return CD_CreateSetWith(b->size, b->cmp, b->hash);
+		return CD_CreateSetWith(0, b->cmp, b->hash);
 	}
 
 	if (b == NULL) {
-		return CD_CreateSetWith(a->size, a->cmp, a->hash);
+		return CD_CreateSetWith(0, a->cmp, a->hash);
 	}
 
 	if (a->length < b->length) {
 		return CD_SetIntersect(b, a);
 	}
 
-	CDSet* result = CD_CreateSetWith(CD_Min(a->size, b->size), a->cmp, a->hash);
+	CDSet* result = CD_CreateSetWith(b->length, a->cmp, a->hash);
 
 	assert(a->cmp == b->cmp && a->hash == b->hash);
 
-	DO {
-		CDSetMember* member;
-
-		for (size_t i = 0; i < b->size; i++) {
-			for (member = b->buckets[i]; member != NULL; member = member->next) {
-				if (CD_SetHas(a, member->value)) {
-					CDSetMember* current = CD_malloc(sizeof(CDSetMember));
-					CDPointer    value   = member->value;
-					int          index   = result->hash(result, value) % result->size;
-
-					assert(current);
-
-					current->value     = value;
-					current->next      = result->buckets[index];
-					result->buckets[i] = current;
-					result->length++;
-				}
-			}
+	for (size_t i = 0; i < b->size; i++) {
+		if (b->values[i] != CDNull && CD_SetHas(a, b->values[i])) {
+			CD_SetPut(result, b->values[i]);
 		}
 	}
 
@@ -331,35 +309,20 @@ CD_SetMinus (CDSet* a, CDSet* b)
 	if (a == NULL) {
 		assert(b);
 
-		return CD_CreateSetWith(b->size, b->cmp, b->hash);
+		return CD_CreateSetWith(0, b->cmp, b->hash);
 	}
 
 	if (b == NULL) {
-		return CD_CloneSet(a, a->size);
+		return CD_CloneSet(a, 0);
 	}
 
-	CDSet* result = CD_CreateSetWith(CD_Min(a->size, b->size), a->cmp, a->hash);
+	CDSet* result = CD_CreateSetWith(a->length, a->cmp, a->hash);
 
 	assert(a->cmp == b->cmp && a->hash == b->hash);
 
-	DO {
-		CDSetMember* member;
-
-		for (size_t i = 0; i < a->size; i++) {
-			for (member = a->buckets[i]; member != NULL; member = member->next) {
-				if (!CD_SetHas(b, member->value)) {
-					CDSetMember* current = CD_malloc(sizeof(CDSetMember));
-					CDPointer    value   = member->value;
-					int          index   = result->hash(result, value) % result->size;
-
-					assert(current);
-
-					current->value     = value;
-					current->next      = result->buckets[index];
-					result->buckets[i] = current;
-					result->length++;
-				}
-			}
+	for (size_t i = 0; i < a->size; i++) {
+		if (a->values[i] != CDNull && !CD_SetHas(b, a->values[i])) {
+			CD_SetPut(result, a->values[i]);
 		}
 	}
 
@@ -372,14 +335,14 @@ CD_SetDifference (CDSet* a, CDSet* b)
 	if (a == NULL) {
 		assert(b);
 
-		return CD_CloneSet(b, b->size);
+		return CD_CloneSet(b, 0);
 	}
 
 	if (b == NULL) {
-		return CD_CloneSet(a, a->size);
+		return CD_CloneSet(a, 0);
 	}
 
-	CDSet* result = CD_CreateSetWith(CD_Min(a->size, b->size), a->cmp, a->hash);
+	CDSet* result = CD_CreateSetWith(a->length + b->length, a->cmp, a->hash);
 
 	assert(a->cmp == b->cmp && a->hash == b->hash);
 
@@ -389,24 +352,9 @@ CD_SetDifference (CDSet* a, CDSet* b)
 		a = sets[i];
 		b = sets[i + 1];
 
-		DO {
-			CDSetMember* member;
-
-			for (size_t i = 0; i < b->size; i++) {
-				for (member = b->buckets[i]; member != NULL; member = member->next) {
-					if (!CD_SetHas(a, member->value)) {
-						CDSetMember* current = CD_malloc(sizeof(CDSetMember));
-						CDPointer    value   = member->value;
-						int          index   = result->hash(result, value) % result->size;
-
-						assert(current);
-
-						current->value     = value;
-						current->next      = result->buckets[index];
-						result->buckets[i] = current;
-						result->length++;
-					}
-				}
+		for (size_t j = 0; j < b->size; j++) {
+			if (b->values[j] != CDNull && !CD_SetHas(a, b->values[j])) {
+				CD_SetPut(result, b->values[j]);
 			}
 		}
 	}
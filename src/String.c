@@ -25,6 +25,12 @@
 
 #include <libgen.h>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include <craftd/common.h>
 
 static inline
@@ -42,67 +48,189 @@ cd_MakeStringInternal (CDString* self)
 	self->external = false;
 }
 
+/**
+ * Count the characters in a buffer, which are the bytes that aren't UTF-8
+ * continuation bytes, and tell if they're all ASCII.
+ *
+ * Continuation bytes are the ones below -64 as signed bytes, so the vector
+ * paths count them with a compare and a movemask.
+ */
 static inline
 size_t
-cd_UTF8_nextCharLength (char data)
+cd_UTF8_count (const uint8_t* data, size_t size, bool* ascii)
 {
-	if ((data & 0x80) == 0x00) {
-		return 1;
+	size_t continuation = 0;
+	int    high         = 0;
+	size_t i            = 0;
+
+#if defined(__AVX2__)
+	for (; i + 32 <= size; i += 32) {
+		__m256i  chunk = _mm256_loadu_si256((const __m256i*) (data + i));
+		uint32_t mask  = _mm256_movemask_epi8(chunk);
+
+		if (mask) {
+			high          = 1;
+			continuation += __builtin_popcount(_mm256_movemask_epi8(_mm256_cmpgt_epi8(_mm256_set1_epi8(-64), chunk)));
+		}
 	}
-	
-	if ((data & 0xE0) == 0xC0) {
-		return 2;
+#endif
+
+#if defined(__SSE2__)
+	for (; i + 16 <= size; i += 16) {
+		__m128i  chunk = _mm_loadu_si128((const __m128i*) (data + i));
+		uint32_t mask  = _mm_movemask_epi8(chunk);
+
+		if (mask) {
+			high          = 1;
+			continuation += __builtin_popcount(_mm_movemask_epi8(_mm_cmplt_epi8(chunk, _mm_set1_epi8(-64))));
+		}
 	}
-	
-	if ((data & 0xF0) == 0xE0) {
-		return 3;
+#endif
+
+	for (; i < size; i++) {
+		high         |= data[i] & 0x80;
+		continuation += (data[i] & 0xC0) == 0x80;
 	}
-	
-	if ((data & 0xF8) == 0xF0) {
-		return 4;
+
+	if (ascii) {
+		*ascii = !high;
 	}
-	
-	return 0;
+
+	return size - continuation;
 }
 
+/**
+ * Get the byte offset of a character, or size if the buffer has fewer
+ */
+static inline
 size_t
-CD_UTF8_strlen (const char* data)
+cd_UTF8_offset (const uint8_t* data, size_t size, size_t offset)
 {
-	size_t result  = 0;
-	size_t i       = 0;
+	size_t i = 0;
+
+#if defined(__SSE2__)
+	// Skip the chunks holding fewer characters than the ones left to skip
+	for (; i + 16 <= size; i += 16) {
+		__m128i chunk      = _mm_loadu_si128((const __m128i*) (data + i));
+		size_t  characters = 16 - __builtin_popcount(_mm_movemask_epi8(_mm_cmplt_epi8(chunk, _mm_set1_epi8(-64))));
+
+		if (characters > offset) {
+			break;
+		}
 
-	while (data[i] != '\0') {
-		i += cd_UTF8_nextCharLength(data[i]);
-		result++;
+		offset -= characters;
 	}
+#endif
 
-	return result;
+	for (; i < size; i++) {
+		if ((data[i] & 0xC0) != 0x80) {
+			if (offset == 0) {
+				return i;
+			}
+
+			offset--;
+		}
+	}
+
+	return size;
 }
 
 size_t
-CD_UTF8_strnlen (const char* data, size_t limit)
+CD_UTF8_strlen (const char* data)
 {
-	size_t result  = 0;
-	size_t i       = 0;
-
-	while (data[i] != '\0' && i < limit) {
-		i += cd_UTF8_nextCharLength(data[i]);
-		result++;
-	}
+	return cd_UTF8_count((const uint8_t*) data, strlen(data), NULL);
+}
 
-	return result;
+size_t
+CD_UTF8_strnlen (const char* data, size_t limit)
+{
+	return cd_UTF8_count((const uint8_t*) data, strnlen(data, limit), NULL);
 }
 
 size_t
 CD_UTF8_offset (const char* data, size_t offset)
 {
-	size_t result = 0;
+	return cd_UTF8_offset((const uint8_t*) data, strlen(data), offset);
+}
+
+bool
+CD_UTF8_valid (const char* data, size_t size)
+{
+	const uint8_t* bytes = (const uint8_t*) data;
+	size_t         i     = 0;
 
-	for (size_t i = 0; i < offset; i++) {
-		result += cd_UTF8_nextCharLength(data[result]);
+	while (i < size) {
+		// Almost everything is ASCII, skip it a vector at a time
+#if defined(__AVX2__)
+		while (i + 32 <= size && !_mm256_movemask_epi8(_mm256_loadu_si256((const __m256i*) (bytes + i)))) {
+			i += 32;
+		}
+#endif
+
+#if defined(__SSE2__)
+		while (i + 16 <= size && !_mm_movemask_epi8(_mm_loadu_si128((const __m128i*) (bytes + i)))) {
+			i += 16;
+		}
+#endif
+
+		if (i >= size) {
+			break;
+		}
+
+		uint8_t lead   = bytes[i];
+		uint8_t low    = 0x80;
+		uint8_t high   = 0xBF;
+		size_t  length = 1;
+
+		if (lead < 0x80) {
+			i++;
+
+			continue;
+		}
+
+		// The ranges of the second byte rule out overlong forms, surrogates
+		// and code points past U+10FFFF
+		if (lead >= 0xC2 && lead <= 0xDF) {
+			length = 2;
+		}
+		else if (lead >= 0xE0 && lead <= 0xEF) {
+			length = 3;
+
+			if (lead == 0xE0) {
+				low = 0xA0;
+			}
+			else if (lead == 0xED) {
+				high = 0x9F;
+			}
+		}
+		else if (lead >= 0xF0 && lead <= 0xF4) {
+			length = 4;
+
+			if (lead == 0xF0) {
+				low = 0x90;
+			}
+			else if (lead == 0xF4) {
+				high = 0x8F;
+			}
+		}
+		else {
+			return false;
+		}
+
+		if (i + length > size || bytes[i + 1] < low || bytes[i + 1] > high) {
+			return false;
+		}
+
+		for (size_t j = 2; j < length; j++) {
+			if ((bytes[i + j] & 0xC0) != 0x80) {
+				return false;
+			}
+		}
+
+		i += length;
 	}
 
-	return result;
+	return true;
 }
 
 static
@@ -111,7 +239,19 @@ cd_UpdateLength (CDString* self)
 {
 	assert(self);
 
-	self->length = CD_UTF8_strnlen(CD_StringContent(self), self->raw->slen);
+	self->length = cd_UTF8_count(self->raw->data, strnlen(CD_StringContent(self), self->raw->slen), &self->ascii);
+}
+
+/**
+ * Account for a String added in whole to self, the characters of the two
+ * just add up
+ */
+static inline
+void
+cd_AddLength (CDString* self, CDString* added)
+{
+	self->length += added->length;
+	self->ascii   = self->ascii && added->ascii;
 }
 
 CDString*
@@ -121,6 +261,7 @@ CD_CreateString (void)
 
 	self->raw      = bfromcstr("");
 	self->length   = 0;
+	self->ascii    = true;
 	self->external = false;
 
 	assert(self->raw);
@@ -229,7 +370,9 @@ CD_CreateStringFromFormatList (const char* format, va_list ap)
 CDString*
 CD_CreateStringFromOffset (CDString* string, size_t offset, size_t limit)
 {
-	const char* data;
+	const uint8_t* content;
+	size_t         size;
+	size_t         start;
 
 	assert(string);
 
@@ -237,16 +380,24 @@ CD_CreateStringFromOffset (CDString* string, size_t offset, size_t limit)
 		return NULL;
 	}
 
-	data = CD_StringContent(string) + CD_UTF8_offset(CD_StringContent(string), offset);
+	content = (const uint8_t*) CD_StringContent(string);
+	size    = CD_StringSize(string);
+
+	// Characters are bytes in ASCII Strings, so indexing them is free
+	start = string->ascii ? offset : cd_UTF8_offset(content, size, offset);
+	size -= start;
 
 	if (limit == 0) {
-		limit = strlen(data);
+		limit = strnlen((const char*) content + start, size);
+	}
+	else if (string->ascii) {
+		limit = (limit < size) ? limit : size;
 	}
 	else {
-		limit = CD_UTF8_offset(data, limit);
+		limit = cd_UTF8_offset(content + start, size, limit);
 	}
 
-	return CD_CreateStringFromBufferCopy(data, limit);
+	return CD_CreateStringFromBufferCopy((const char*) content + start, limit);
 }
 
 CDString*
@@ -259,7 +410,8 @@ CD_CloneString (CDString* self)
 
 	assert(cloned->raw);
 
-	cd_UpdateLength(cloned);
+	cloned->length = self->length;
+	cloned->ascii  = self->ascii;
 
 	return cloned;
 }
@@ -305,9 +457,10 @@ CD_CharAtSet (CDString* self, size_t index, CDString* set)
 
 	cd_MakeStringInternal(self);
 
-	size_t offset = CD_UTF8_offset((const char*) self->raw->data, index);
+	size_t offset = self->ascii ? index : cd_UTF8_offset(self->raw->data, self->raw->slen, index);
+	size_t length = self->ascii ? 1 : cd_UTF8_offset(self->raw->data + offset, self->raw->slen - offset, 1);
 
-	if (breplace(self->raw, offset, cd_UTF8_nextCharLength(self->raw->data[offset]), set->raw, '\0') == BSTR_OK) {
+	if (breplace(self->raw, offset, length, set->raw, '\0') == BSTR_OK) {
 		cd_UpdateLength(self);
 	}
 	else {
@@ -325,8 +478,10 @@ CD_InsertString (CDString* self, CDString* insert, size_t position)
 
 	cd_MakeStringInternal(self);
 
-	if (binsert(self->raw, CD_UTF8_offset(CD_StringContent(self), position), insert->raw, '\0') == BSTR_OK) {
-		cd_UpdateLength(self);
+	size_t offset = self->ascii ? position : cd_UTF8_offset(self->raw->data, self->raw->slen, position);
+
+	if (binsert(self->raw, offset, insert->raw, '\0') == BSTR_OK) {
+		cd_AddLength(self, insert);
 	}
 	else {
 		self = NULL;
@@ -344,7 +499,7 @@ CD_AppendString (CDString* self, CDString* append)
 	cd_MakeStringInternal(self);
 
 	if (binsert(self->raw, self->raw->slen, append->raw, '\0') == BSTR_OK) {
-		cd_UpdateLength(self);
+		cd_AddLength(self, append);
 	}
 	else {
 		self = NULL;
@@ -362,7 +517,7 @@ CD_AppendStringAndClean (CDString* self, CDString* append)
 	cd_MakeStringInternal(self);
 
 	if (binsert(self->raw, self->raw->slen, append->raw, '\0') == BSTR_OK) {
-		cd_UpdateLength(self);
+		cd_AddLength(self, append);
 	}
 	else {
 		self = NULL;
@@ -400,7 +555,7 @@ CD_PrependString (CDString* self, CDString* append)
 	cd_MakeStringInternal(self);
 
 	if (binsert(self->raw, 0, append->raw, '\0') == BSTR_OK) {
-		cd_UpdateLength(self);
+		cd_AddLength(self, append);
 	}
 	else {
 		self = NULL;
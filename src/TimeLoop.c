@@ -26,11 +26,253 @@
 #include <craftd/TimeLoop.h>
 #include <craftd/Logger.h>
 
+static inline
+uint64_t
+cd_TimeLoopClock (void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static inline
+uint64_t
+cd_TimeLoopTicks (float seconds)
+{
+	// Rounded, 0.29 seconds would be 28 ticks if it was truncated
+	uint64_t ticks = (uint64_t) (seconds * (1000 / CD_TIMELOOP_RESOLUTION) + 0.5f);
+
+	return ticks > 0 ? ticks : 1;
+}
+
+static inline
+void
+cd_TimeLoopLink (CDTimer** slot, CDTimer* timer)
+{
+	timer->next     = *slot;
+	timer->previous = slot;
+
+	if (timer->next) {
+		timer->next->previous = &timer->next;
+	}
+
+	*slot = timer;
+}
+
+/**
+ * Put a timer in the slot of the level its distance falls in, must be called
+ * with the wheel lock held.
+ */
+static
+void
+cd_TimeLoopSchedule (CDTimeLoop* self, CDTimer* timer)
+{
+	uint64_t expires = timer->expires;
+	uint64_t delta;
+	int      level;
+
+	if (expires <= self->wheel.now) {
+		expires = timer->expires = self->wheel.now + 1;
+	}
+
+	delta = expires - self->wheel.now;
+
+	// Out of the wheel's reach, it's cascaded again from the last level
+	if (delta >= (uint64_t) 1 << (CD_TIMELOOP_BITS * CD_TIMELOOP_LEVELS)) {
+		delta   = ((uint64_t) 1 << (CD_TIMELOOP_BITS * CD_TIMELOOP_LEVELS)) - 1;
+		expires = self->wheel.now + delta;
+	}
+
+	for (level = 0; level < CD_TIMELOOP_LEVELS - 1; level++) {
+		if (delta < (uint64_t) 1 << (CD_TIMELOOP_BITS * (level + 1))) {
+			break;
+		}
+	}
+
+	cd_TimeLoopLink(&self->wheel.slots[level][(expires >> (CD_TIMELOOP_BITS * level)) & (CD_TIMELOOP_SLOTS - 1)], timer);
+}
+
+static inline
+void
+cd_TimeLoopUnschedule (CDTimer* timer)
+{
+	*timer->previous = timer->next;
+
+	if (timer->next) {
+		timer->next->previous = timer->previous;
+	}
+
+	timer->next     = NULL;
+	timer->previous = NULL;
+}
+
+/**
+ * Move the timers of a slot of an upper level down to the levels they fit in
+ * now, must be called with the wheel lock held.
+ */
+static
+void
+cd_TimeLoopCascade (CDTimeLoop* self, int level)
+{
+	CDTimer** slot  = &self->wheel.slots[level][(self->wheel.now >> (CD_TIMELOOP_BITS * level)) & (CD_TIMELOOP_SLOTS - 1)];
+	CDTimer*  timer = *slot;
+
+	*slot = NULL;
+
+	while (timer) {
+		CDTimer* next = timer->next;
+
+		// Those due now go in the level 0 slot run right after the cascade,
+		// scheduling them would push them to the next tick
+		if (timer->expires == self->wheel.now) {
+			cd_TimeLoopLink(&self->wheel.slots[0][self->wheel.now & (CD_TIMELOOP_SLOTS - 1)], timer);
+		}
+		else {
+			cd_TimeLoopSchedule(self, timer);
+		}
+
+		timer = next;
+	}
+}
+
+static
+void
+cd_TimeLoopTick (evutil_socket_t fd, short event, CDTimeLoop* self)
+{
+	CD_TimeLoopAdvance(self, (cd_TimeLoopClock() - self->wheel.start) / (CD_TIMELOOP_RESOLUTION * 1000000));
+}
+
+void
+CD_TimeLoopAdvance (CDTimeLoop* self, uint64_t target)
+{
+	CDTimer* expired = NULL;
+	CDTimer* last    = NULL;
+
+	assert(self);
+
+	pthread_spin_lock(&self->lock.wheel);
+	while (self->wheel.now < target) {
+		self->wheel.now++;
+
+		// The upper levels are cascaded first so their timers can reach level 0
+		int level = 0;
+
+		while (level < CD_TIMELOOP_LEVELS - 1 && (self->wheel.now & (((uint64_t) 1 << (CD_TIMELOOP_BITS * (level + 1))) - 1)) == 0) {
+			level++;
+		}
+
+		for (; level > 0; level--) {
+			cd_TimeLoopCascade(self, level);
+		}
+
+		CDTimer** slot  = &self->wheel.slots[0][self->wheel.now & (CD_TIMELOOP_SLOTS - 1)];
+		CDTimer*  timer = *slot;
+
+		*slot = NULL;
+
+		while (timer) {
+			CDTimer* next = timer->next;
+
+			timer->next     = NULL;
+			timer->previous = NULL;
+
+			if (last) {
+				last->next = timer;
+			}
+			else {
+				expired = timer;
+			}
+
+			last  = timer;
+			timer = next;
+		}
+	}
+	pthread_spin_unlock(&self->lock.wheel);
+
+	while (expired) {
+		CDTimer* timer = expired;
+		bool     cancelled;
+
+		expired     = timer->next;
+		timer->next = NULL;
+
+		pthread_spin_lock(&self->lock.wheel);
+		cancelled = timer->cancelled;
+		pthread_spin_unlock(&self->lock.wheel);
+
+		if (!cancelled) {
+			timer->callback(-1, EV_TIMEOUT, (void*) timer->data);
+		}
+
+		pthread_spin_lock(&self->lock.wheel);
+		if (timer->cancelled) {
+			CD_free(timer);
+		}
+		else if (timer->interval > 0) {
+			// Runs missed while late are skipped, the interval keeps its phase
+			do {
+				timer->expires += timer->interval;
+			} while (timer->expires <= self->wheel.now);
+
+			cd_TimeLoopSchedule(self, timer);
+		}
+		else {
+			CD_MapDelete(self->callbacks, timer->id);
+			CD_free(timer);
+		}
+		pthread_spin_unlock(&self->lock.wheel);
+	}
+}
+
+static
+int
+cd_TimeLoopAdd (CDTimeLoop* self, float seconds, bool repeat, event_callback_fn callback, CDPointer data)
+{
+	CDTimer* timer = CD_malloc(sizeof(CDTimer));
+	int      result;
+
+	timer->interval  = repeat ? cd_TimeLoopTicks(seconds) : 0;
+	timer->cancelled = false;
+	timer->callback  = callback;
+	timer->data      = data ? data : (CDPointer) self->server;
+	timer->next      = NULL;
+	timer->previous  = NULL;
+
+	pthread_spin_lock(&self->lock.wheel);
+	if ((self->last + 1) == 0) {
+		self->last++;
+	}
+
+	timer->id      = result = self->last++;
+	timer->expires = self->wheel.now + cd_TimeLoopTicks(seconds);
+
+	CD_MapPut(self->callbacks, result, (CDPointer) timer);
+	cd_TimeLoopSchedule(self, timer);
+	pthread_spin_unlock(&self->lock.wheel);
+
+	return result;
+}
+
 static
 void
-cd_KeepTimeLoopAlive (void)
+cd_TimeLoopClear (CDTimeLoop* self, int id)
 {
-	return;
+	pthread_spin_lock(&self->lock.wheel);
+	CDTimer* timer = (CDTimer*) CD_MapDelete(self->callbacks, id);
+
+	if (timer) {
+		if (timer->previous) {
+			cd_TimeLoopUnschedule(timer);
+			CD_free(timer);
+		}
+		else {
+			// It's running or about to, cd_TimeLoopTick frees it
+			timer->cancelled = true;
+		}
+	}
+	pthread_spin_unlock(&self->lock.wheel);
 }
 
 CDTimeLoop*
@@ -38,7 +280,7 @@ CD_CreateTimeLoop (struct _CDServer* server)
 {
 	CDTimeLoop* self = CD_malloc(sizeof(CDTimeLoop));
 
-	if (pthread_spin_init(&self->lock.last, PTHREAD_PROCESS_PRIVATE) != 0) {
+	if (pthread_spin_init(&self->lock.wheel, PTHREAD_PROCESS_PRIVATE) != 0) {
 		CD_abort("pthread spinlock failed to initialize");
 	}
 
@@ -56,7 +298,19 @@ CD_CreateTimeLoop (struct _CDServer* server)
 	self->callbacks  = CD_CreateMap();
 	self->last       = INT_MIN;
 
-	CD_SetInterval(self, 10000000, (event_callback_fn) cd_KeepTimeLoopAlive, CDNull);
+	self->wheel.start = cd_TimeLoopClock();
+	self->wheel.now   = 0;
+
+	memset(self->wheel.slots, 0, sizeof(self->wheel.slots));
+
+	// The wheel's own timer also keeps the loop from running out of events
+	struct timeval resolution = { 0, CD_TIMELOOP_RESOLUTION * 1000 };
+
+	self->event.tick = event_new(self->event.base, -1, EV_PERSIST, (event_callback_fn) cd_TimeLoopTick, self);
+
+	if (evtimer_add(self->event.tick, &resolution) < 0) {
+		CD_abort("could not add the TimeLoop tick");
+	}
 
 	return self;
 }
@@ -66,11 +320,16 @@ CD_DestroyTimeLoop (CDTimeLoop* self)
 {
 	CD_StopTimeLoop(self);
 
+	event_free(self->event.tick);
 	event_base_free(self->event.base);
 
+	CD_MAP_FOREACH(self->callbacks, it) {
+		CD_free((CDTimer*) CD_MapIteratorValue(it));
+	}
+
 	CD_DestroyMap(self->callbacks);
 
-	pthread_spin_destroy(&self->lock.last);
+	pthread_spin_destroy(&self->lock.wheel);
 
 	CD_free(self);
 }
@@ -100,69 +359,23 @@ CD_StopTimeLoop (CDTimeLoop* self)
 int
 CD_SetTimeout (CDTimeLoop* self, float seconds, event_callback_fn callback, CDPointer data)
 {
-	struct timeval timeout      = { (int) seconds, (seconds - (int) seconds) * 1000000 };
-	struct event*  timeoutEvent = event_new(self->event.base, -1, 0, callback, (void*) (data ? data : (CDPointer) self->server));
-	int            result;
-
-	if (evtimer_add(timeoutEvent, &timeout) < 0) {
-		SERR(self->server, "could not add a timeout");
-		event_free(timeoutEvent);
-		return 0;
-	}
-
-	pthread_spin_lock(&self->lock.last);
-	if ((self->last + 1) == 0) {
-		self->last++;
-	}
-
-	CD_MapPut(self->callbacks, (result = self->last++), (CDPointer) timeoutEvent);
-	pthread_spin_unlock(&self->lock.last);
-
-	return result;
+	return cd_TimeLoopAdd(self, seconds, false, callback, data);
 }
 
 void
 CD_ClearTimeout (CDTimeLoop* self, int id)
 {
-	struct event* clear = (struct event*) CD_MapDelete(self->callbacks, id);
-
-	if (clear) {
-		evtimer_del(clear);
-		event_free(clear);
-	}
+	cd_TimeLoopClear(self, id);
 }
 
 int
 CD_SetInterval (CDTimeLoop* self, float seconds, event_callback_fn callback, CDPointer data)
 {
-	struct timeval interval      = { (int) seconds, (seconds - (int) seconds) * 1000000 };
-	struct event*  intervalEvent = event_new(self->event.base, -1, EV_PERSIST, callback, (void*) (data ? data : (CDPointer) self->server));
-	int            result;
-
-	if (evtimer_add(intervalEvent, &interval) < 0) {
-		SERR(self->server, "could not add an interval");
-		event_free(intervalEvent);
-		return 0;
-	}
-
-	pthread_spin_lock(&self->lock.last);
-	if ((self->last + 1) == 0) {
-		self->last++;
-	}
-
-	CD_MapPut(self->callbacks, (result = self->last++), (CDPointer) intervalEvent);
-	pthread_spin_unlock(&self->lock.last);
-
-	return result;
+	return cd_TimeLoopAdd(self, seconds, true, callback, data);
 }
 
 void
 CD_ClearInterval (CDTimeLoop* self, int id)
 {
-	struct event* clear = (struct event*) CD_MapDelete(self->callbacks, id);
-
-	if (clear) {
-		evtimer_del(clear);
-		event_free(clear);
-	}
+	cd_TimeLoopClear(self, id);
 }
@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <craftd/common.h>
+#include <craftd/Vector.h>
+
+CDVector*
+CD_CreateVector (void)
+{
+	CDVector* self = CD_malloc(sizeof(CDVector));
+
+	if (pthread_rwlock_init(&self->lock, NULL) != 0) {
+		CD_abort("pthread rwlock failed to initialize");
+	}
+
+	self->item   = NULL;
+	self->length = 0;
+	self->size   = 0;
+
+	return self;
+}
+
+CDVector*
+CD_CloneVector (CDVector* self)
+{
+	CDVector* cloned = CD_CreateVector();
+
+	assert(self);
+
+	if (self->length > 0) {
+		CD_VectorReserve(cloned, self->length);
+		memcpy(cloned->item, self->item, self->length * sizeof(CDPointer));
+
+		cloned->length = self->length;
+	}
+
+	return cloned;
+}
+
+void
+CD_DestroyVector (CDVector* self)
+{
+	assert(self);
+
+	CD_free(self->item);
+
+	pthread_rwlock_destroy(&self->lock);
+
+	CD_free(self);
+}
+
+void
+CD_VectorReserve (CDVector* self, size_t size)
+{
+	size_t grown;
+
+	assert(self);
+
+	if (size <= self->size) {
+		return;
+	}
+
+	for (grown = self->size > 0 ? self->size : 8; grown < size; grown <<= 1) {
+		continue;
+	}
+
+	self->item = CD_realloc(self->item, grown * sizeof(CDPointer));
+	self->size = grown;
+}
+
+CDVector*
+CD_VectorPush (CDVector* self, CDPointer value)
+{
+	assert(self);
+
+	if (self->length == self->size) {
+		CD_VectorReserve(self, self->length + 1);
+	}
+
+	self->item[self->length++] = value;
+
+	return self;
+}
+
+CDPointer
+CD_VectorPop (CDVector* self)
+{
+	assert(self);
+
+	if (self->length == 0) {
+		return CDNull;
+	}
+
+	return self->item[--self->length];
+}
+
+ssize_t
+CD_VectorIndexOf (CDVector* self, CDPointer value)
+{
+	assert(self);
+
+	for (size_t i = 0; i < self->length; i++) {
+		if (self->item[i] == value) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+bool
+CD_VectorContains (CDVector* self, CDPointer value)
+{
+	return CD_VectorIndexOf(self, value) >= 0;
+}
+
+CDPointer
+CD_VectorDeleteAt (CDVector* self, size_t index)
+{
+	CDPointer result;
+
+	assert(self);
+	assert(index < self->length);
+
+	result = self->item[index];
+
+	memmove(&self->item[index], &self->item[index + 1], (self->length - index - 1) * sizeof(CDPointer));
+	self->length--;
+
+	return result;
+}
+
+CDPointer
+CD_VectorDelete (CDVector* self, CDPointer value)
+{
+	ssize_t index = CD_VectorIndexOf(self, value);
+
+	if (index < 0) {
+		return CDNull;
+	}
+
+	self->item[index] = self->item[--self->length];
+
+	return value;
+}
+
+size_t
+CD_VectorDeleteAll (CDVector* self, CDPointer value)
+{
+	size_t kept = 0;
+	size_t result;
+
+	assert(self);
+
+	for (size_t i = 0; i < self->length; i++) {
+		if (self->item[i] != value) {
+			self->item[kept++] = self->item[i];
+		}
+	}
+
+	result       = self->length - kept;
+	self->length = kept;
+
+	return result;
+}
+
+void
+CD_VectorClear (CDVector* self)
+{
+	assert(self);
+
+	self->length = 0;
+}
@@ -50,7 +50,9 @@ CD_DestroyWorker (CDWorker* self)
 	assert(self);
 
 	if (self->thread) {
-		self->working = false;
+		__atomic_store_n(&self->working, false, __ATOMIC_SEQ_CST);
+
+		CD_QueueWakeAll(self->workers->jobs);
 		pthread_join(self->thread, NULL);
 	}
 
@@ -61,137 +63,147 @@ CD_DestroyWorker (CDWorker* self)
 	CD_free(self);
 }
 
-bool
-CD_RunWorker (CDWorker* self)
+/**
+ * Run the job the worker is holding, the job is destroyed once done
+ */
+static
+void
+cd_WorkerRunJob (CDWorker* self)
 {
-	assert(self);
-
-	self->stopped = false;
+	if (self->job->type == CDCustomJob) {
+		CDCustomJobData* data = (CDCustomJobData*) self->job->data;
 
-	CD_EventDispatch(self->server, "Worker.start!", self);
-
-	SLOG(self->server, LOG_INFO, "worker %d started", self->id);
-
-	while (self->working) {
-		self->job = NULL;
-
-		if (!CD_HasJobs(self->workers)) {
-			pthread_mutex_lock(&self->workers->lock.mutex);
-
-			SDEBUG(self->server, "worker %d ready", self->id);
+		data->callback(data->data);
 
-			pthread_cond_wait(&self->workers->lock.condition, &self->workers->lock.mutex);
+		CD_DestroyJob(self->job);
+	}
+	else if (CD_JOB_IS_PLAYER(self->job)) {
+		CDClient* client;
 
-			pthread_mutex_unlock(&self->workers->lock.mutex);
+		if (self->job->type == CDClientProcessJob) {
+			client = ((CDClientProcessJobData*) self->job->data)->client;
+		}
+		else {
+			client = (CDClient*) self->job->data;
 		}
 
-		if (!self->working) {
-			break;
+		if (!client) {
+			CD_DestroyJob(self->job);
+			return;
 		}
 
-		self->job = CD_NextJob(self->workers);
+		pthread_rwlock_wrlock(&client->lock.status);
+		if (client->status == CDClientDisconnect) {
+			if (self->job->type != CDClientDisconnectJob) {
+				CD_DestroyJob(self->job);
+				self->job = NULL;
 
-		if (!self->job) {
-			SDEBUG(self->server, "no jobs for %d :<", self->id);
-			continue;
+				// Connect and process jobs are the ones corking the client
+				CD_ClientUncork(client);
+				CD_ClientReleaseJob(client);
+			}
 		}
+		pthread_rwlock_unlock(&client->lock.status);
 
-		SDEBUG(self->server, "worker %d running", self->id);
+		if (!self->job) {
+			return;
+		}
 
-		if (self->job->type == CDCustomJob) {
-			CDCustomJobData* data = (CDCustomJobData*) self->job->data;
+		if (self->job->type == CDClientConnectJob) {
+			CD_EventDispatch(self->server, "Client.connect", client);
 
-			data->callback(data->data);
+			pthread_rwlock_wrlock(&client->lock.status);
+			if (client->status != CDClientDisconnect) {
+				client->status = CDClientIdle;
+			}
+			pthread_rwlock_unlock(&client->lock.status);
 
 			CD_DestroyJob(self->job);
-		}
-		else if (CD_JOB_IS_PLAYER(self->job)) {
-			CDClient* client;
 
-			if (self->job->type == CDClientProcessJob) {
-				client = ((CDClientProcessJobData*) self->job->data)->client;
-			}
-			else {
-				client = (CDClient*) self->job->data;
+			if (CD_BufferLength(client->buffers->input) > 0) {
+				CD_ReadFromClient(client);
 			}
 
-			if (!client) {
-				CD_DestroyJob(self->job);
-				continue;
-			}
+			CD_ClientUncork(client);
 
-			pthread_rwlock_rdlock(&client->lock.status);
-			if (client->status == CDClientDisconnect) {
-				if (self->job->type != CDClientDisconnectJob) {
-					CD_DestroyJob(self->job);
-					self->job = NULL;
-					client->jobs--;
-				}
-			}
+			pthread_rwlock_wrlock(&client->lock.status);
+			CD_ClientReleaseJob(client);
 			pthread_rwlock_unlock(&client->lock.status);
-
-			if (!self->job) {
-				continue;
+		}
+		else if (self->job->type == CDClientProcessJob) {
+			CDClientProcessJobData* data    = (CDClientProcessJobData*) self->job->data;
+			size_t                  packets = 0;
+
+			// The job is the client's lane, it runs every packet that can be
+			// parsed, including the ones arriving while it runs, but only up to
+			// CD_WORKERS_LANE at a time so a flooding client can't hold a worker
+			while (packets < CD_WORKERS_LANE && (data->packet = CD_ClientNextPacket(client))) {
+				CD_EventDispatch(self->server, "Client.process", client, data->packet);
+				CD_EventDispatch(self->server, "Client.processed", client, data->packet);
+
+				packets++;
 			}
 
-			if (self->job->type == CDClientConnectJob) {
-				CD_EventDispatch(self->server, "Client.connect", client);
+			if (packets == CD_WORKERS_LANE) {
+				// The lane stays open and waits its turn behind the other jobs,
+				// what it sent so far goes out meanwhile
+				data->packet = NULL;
 
-				pthread_rwlock_wrlock(&client->lock.status);
-				if (client->status != CDClientDisconnect) {
-					client->status = CDClientIdle;
-				}
-				pthread_rwlock_unlock(&client->lock.status);
+				CD_ClientUncork(client);
+				CD_ClientCork(client);
 
-				CD_DestroyJob(self->job);
+				CD_AddJob(self->workers, self->job);
 
-				if (CD_BufferLength(client->buffers->input) > 0) {
-					CD_ReadFromClient(client);
-				}
+				self->job = NULL;
 			}
-			else if (self->job->type == CDClientProcessJob) {
-				CD_EventDispatch(self->server, "Client.process", client,
-					((CDClientProcessJobData*) self->job->data)->packet);
+			else {
+				CD_DestroyJob(self->job);
+			}
+		}
+		else if (self->job->type == CDClientDisconnectJob) {
+			// It's only scheduled once the client has no other jobs, see
+			// CD_ClientReleaseJob
+			CD_EventDispatch(self->server, "Client.disconnect", client, (bool) ERROR(client));
 
-				CD_EventDispatch(self->server, "Client.processed", client,
-					((CDClientProcessJobData*) self->job->data)->packet);
+			// The client is destroyed on the reactor running its bufferevent
+			CD_ReactorDisconnect(client->reactor, client);
 
-				pthread_rwlock_wrlock(&client->lock.status);
-				if (client->status != CDClientDisconnect) {
-					client->status = CDClientIdle;
-				}
+			CD_DestroyJob(self->job);
+		}
+	}
+}
 
-				client->jobs--;
-				pthread_rwlock_unlock(&client->lock.status);
+bool
+CD_RunWorker (CDWorker* self)
+{
+	assert(self);
 
-				CD_DestroyJob(self->job);
+	self->stopped = false;
 
-				if (CD_BufferLength(client->buffers->input) > 0) {
-					CD_ReadFromClient(client);
-				}
-			}
-			else if (self->job->type == CDClientDisconnectJob) {
-				while (true) {
-					pthread_rwlock_rdlock(&client->lock.status);
+	CD_EventDispatch(self->server, "Worker.start!", self);
+
+	SLOG(self->server, LOG_INFO, "worker %d started", self->id);
+
+	while (self->working) {
+		CDJob* jobs[CD_WORKERS_BATCH];
+		size_t length;
 
-					if (client->jobs < 1) {
-						pthread_rwlock_unlock(&client->lock.status);
-						break;
-					}
+		self->job = NULL;
 
-					pthread_rwlock_unlock(&client->lock.status);
+		if ((length = CD_NextJobs(self->workers, jobs)) == 0) {
+			SDEBUG(self->server, "worker %d ready", self->id);
 
-					usleep(1000);
-				}
+			CD_WaitJobs(self->workers, self);
 
-				CD_EventDispatch(self->server, "Client.disconnect", client, (bool) ERROR(client));
+			continue;
+		}
 
-				CD_ListPush(self->server->disconnecting, (CDPointer) client);
+		SDEBUG(self->server, "worker %d running %zu jobs", self->id, length);
 
-				CD_ServerFlush(client->server, false);
+		for (size_t i = 0; i < length; i++) {
+			self->job = jobs[i];
 
-				CD_DestroyJob(self->job);
-			}
+			cd_WorkerRunJob(self);
 		}
 
 		self->job = NULL;
@@ -211,16 +223,15 @@ CD_StopWorker (CDWorker* self)
 
 	CD_EventDispatch(self->server, "Worker.stop!", self);
 
-	self->working = false;
+	__atomic_store_n(&self->working, false, __ATOMIC_SEQ_CST);
 
-	pthread_mutex_lock(&self->workers->lock.mutex);
-	pthread_cond_broadcast(&self->workers->lock.condition);
-	pthread_mutex_unlock(&self->workers->lock.mutex);
+	CD_QueueWakeAll(self->workers->jobs);
 
-	while (!self->stopped) {
-		usleep(1000);
+	// A worker can't wait for itself, it stops after the current job
+	if (self->thread && !pthread_equal(self->thread, pthread_self())) {
+		pthread_join(self->thread, NULL);
 
-		continue;
+		self->thread = 0;
 	}
 
 	return true;
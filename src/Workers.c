@@ -38,28 +38,21 @@ CD_CreateWorkers (CDServer* server)
 	self->length = 0;
 	self->item   = NULL;
 
-	self->jobs = CD_CreateList();
+	self->jobs = CD_CreateQueue(CD_WORKERS_QUEUE);
 
 	if (pthread_attr_init(&self->attributes) != 0) {
 		CD_abort("pthread attribute failed to initialize");
 	}
 
-	if (pthread_attr_setdetachstate(&self->attributes, PTHREAD_CREATE_DETACHED) != 0) {
-		CD_abort("pthread attribute failed to set in detach state");
+	// Workers are joined when stopped
+	if (pthread_attr_setdetachstate(&self->attributes, PTHREAD_CREATE_JOINABLE) != 0) {
+		CD_abort("pthread attribute failed to set in joinable state");
 	}
 
 	if (pthread_attr_setstacksize(&self->attributes, CD_THREAD_STACK) != 0) {
 		CD_abort("pthread attribute failed to set stack size");
 	}
 
-	if (pthread_mutex_init(&self->lock.mutex, NULL) != 0) {
-		CD_abort("pthread mutex failed to initialize");
-	}
-
-	if (pthread_cond_init(&self->lock.condition, NULL) != 0) {
-		CD_abort("pthread cond failed to initialize");
-	}
-
 	return self;
 }
 
@@ -70,10 +63,7 @@ CD_DestroyWorkers (CDWorkers* self)
 
 	CD_StopWorkers(self);
 
-	CD_DestroyList(self->jobs);
-
-	pthread_mutex_destroy(&self->lock.mutex);
-	pthread_cond_destroy(&self->lock.condition);
+	CD_DestroyQueue(self->jobs);
 
 	CD_free(self);
 }
@@ -131,9 +121,7 @@ CD_KillWorkers (CDWorkers* self, size_t number)
 		CD_StopWorker(self->item[i]);
 	}
 
-	pthread_mutex_lock(&self->lock.mutex);
-	pthread_cond_broadcast(&self->lock.condition);
-	pthread_mutex_unlock(&self->lock.mutex);
+	CD_QueueWakeAll(self->jobs);
 
 	for (size_t i = self->length - 1; (self->length - i) < self->length; i--) {
 		CD_DestroyWorker(self->item[i]);
@@ -163,9 +151,7 @@ CD_KillWorkersAvoid (CDWorkers* self, size_t number, CDWorker* worker)
 		CD_StopWorker(self->item[i]);
 	}
 
-	pthread_mutex_lock(&self->lock.mutex);
-	pthread_cond_broadcast(&self->lock.condition);
-	pthread_mutex_unlock(&self->lock.mutex);
+	CD_QueueWakeAll(self->jobs);
 
 	for (size_t i = self->length - 1; (self->length - i) < self->length; i--) {
 		CD_DestroyWorker(self->item[i]);
@@ -198,23 +184,38 @@ CD_AppendWorker (CDWorkers* self, CDWorker* worker)
 bool
 CD_HasJobs (CDWorkers* self)
 {
-	return CD_ListLength(self->jobs) > 0;
+	return !CD_QueueIsEmpty(self->jobs);
 }
 
 void
 CD_AddJob (CDWorkers* self, CDJob* job)
 {
-	pthread_mutex_lock(&self->lock.mutex);
+	CD_QueuePush(self->jobs, (CDPointer) job);
+}
 
-	CD_ListPush(self->jobs, (CDPointer) job);
+CDJob*
+CD_NextJob (CDWorkers* self)
+{
+	return (CDJob*) CD_QueueShift(self->jobs);
+}
+
+size_t
+CD_NextJobs (CDWorkers* self, CDJob** jobs)
+{
+	size_t length = CD_QueueLength(self->jobs) / (self->length > 0 ? self->length : 1);
 
-	pthread_cond_signal(&self->lock.condition);
+	if (length < 1) {
+		length = 1;
+	}
+	else if (length > CD_WORKERS_BATCH) {
+		length = CD_WORKERS_BATCH;
+	}
 
-	pthread_mutex_unlock(&self->lock.mutex);
+	return CD_QueueShiftMany(self->jobs, (CDPointer*) jobs, length);
 }
 
-CDJob*
-CD_NextJob (CDWorkers* self)
+void
+CD_WaitJobs (CDWorkers* self, CDWorker* worker)
 {
-	return (CDJob*) CD_ListShift(self->jobs);
+	CD_QueueWait(self->jobs, &worker->working);
 }
@@ -105,6 +105,9 @@ main (int argc, char** argv)
 		CD_abort("%s could not be read", config);
 	}
 
+	/* libevent wants its allocator before any other call, so every base shares it */
+	event_set_mem_functions(CD_malloc, CD_realloc, CD_free);
+
 	#ifdef WIN32
 		evthread_use_windows_threads();
 	#else
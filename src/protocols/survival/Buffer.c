@@ -110,64 +110,37 @@ SV_BufferAddBoolean (CDBuffer* self, SVBoolean data)
 void
 SV_BufferAddString (CDBuffer* self, CDString* data)
 {
-	CDString* sanitized = SV_StringSanitize(data);
+	struct evbuffer_iovec vector;
+	SVShort               size;
 
-	SVShort size = htons(CD_StringSize(sanitized));
+	evbuffer_reserve_space(self->raw, SVShortSize + CD_StringSize(data), &vector, 1);
 
-	evbuffer_add(self->raw, &size, SVShortSize);
-	evbuffer_add(self->raw, CD_StringContent(sanitized), CD_StringSize(sanitized));
+	size = SV_StringSanitizeTo(data, (uint8_t*) vector.iov_base + SVShortSize);
 
-	SV_DestroyString(sanitized);
+	vector.iov_len = SVShortSize + size;
+	size           = htons(size);
+
+	memcpy(vector.iov_base, &size, SVShortSize);
+
+	evbuffer_commit_space(self->raw, &vector, 1);
 }
 
 void
 SV_BufferAddString16 (CDBuffer* self, CDString* data)
 {
-	CDString* sanitized = SV_StringSanitize(data);
-
-	SVShort size = htons(CD_StringLength(sanitized));
-
-	evbuffer_add(self->raw, &size, SVShortSize);
-
-	int16_t* ucs2 = CD_alloc(CD_StringLength(sanitized) * sizeof(int16_t));
-
-	for (size_t i = 0; i < CD_StringLength(sanitized); i++) {
-		CDString*   ch    = CD_CharAt(sanitized, i);
-		const char* input = CD_StringContent(ch);
-		short       uch   = 0;
+	struct evbuffer_iovec vector;
+	SVShort               units;
 
-		if ((input[0] & 0x80) == 0x00) {
-			uch = input[0];
-		}
-		else if ((input[0] & 0xE0) == 0xE0) {
-			if (input[1] == 0 || input[2] == 0) {
-				uch = 0xfffd;
-			}
-			else {
-				uch = ((input[0] & 0x0F) << 12) | ((input[1] & 0x3F) << 6) | (input[2] & 0x3F);
-			}
-		}
-		else if ((input[0] & 0xC0) == 0xC0) {
-			if (input[1] == 0) {
-				uch = 0xfffd;
-			}
-			else {
-				uch = ((input[0] & 0x1F) << 6) | (input[1] & 0x3F);
-			}
-		}
-		else {
-			uch = 0xfffd;
-		}
+	evbuffer_reserve_space(self->raw, SVShortSize + CD_StringSize(data) * 2, &vector, 1);
 
-		CD_DestroyString(ch);
+	units = SV_StringToUTF16(data, (uint8_t*) vector.iov_base + SVShortSize);
 
-		ucs2[i] = htons(uch);
-	}
+	vector.iov_len = SVShortSize + units * 2;
+	units          = htons(units);
 
-	evbuffer_add(self->raw, ucs2, CD_StringLength(sanitized) * sizeof(int16_t));
+	memcpy(vector.iov_base, &units, SVShortSize);
 
-	CD_free(ucs2);
-	CD_DestroyString(sanitized);
+	evbuffer_commit_space(self->raw, &vector, 1);
 }
 
 void
@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <craftd/protocols/survival/Codec.h>
+
+static
+SVString
+sv_StringFromData (char* data, size_t size)
+{
+	SVString result = CD_CreateStringFromBuffer(data, size);
+
+	data[size]        = '\0';
+	result->raw->mlen = size + 1;
+	result->external  = false;
+
+	return result;
+}
+
+SVString
+SV_ReadString (SVReader* self)
+{
+	uint16_t       size = (uint16_t) SV_ReadShort(self);
+	const uint8_t* data = SV_ReaderTake(self, size);
+	char*          result;
+
+	if (!data) {
+		return NULL;
+	}
+
+	result = CD_malloc(size + 1);
+
+	memcpy(result, data, size);
+
+	return sv_StringFromData(result, size);
+}
+
+SVString
+SV_ReadString16 (SVReader* self)
+{
+	uint16_t       length = (uint16_t) SV_ReadShort(self);
+	const uint8_t* data   = SV_ReaderTake(self, length * 2);
+	char*          result;
+	size_t         size = 0;
+
+	if (!data) {
+		return NULL;
+	}
+
+	// Every UCS-2 unit takes at most 3 bytes as UTF-8, so the whole String is
+	// converted in one allocation
+	result = CD_malloc(length * 3 + 1);
+
+	for (size_t i = 0; i < length; i++) {
+		uint16_t ch = (data[i * 2] << 8) | data[i * 2 + 1];
+
+		if (ch == 0xfffd) {
+			result[size++] = '?';
+		}
+		else if (ch < 0x80) {
+			result[size++] = ch;
+		}
+		else if (ch < 0x800) {
+			result[size++] = (ch >> 6) | 0xC0;
+			result[size++] = (ch & 0x3F) | 0x80;
+		}
+		else if (ch < 0xFFFF) {
+			result[size++] = (ch >> 12) | 0xE0;
+			result[size++] = ((ch >> 6) & 0x3F) | 0x80;
+			result[size++] = (ch & 0x3F) | 0x80;
+		}
+	}
+
+	return sv_StringFromData(result, size);
+}
+
+SVMetadata*
+SV_ReadMetadata (SVReader* self)
+{
+	SVMetadata* metadata = SV_CreateMetadata();
+
+	while (!self->error && SV_ReaderLeft(self) > 0) {
+		SVByte  type    = SV_ReadByte(self);
+		SVData* current = NULL;
+
+		if (type == 127) {
+			break;
+		}
+
+		current       = SV_CreateData();
+		current->type = (type >> 5) & 0x07;
+
+		switch (current->type) {
+			case SVTypeByte:    current->data.b = SV_ReadByte(self);    break;
+			case SVTypeShort:   current->data.s = SV_ReadShort(self);   break;
+			case SVTypeInteger: current->data.i = SV_ReadInteger(self); break;
+			case SVTypeFloat:   current->data.f = SV_ReadFloat(self);   break;
+			case SVTypeString:  current->data.S = SV_ReadString(self);  break;
+
+			case SVTypeShortByteShort: {
+				current->data.sbs.first  = SV_ReadShort(self);
+				current->data.sbs.second = SV_ReadByte(self);
+				current->data.sbs.third  = SV_ReadShort(self);
+			} break;
+
+			case SVTypeIntIntInt: {
+				current->data.iii.first  = SV_ReadInteger(self);
+				current->data.iii.second = SV_ReadInteger(self);
+				current->data.iii.third  = SV_ReadInteger(self);
+			} break;
+
+			default: {
+				self->error = true;
+			}
+		}
+
+		SV_AppendData(metadata, current);
+	}
+
+	return metadata;
+}
+
+uint8_t*
+SV_WriteString (uint8_t* cursor, SVString data)
+{
+	size_t size = SV_StringSanitizeTo(data, cursor + SVShortSize);
+
+	SV_WriteShort(cursor, size);
+
+	return cursor + SVShortSize + size;
+}
+
+uint8_t*
+SV_WriteString16 (uint8_t* cursor, SVString data)
+{
+	size_t units = SV_StringToUTF16(data, cursor + SVShortSize);
+
+	SV_WriteShort(cursor, units);
+
+	return cursor + SVShortSize + units * 2;
+}
+
+uint8_t*
+SV_WriteMetadata (uint8_t* cursor, SVMetadata* data)
+{
+	for (size_t i = 0; i < data->length; i++) {
+		SVData* current = data->item[i];
+
+		cursor = SV_WriteByte(cursor, current->type);
+
+		switch (current->type) {
+			case SVTypeByte:    cursor = SV_WriteByte(cursor, current->data.b);    break;
+			case SVTypeShort:   cursor = SV_WriteShort(cursor, current->data.s);   break;
+			case SVTypeInteger: cursor = SV_WriteInteger(cursor, current->data.i); break;
+			case SVTypeFloat:   cursor = SV_WriteFloat(cursor, current->data.f);   break;
+			case SVTypeString:  cursor = SV_WriteString(cursor, current->data.S);  break;
+
+			case SVTypeShortByteShort: {
+				cursor = SV_WriteShort(cursor, current->data.sbs.first);
+				cursor = SV_WriteByte(cursor, current->data.sbs.second);
+				cursor = SV_WriteShort(cursor, current->data.sbs.third);
+			} break;
+
+			case SVTypeIntIntInt: {
+				cursor = SV_WriteInteger(cursor, current->data.iii.first);
+				cursor = SV_WriteInteger(cursor, current->data.iii.second);
+				cursor = SV_WriteInteger(cursor, current->data.iii.third);
+			} break;
+		}
+	}
+
+	return SV_WriteByte(cursor, 127);
+}
+
+size_t
+SV_MetadataBound (SVMetadata* data)
+{
+	size_t size = SVByteSize;
+
+	for (size_t i = 0; i < data->length; i++) {
+		SVData* current = data->item[i];
+
+		size += SVByteSize;
+
+		switch (current->type) {
+			case SVTypeByte:    size += SVByteSize;                        break;
+			case SVTypeShort:   size += SVShortSize;                       break;
+			case SVTypeInteger: size += SVIntegerSize;                     break;
+			case SVTypeFloat:   size += SVFloatSize;                       break;
+			case SVTypeString:  size += SV_StringBound(current->data.S);   break;
+
+			case SVTypeShortByteShort: size += SVShortSize + SVByteSize + SVShortSize;         break;
+			case SVTypeIntIntInt:      size += SVIntegerSize + SVIntegerSize + SVIntegerSize; break;
+		}
+	}
+
+	return size;
+}
@@ -26,272 +26,344 @@
 #include <craftd/protocols/survival/PacketLength.h>
 #include <craftd/protocols/survival/Packet.h>
 
-#define CHECK (length < (SVPacketLength[type] + variable))
+/**
+ * Copy size bytes at the given position of the input without linearizing it,
+ * the bytes can span any number of chains.
+ */
+static
+bool
+sv_FramePeek (CDBuffers* buffers, size_t at, void* out, size_t size)
+{
+	struct evbuffer*      raw  = buffers->input->raw;
+	uint8_t*              data = out;
+	struct evbuffer_ptr   position;
+	struct evbuffer_iovec chunks[8];
+	int                   used;
+
+	if (evbuffer_get_length(raw) < at + size) {
+		return false;
+	}
+
+	if (evbuffer_ptr_set(raw, &position, at, EVBUFFER_PTR_SET) != 0) {
+		return false;
+	}
+
+	used = evbuffer_peek(raw, size, &position, chunks, 8);
+
+	for (int i = 0; i < used && i < 8 && size > 0; i++) {
+		size_t piece = (chunks[i].iov_len < size) ? chunks[i].iov_len : size;
+
+		memcpy(data, chunks[i].iov_base, piece);
+
+		data += piece;
+		size -= piece;
+	}
+
+	return size == 0;
+}
+
+/*
+ * The fields are looked up at frame.offset + frame.variable, offset moves
+ * through the fixed layout of the packet while variable is the size of the
+ * variable parts already seen.
+ */
+#define FRAME_AT (buffers->frame.offset + buffers->frame.variable)
+
+#define FRAME_PEEK(at, into)                                \
+	if (!sv_FramePeek(buffers, (at), &(into), sizeof(into))) { \
+		needed = (at) + sizeof(into);                       \
+		goto again;                                         \
+	}
+
+#define FRAME_BYTE(into)    FRAME_PEEK(FRAME_AT, into)
+#define FRAME_SHORT(into)   FRAME_PEEK(FRAME_AT, into); into = ntohs(into)
+#define FRAME_INTEGER(into) FRAME_PEEK(FRAME_AT, into); into = ntohl(into)
 
 bool
 SV_PacketParsable (CDBuffers* buffers)
 {
-	size_t       length   = evbuffer_get_length(buffers->input->raw);
-	SVPacketType type     = 0;
-	size_t       variable = 0;
-	size_t       offset   = SVByteSize;
-				 errno    = 0;
-
-	if (length < 1) {
-		goto error;
+	size_t  length = evbuffer_get_length(buffers->input->raw);
+	size_t  needed = 0;
+	uint8_t type   = 0;
+	        errno  = 0;
+
+	if (buffers->frame.complete) {
+		return true;
+	}
+
+	if (buffers->frame.type < 0) {
+		if (length < 1) {
+			needed = 1;
+			goto again;
+		}
+
+		evbuffer_copyout(buffers->input->raw, &type, 1);
+
+		if (SVPacketLength[type] == 0) {
+			errno = EILSEQ;
+			goto error;
+		}
+
+		buffers->frame.type   = type;
+		buffers->frame.offset = SVByteSize;
 	}
 
-	evbuffer_copyout(buffers->input->raw, &type, 1);
+	type = buffers->frame.type;
 
 	if (length < SVPacketLength[type]) {
-		goto error;
+		goto again;
 	}
 
-	unsigned char* data = evbuffer_pullup(buffers->input->raw, -1);
-
+	// Step 0 moves the offset to the first variable field, later steps resume
+	// where the previous read stopped
 	switch (type) {
-		case SVLogin: {
-			variable += ntohs(*((SVShort*) (data + (offset + SVIntegerSize)))) * 2;
+		case SVLogin:
+		case SVHandshake:
+		case SVChat:
+		case SVNamedEntitySpawn:
+		case SVOpenWindow:
+		case SVPlayerListItem:
+		case SVDisconnect: {
+			if (buffers->frame.step == 0) {
+				SVShort characters;
 
-			goto check;
-		}
+				if (type == SVLogin || type == SVNamedEntitySpawn) {
+					buffers->frame.offset += SVIntegerSize;
+				}
+				else if (type == SVOpenWindow) {
+					buffers->frame.offset += SVByteSize + SVByteSize;
+				}
 
-		case SVHandshake: {
-			variable += ntohs(*((SVShort*) (data + offset))) * 2;
+				FRAME_SHORT(characters);
 
-			goto check;
-		}
+				// The window title is UTF-8 and counts bytes, the others are UCS-2
+				buffers->frame.variable += (uint16_t) characters * (type == SVOpenWindow ? 1 : 2);
+				buffers->frame.step      = 1;
+			}
+		} break;
 
-		case SVChat: {
-			variable += ntohs(*((SVShort*) (data + offset))) * 2;
+		case SVPlayerBlockPlacement:
+		case SVWindowClick:
+		case SVSetSlot: {
+			if (buffers->frame.step == 0) {
+				SVShort item;
 
-			goto check;
-		}
+				if (type == SVPlayerBlockPlacement) {
+					buffers->frame.offset += SVIntegerSize + SVByteSize + SVIntegerSize + SVByteSize;
+				}
+				else if (type == SVWindowClick) {
+					buffers->frame.offset += SVByteSize + SVShortSize + SVByteSize + SVShortSize + SVBooleanSize;
+				}
+				else {
+					buffers->frame.offset += SVByteSize + SVShortSize;
+				}
 
-		case SVPlayerBlockPlacement: {
-			offset += SVIntegerSize + SVByteSize + SVIntegerSize + SVByteSize;
+				FRAME_SHORT(item);
+
+				if (item != -1) {
+					buffers->frame.variable += SVByteSize + SVShortSize;
+				}
 
-			if ((SVShort)ntohs(*((SVShort*) (data + offset))) != -1) {
-				variable += 3;
+				buffers->frame.step = 1;
 			}
+		} break;
 
-			goto check;
-		}
-		
-		case SVNamedEntitySpawn: {
-			offset += SVIntegerSize;
-			variable += ntohs(*((SVShort*) (data + offset))) * 2;
-			
-			goto check;
-		}
-		
 		case SVSpawnObject: {
-			offset += SVIntegerSize + SVByteSize + SVIntegerSize * 3;
-			if ((SVInteger)ntohl(*((SVInteger*) (data + offset))) > 0) {
-				variable += SVShortSize * 3;
+			if (buffers->frame.step == 0) {
+				SVInteger thrower;
+
+				buffers->frame.offset += SVIntegerSize + SVByteSize + SVIntegerSize * 3;
+
+				FRAME_INTEGER(thrower);
+
+				if (thrower > 0) {
+					buffers->frame.variable += SVShortSize * 3;
+				}
+
+				buffers->frame.step = 1;
 			}
-			
-			goto check;
-		}
-		
-		case SVSpawnMob: {
-			offset += SVIntegerSize + SVByteSize + SVIntegerSize * 3 + SVByteSize + SVByteSize;
-			
-			while (!(CHECK)) {
-				uint8_t metatype = *((uint8_t*) (data + offset + variable) );
-				if (metatype == 127) {
-					goto done;
+		} break;
+
+		case SVSpawnMob:
+		case SVEntityMetadata: {
+			if (buffers->frame.step == 0) {
+				if (type == SVSpawnMob) {
+					buffers->frame.offset += SVIntegerSize + SVByteSize + SVIntegerSize * 3 + SVByteSize + SVByteSize;
 				}
-				switch (metatype >> 5) {
-					case SVTypeByte:           variable += SVByteSize;                                break;
-					case SVTypeShort:          variable += SVShortSize;                               break;
-					case SVTypeInteger:        variable += SVIntegerSize;                             break;
-					case SVTypeFloat:          variable += SVFloatSize;                               break;
-					case SVTypeString: {
-						variable += SVShortSize;
-						if (CHECK) {
-							goto error;
-						}
-						variable += *((SVShort*) (data + offset + (variable - SVShortSize) + SVByteSize)); 
-					} break;
-					case SVTypeShortByteShort: variable += SVByteSize + SVShortSize + SVByteSize;     break;
-					case SVTypeIntIntInt:      variable += SVIntegerSize * 3;     break;
-					default: {
-						errno = EILSEQ;
-						goto error;
-					}
+				else {
+					buffers->frame.offset += SVIntegerSize;
 				}
-				variable += SVByteSize;
+
+				buffers->frame.step = 1;
 			}
-			
-			goto error;
-		}
 
-		case SVEntityMetadata: {
-			offset += SVIntegerSize;
+			// One entry per round, an entry is only counted once it's whole
+			while (buffers->frame.step == 1) {
+				uint8_t metatype;
+				size_t  size;
+
+				FRAME_BYTE(metatype);
 
-			while (!(CHECK)) {
-				uint8_t metatype = *((uint8_t*) (data + offset + variable) );
 				if (metatype == 127) {
-					goto done;
+					buffers->frame.step = 2;
+
+					break;
 				}
+
 				switch (metatype >> 5) {
-					case SVTypeByte:           variable += SVByteSize;                                break;
-					case SVTypeShort:          variable += SVShortSize;                               break;
-					case SVTypeInteger:        variable += SVIntegerSize;                             break;
-					case SVTypeFloat:          variable += SVFloatSize;                               break;
+					case SVTypeByte:           size = SVByteSize;                             break;
+					case SVTypeShort:          size = SVShortSize;                            break;
+					case SVTypeInteger:        size = SVIntegerSize;                          break;
+					case SVTypeFloat:          size = SVFloatSize;                            break;
+					case SVTypeShortByteShort: size = SVShortSize + SVByteSize + SVShortSize; break;
+					case SVTypeIntIntInt:      size = SVIntegerSize * 3;                      break;
+
 					case SVTypeString: {
-						variable += SVShortSize;
-						if (CHECK) {
-							goto error;
-						}
-						variable += *((SVShort*) (data + offset + (variable - SVShortSize) + SVByteSize)); 
+						SVShort characters;
+
+						FRAME_PEEK(FRAME_AT + SVByteSize, characters);
+
+						size = SVShortSize + (uint16_t) ntohs(characters);
 					} break;
-					case SVTypeShortByteShort: variable += SVByteSize + SVShortSize + SVByteSize;     break;
-					case SVTypeIntIntInt:      variable += SVIntegerSize * 3;     break;
+
 					default: {
 						errno = EILSEQ;
 						goto error;
 					}
 				}
-				variable += SVByteSize;
+
+				buffers->frame.variable += SVByteSize + size;
 			}
-			
-			goto error;
-		}
-		
-		case SVMapChunk: {
-			offset += SVIntegerSize + SVShortSize + SVIntegerSize + SVByteSize * 3;
-			variable += ntohl(*((SVInteger*) (data + offset)));
-				
-			goto check;
-		}
-		
-		case SVMultiBlockChange: {
-			offset += SVIntegerSize + SVIntegerSize;
-			variable += ntohs(*((SVShort*) (data + offset))) * (SVShortSize + SVByteSize + SVShortSize);
-			
-			goto check;
-		}
-		
+		} break;
+
+		case SVMapChunk:
 		case SVExplosion: {
-			offset += SVDoubleSize * 3 + SVFloatSize;
-			variable += ntohl(*((SVInteger*) (data + offset))) * (SVByteSize * 3);
-			
-			goto check;
-		}
-		
-		case SVOpenWindow: {
-			offset += SVByteSize + SVByteSize;
-			variable += ntohs(*((SVShort*) (data + offset))) * 2;
-			
-			goto check;
-		}
+			if (buffers->frame.step == 0) {
+				SVInteger count;
 
-		case SVWindowClick: {
-			offset += SVByteSize + SVShortSize + SVByteSize + SVShortSize + SVBooleanSize;
+				if (type == SVMapChunk) {
+					buffers->frame.offset += SVIntegerSize + SVShortSize + SVIntegerSize + SVByteSize * 3;
+				}
+				else {
+					buffers->frame.offset += SVDoubleSize * 3 + SVFloatSize;
+				}
 
-			if ((SVShort)ntohs(*((SVShort*) (data + offset))) != -1) {
-				variable += 3;
-			}
+				FRAME_INTEGER(count);
 
-			goto check;
-		}
-		
-		case SVSetSlot: {
-			offset += SVByteSize + SVShortSize;
-			if ((SVShort)ntohs(*((SVShort*) (data + offset))) != -1) {
-				variable += SVByteSize + SVShortSize;
-			}
-			
-			goto check;
-		}
-		
-		case SVWindowItems: {
-			offset += SVByteSize;
-			SVShort count = ntohs(*((SVShort*) (data + offset)));
-			offset += SVShortSize;
-			int i;
-			for (i=0; i<count; i++) {
-				variable += SVShortSize;
-				if (CHECK) {
+				if (count < 0) {
+					errno = EILSEQ;
 					goto error;
 				}
-				if ((SVShort)ntohs(*((SVShort*) (data + offset + (variable - SVShortSize)))) != -1) {
-					variable += SVByteSize + SVShortSize;
-				}
+
+				buffers->frame.variable += (type == SVMapChunk) ? (size_t) count : (size_t) count * (SVByteSize * 3);
+				buffers->frame.step      = 1;
 			}
-			
-			goto check;
-		}
+		} break;
 
-		case SVUpdateSign: {
-			offset += SVIntegerSize + SVShortSize + SVIntegerSize;
+		case SVMultiBlockChange: {
+			if (buffers->frame.step == 0) {
+				SVShort count;
 
-			variable += ntohs(*((SVShort*) (data + offset))) * 2;
+				buffers->frame.offset += SVIntegerSize + SVIntegerSize;
 
-			if (CHECK) {
-				goto error;
+				FRAME_SHORT(count);
+
+				buffers->frame.variable += (uint16_t) count * (SVShortSize + SVByteSize + SVShortSize);
+				buffers->frame.step      = 1;
 			}
+		} break;
+
+		case SVWindowItems: {
+			if (buffers->frame.step == 0) {
+				SVShort count;
+
+				buffers->frame.offset += SVByteSize;
 
-			variable += ntohs(*((SVShort*) (data + (offset += SVShortSize) + variable))) * 2;
+				FRAME_SHORT(count);
 
-			if (CHECK) {
-				goto error;
+				buffers->frame.offset += SVShortSize;
+				buffers->frame.count   = (count > 0) ? count : 0;
+				buffers->frame.step    = 1;
 			}
 
-			variable += ntohs(*((SVShort*) (data + (offset += SVShortSize) + variable))) * 2;
+			for (; buffers->frame.count > 0; buffers->frame.count--) {
+				SVShort item;
+
+				FRAME_SHORT(item);
 
-			if (CHECK) {
-				goto error;
+				buffers->frame.variable += SVShortSize;
+
+				if (item != -1) {
+					buffers->frame.variable += SVByteSize + SVShortSize;
+				}
 			}
+		} break;
 
-			variable += ntohs(*((SVShort*) (data + (offset += SVShortSize) + variable))) * 2;
+		case SVUpdateSign: {
+			if (buffers->frame.step == 0) {
+				buffers->frame.offset += SVIntegerSize + SVShortSize + SVIntegerSize;
+				buffers->frame.count   = 4;
+				buffers->frame.step    = 1;
+			}
+
+			for (; buffers->frame.count > 0; buffers->frame.count--) {
+				SVShort characters;
+
+				FRAME_SHORT(characters);
+
+				buffers->frame.variable += (uint16_t) characters * 2;
+				buffers->frame.offset   += SVShortSize;
+			}
+		} break;
 
-			goto check;
-		}
-		
 		case SVItemData: {
-			offset += SVShortSize + SVShortSize;
-			variable += *(uint8_t*)(data + offset);
-			
-			goto check;
-		}
-		
-		case SVPlayerListItem: {
-			variable += ntohs(*((SVShort*) (data + offset))) * 2;
-			
-			goto check;
-		}
+			if (buffers->frame.step == 0) {
+				uint8_t size;
 
-		case SVDisconnect: {
-			variable += ntohs(*((SVShort*) (data + offset))) * 2;
+				buffers->frame.offset += SVShortSize + SVShortSize;
 
-			goto check;
-		}
+				FRAME_BYTE(size);
+
+				buffers->frame.variable += size;
+				buffers->frame.step      = 1;
+			}
+		} break;
 
 		default: {
-			goto done;
+			break;
 		}
 	}
 
-	check: {
-		if (CHECK) {
-			goto error;
-		}
+	if (length < SVPacketLength[type] + buffers->frame.variable) {
+		goto again;
 	}
 
-	done: {
-		return true;
-	}
+	buffers->frame.complete = true;
 
-	error: {
-		if (errno != EILSEQ) {
-			errno = EAGAIN;
+	return true;
 
-			CD_BufferReadIn(buffers, SVPacketLength[type] + variable, CDNull);
+	again: {
+		errno = EAGAIN;
+
+		if (buffers->frame.type >= 0 && needed < SVPacketLength[type] + buffers->frame.variable) {
+			needed = SVPacketLength[type] + buffers->frame.variable;
 		}
 
+		CD_BufferReadIn(buffers, needed, CDNull);
+
 		return false;
 	}
+
+	error: {
+		return false;
+	}
+}
+
+size_t
+SV_PacketFrameLength (CDBuffers* buffers)
+{
+	assert(buffers);
+	assert(buffers->frame.complete);
+
+	return SVPacketLength[buffers->frame.type] + buffers->frame.variable;
 }
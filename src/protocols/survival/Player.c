@@ -26,6 +26,7 @@
 #include <craftd/Server.h>
 
 #include <craftd/protocols/survival/Player.h>
+#include <craftd/protocols/survival/World.h>
 
 SVPlayer*
 SV_CreatePlayer (CDClient* client)
@@ -44,9 +45,10 @@ SV_CreatePlayer (CDClient* client)
 
 	self->username = NULL;
 	self->world    = NULL;
+	self->pinned   = false;
 
-	DYNAMIC(self) = CD_CreateDynamic();
-	ERROR(self)   = CDNull;
+	CD_InitDynamic(DYNAMIC(self));
+	ERROR(self) = CDNull;
 
 	return self;
 }
@@ -60,7 +62,7 @@ SV_DestroyPlayer (SVPlayer* self)
 		CD_DestroyString(self->username);
 	}
 
-	CD_DestroyDynamic(DYNAMIC(self));
+	CD_FinalizeDynamic(DYNAMIC(self));
 
 	CD_free(self);
 }
@@ -95,6 +97,16 @@ SV_PlayerSendPacket (SVPlayer* self, SVPacket* packet)
 	CD_DestroyBuffer(data);
 }
 
+void
+SV_PlayerSendShared (SVPlayer* self, CDSharedBuffer* data)
+{
+	if (!self || !self->client || !self->client->buffers) {
+		return;
+	}
+
+	CD_ClientSendShared(self->client, data);
+}
+
 void
 SV_PlayerSendPacketAndClean (SVPlayer* self, SVPacket* packet)
 {
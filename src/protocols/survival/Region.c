@@ -58,15 +58,22 @@ SV_RelativeMove (SVPrecisePosition* a, SVPrecisePosition* b)
 void
 SV_RegionBroadcastPacket (SVPlayer* player, SVPacket* packet)
 {
-	CDList* seenPlayers = (CDList*) CD_DynamicGet(player, "Player.seenPlayers");
+	CDVector*       seenPlayers = (CDVector*) CD_DynamicGetSlot(player, CD_DYNAMIC_SLOT("Player.seenPlayers"));
+	CDSharedBuffer* data        = SV_PacketToSharedBuffer(packet);
 
-	CD_LIST_FOREACH(seenPlayers, it) {
-		if (player == (SVPlayer*) CD_ListIteratorValue(it)) {
-			continue;
-		}
+	if (seenPlayers) {
+		CD_VectorReadLock(seenPlayers);
+		CD_VECTOR_FOREACH(seenPlayers, i) {
+			if (player == (SVPlayer*) CD_VectorGet(seenPlayers, i)) {
+				continue;
+			}
 
-		SV_PlayerSendPacket((SVPlayer*) CD_ListIteratorValue(it), packet);
+			SV_PlayerSendShared((SVPlayer*) CD_VectorGet(seenPlayers, i), data);
+		}
+		CD_VectorUnlock(seenPlayers);
 	}
+
+	CD_ReleaseSharedBuffer(data);
 }
 
 
@@ -23,7 +23,394 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <zlib.h>
+
 #include <craftd/protocols/survival/World.h>
+#include <craftd/protocols/survival/Region.h>
+
+/**
+ * Queue a snapshot of a dirty chunk for saving, must be called with the chunks
+ * lock held.
+ *
+ * An owned chunk is leaving the cache and is queued itself instead of a copy,
+ * it's freed if it's clean.
+ */
+static
+void
+sv_WorldChunkQueue (SVWorld* self, SVChunk* chunk, bool owned)
+{
+	SVChunk* snapshot;
+
+	if (chunk->cache.saved == chunk->cache.version) {
+		if (owned) {
+			CD_free(chunk);
+		}
+
+		return;
+	}
+
+	chunk->cache.saved = chunk->cache.version;
+
+	if (owned) {
+		snapshot = chunk;
+	}
+	else {
+		snapshot = CD_malloc(sizeof(SVChunk));
+		memcpy(snapshot, chunk, sizeof(SVChunk));
+	}
+
+	memset(&snapshot->cache, 0, sizeof(snapshot->cache));
+
+	pthread_mutex_lock(&self->lock.persistence);
+	CD_ListPush(self->persistence.queue, (CDPointer) snapshot);
+	CD_MapPut(self->persistence.pending, SV_ChunkPositionToId(snapshot->position), (CDPointer) snapshot);
+
+	pthread_cond_signal(&self->persistence.condition);
+	pthread_mutex_unlock(&self->lock.persistence);
+}
+
+/**
+ * Queue the snapshots that failed to be written again, must be called with the
+ * persistence lock held.
+ */
+static
+void
+sv_WorldRetryFailed (SVWorld* self)
+{
+	SVChunk* snapshot;
+
+	while ((snapshot = (SVChunk*) CD_ListShift(self->persistence.failed))) {
+		CD_ListPush(self->persistence.queue, (CDPointer) snapshot);
+	}
+}
+
+/**
+ * Write the queued snapshots in batches, syncing once per batch, and take
+ * a snapshot every interval seconds.
+ *
+ * Snapshots that couldn't be written, or whose batch couldn't be synced, stay
+ * pending and are tried again with the next snapshot, and once more when the
+ * World is destroyed.
+ */
+static
+void*
+sv_RunWorldFlusher (SVWorld* self)
+{
+	struct timespec deadline;
+	bool            retried = false;
+
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += self->persistence.interval;
+
+	pthread_mutex_lock(&self->lock.persistence);
+	while (true) {
+		if (CD_ListLength(self->persistence.queue) == 0) {
+			if (!self->persistence.running) {
+				if (retried || CD_ListLength(self->persistence.failed) == 0) {
+					break;
+				}
+
+				retried = true;
+				sv_WorldRetryFailed(self);
+
+				continue;
+			}
+
+			if (self->persistence.interval <= 0) {
+				pthread_cond_wait(&self->persistence.condition, &self->lock.persistence);
+			}
+			else if (pthread_cond_timedwait(&self->persistence.condition, &self->lock.persistence, &deadline) == ETIMEDOUT) {
+				sv_WorldRetryFailed(self);
+
+				// Taking the snapshot needs the chunks lock, which comes first
+				pthread_mutex_unlock(&self->lock.persistence);
+				SV_WorldSave(self);
+				pthread_mutex_lock(&self->lock.persistence);
+
+				clock_gettime(CLOCK_REALTIME, &deadline);
+				deadline.tv_sec += self->persistence.interval;
+			}
+
+			continue;
+		}
+
+		CDList* batch  = self->persistence.queue;
+		CDList* failed = CD_CreateList();
+		CDError status;
+		bool    synced;
+		size_t  written = 0;
+
+		self->persistence.queue = CD_CreateList();
+		pthread_mutex_unlock(&self->lock.persistence);
+
+		CD_LIST_FOREACH(batch, it) {
+			SVChunk* snapshot = (SVChunk*) CD_ListIteratorValue(it);
+
+			CD_EventDispatchWithError(status, self->server, "World.chunk=", self, snapshot->position.x, snapshot->position.z, snapshot);
+
+			if (status != CDOk) {
+				CD_ListPush(failed, (CDPointer) snapshot);
+			}
+		}
+
+		CD_EventDispatchWithError(status, self->server, "World.save", self);
+
+		// Nothing in a batch that wasn't synced is known to be on disk
+		synced = (status == CDOk);
+
+		pthread_mutex_lock(&self->lock.persistence);
+		CD_LIST_FOREACH(batch, it) {
+			SVChunk* snapshot = (SVChunk*) CD_ListIteratorValue(it);
+			bool     latest   = (SVChunk*) CD_MapGet(self->persistence.pending, SV_ChunkPositionToId(snapshot->position)) == snapshot;
+
+			// The snapshot can be dropped only when it's written or a newer one
+			// is queued
+			if (latest && (!synced || CD_ListContains(failed, (CDPointer) snapshot))) {
+				CD_ListPush(self->persistence.failed, (CDPointer) snapshot);
+
+				continue;
+			}
+
+			if (latest) {
+				CD_MapDelete(self->persistence.pending, SV_ChunkPositionToId(snapshot->position));
+			}
+
+			CD_free(snapshot);
+			written++;
+		}
+
+		if (written < CD_ListLength(batch)) {
+			SERR(self->server, "%s> could not save %zu of %zu chunks, they will be retried", CD_StringContent(self->name),
+				CD_ListLength(batch) - written, CD_ListLength(batch));
+		}
+
+		self->persistence.statistics.chunks   += written;
+		self->persistence.statistics.failures += CD_ListLength(batch) - written;
+		self->persistence.statistics.batches++;
+
+		CD_DestroyList(failed);
+		CD_DestroyList(batch);
+	}
+
+	if (CD_ListLength(self->persistence.failed) > 0) {
+		SERR(self->server, "%s> giving up on %zu chunks that could not be saved", CD_StringContent(self->name),
+			CD_ListLength(self->persistence.failed));
+	}
+
+	SVChunk* snapshot;
+
+	while ((snapshot = (SVChunk*) CD_ListShift(self->persistence.failed))) {
+		CD_MapDelete(self->persistence.pending, SV_ChunkPositionToId(snapshot->position));
+		CD_free(snapshot);
+	}
+	pthread_mutex_unlock(&self->lock.persistence);
+
+	return NULL;
+}
+
+static const char* svWorldTickEvents[SVTickPhases] = {
+	"World.tick.input",
+	"World.tick.simulate",
+	"World.tick.broadcast",
+	"World.tick.flush"
+};
+
+static inline
+uint64_t
+sv_WorldTickClock (void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/**
+ * Report the tick times since the last report, a warning is logged only when
+ * some tick overran its slot.
+ */
+static
+void
+sv_WorldTickReport (SVWorld* self, uint64_t ticks, uint64_t phases[SVTickPhases], uint64_t longest, uint64_t overruns)
+{
+	if (ticks == 0) {
+		return;
+	}
+
+	if (overruns > 0) {
+		SLOG(self->server, LOG_WARNING, "%s> %llu of %llu ticks overran, the longest took %.2fms", CD_StringContent(self->name),
+			(unsigned long long) overruns, (unsigned long long) ticks, longest / 1000000.0);
+	}
+
+	SDEBUG(self->server, "%s> tick averages: input %.3fms, simulate %.3fms, broadcast %.3fms, flush %.3fms", CD_StringContent(self->name),
+		phases[SVTickInput]     / 1000000.0 / ticks,
+		phases[SVTickSimulate]  / 1000000.0 / ticks,
+		phases[SVTickBroadcast] / 1000000.0 / ticks,
+		phases[SVTickFlush]     / 1000000.0 / ticks);
+}
+
+/**
+ * Pin the World's players for the whole tick.
+ *
+ * Each pinned client holds a job, so its disconnection waits for the end of
+ * the tick instead of freeing it under a phase. A client whose disconnection
+ * is already scheduled, or running, can't be held back: its player is left
+ * unpinned and the phases skip it, see SVPlayer.
+ */
+static
+void
+sv_WorldTickPin (SVWorld* self)
+{
+	CD_HASH_FOREACH(self->players, it) {
+		SVPlayer* player = (SVPlayer*) CD_HashIteratorValue(it);
+		CDClient* client = player->client;
+
+		pthread_rwlock_wrlock(&client->lock.status);
+		if (client->status != CDClientDisconnect || client->jobs > 0) {
+			client->jobs++;
+
+			player->pinned = true;
+			CD_VectorPush(self->tick.pinned, (CDPointer) player);
+		}
+		pthread_rwlock_unlock(&client->lock.status);
+	}
+}
+
+static
+void
+sv_WorldTickUnpin (SVWorld* self)
+{
+	CD_VECTOR_FOREACH(self->tick.pinned, i) {
+		SVPlayer* player = (SVPlayer*) CD_VectorGet(self->tick.pinned, i);
+		CDClient* client = player->client;
+
+		player->pinned = false;
+
+		pthread_rwlock_wrlock(&client->lock.status);
+		CD_ClientReleaseJob(client);
+		pthread_rwlock_unlock(&client->lock.status);
+	}
+
+	CD_VectorClear(self->tick.pinned);
+}
+
+/**
+ * Cork or uncork the pinned players, from the broadcast to the end of the
+ * flush.
+ */
+static
+void
+sv_WorldTickCork (SVWorld* self, bool cork)
+{
+	CD_VECTOR_FOREACH(self->tick.pinned, i) {
+		CDClient* client = ((SVPlayer*) CD_VectorGet(self->tick.pinned, i))->client;
+
+		if (cork) {
+			CD_ClientCork(client);
+		}
+		else {
+			CD_ClientUncork(client);
+		}
+	}
+}
+
+/**
+ * Run the World ticks at a fixed rate, every tick dispatches its phases in
+ * order with the players pinned, and they are corked from the broadcast to the
+ * end of the flush so everything sent in between goes out with one write.
+ *
+ * Ticks that overrun their slot are counted, when the loop falls a whole slot
+ * behind the missed ticks are skipped instead of being run back to back.
+ */
+static
+void*
+sv_RunWorldTick (SVWorld* self)
+{
+	uint64_t period   = 1000000000 / self->tick.rate;
+	uint64_t deadline = sv_WorldTickClock() + period;
+
+	// Statistics since the last report, one is logged every minute
+	uint64_t ticks    = 0;
+	uint64_t longest  = 0;
+	uint64_t overruns = 0;
+	uint64_t phases[SVTickPhases] = { 0 };
+
+	while (__atomic_load_n(&self->tick.running, __ATOMIC_SEQ_CST)) {
+		struct timespec wakeup = {
+			.tv_sec  = deadline / 1000000000,
+			.tv_nsec = deadline % 1000000000
+		};
+
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeup, NULL) == EINTR) {
+			continue;
+		}
+
+		uint64_t start = sv_WorldTickClock();
+		uint64_t last  = start;
+
+		self->tick.count++;
+
+		sv_WorldTickPin(self);
+
+		for (int phase = 0; phase < SVTickPhases; phase++) {
+			if (phase == SVTickBroadcast) {
+				sv_WorldTickCork(self, true);
+			}
+
+			CD_EventDispatch(self->server, svWorldTickEvents[phase], self);
+
+			if (phase == SVTickFlush) {
+				sv_WorldTickCork(self, false);
+			}
+
+			uint64_t now = sv_WorldTickClock();
+
+			phases[phase]                        += now - last;
+			self->tick.statistics.phases[phase] += now - last;
+
+			last = now;
+		}
+
+		sv_WorldTickUnpin(self);
+
+		uint64_t elapsed = last - start;
+
+		if (elapsed > longest) {
+			longest = elapsed;
+		}
+
+		if (elapsed > self->tick.statistics.longest) {
+			self->tick.statistics.longest = elapsed;
+		}
+
+		if (elapsed > period) {
+			overruns++;
+			self->tick.statistics.overruns++;
+		}
+
+		if (++ticks == (uint64_t) self->tick.rate * 60) {
+			sv_WorldTickReport(self, ticks, phases, longest, overruns);
+
+			ticks    = 0;
+			longest  = 0;
+			overruns = 0;
+
+			memset(phases, 0, sizeof(phases));
+		}
+
+		deadline += period;
+
+		if (last > deadline + period) {
+			uint64_t behind = (last - deadline) / period;
+
+			self->tick.statistics.skipped += behind;
+			deadline                      += behind * period;
+		}
+	}
+
+	return NULL;
+}
 
 SVWorld*
 SV_CreateWorld (CDServer* server, const char* name)
@@ -36,11 +423,41 @@ SV_CreateWorld (CDServer* server, const char* name)
 		CD_abort("pthread spinlock failed to initialize");
 	}
 
+	if (pthread_mutex_init(&self->lock.chunks, NULL) != 0) {
+		CD_abort("pthread mutex failed to initialize");
+	}
+
+	if (pthread_mutex_init(&self->lock.persistence, NULL) != 0) {
+		CD_abort("pthread mutex failed to initialize");
+	}
+
+	if (pthread_cond_init(&self->persistence.condition, NULL) != 0) {
+		CD_abort("pthread cond failed to initialize");
+	}
+
+	if (pthread_rwlock_init(&self->lock.grid, NULL) != 0) {
+		CD_abort("pthread rwlock failed to initialize");
+	}
+
 	self->server = server;
 
+	self->chunks.budget        = 64 * 1024 * 1024;
+	self->persistence.interval = 60;
+	self->tick.rate            = 20;
+
 	C_FOREACH(world, C_PATH(server->config, "server.game.protocol.worlds")) {
 		 if (CD_CStringIsEqual(name, C_STRING(C_GET(world, "name")))) {
 			config_export(world, &self->config.data);
+
+			C_IN(chunks, world, "chunks") {
+				C_SAVE(C_GET(chunks, "cache"), (size_t) 1024 * 1024 * C_INT, self->chunks.budget);
+				C_SAVE(C_GET(chunks, "save"), C_INT, self->persistence.interval);
+			}
+
+			C_IN(tick, world, "tick") {
+				C_SAVE(C_GET(tick, "rate"), C_INT, self->tick.rate);
+			}
+
 			break;
 		}
 	}
@@ -54,26 +471,68 @@ SV_CreateWorld (CDServer* server, const char* name)
 	self->players  = CD_CreateHash();
 	self->entities = CD_CreateMap();
 
-	self->chunks = CD_CreateSetWith(2000, (CDSetCompare) SV_CompareChunkPosition, (CDSetHash) SV_HashChunkPosition);
+	self->grid.cells = CD_CreateMap();
+
+	self->chunks.resident = CD_CreateMap();
+	self->chunks.pinned   = CD_CreateMap();
+	self->chunks.loading  = CD_CreateMap();
+	self->chunks.first    = NULL;
+	self->chunks.last     = NULL;
+	self->chunks.size     = 0;
+
+	self->chunks.statistics.hits      = 0;
+	self->chunks.statistics.misses    = 0;
+	self->chunks.statistics.evictions = 0;
+
+	self->persistence.running = true;
+	self->persistence.queue   = CD_CreateList();
+	self->persistence.failed  = CD_CreateList();
+	self->persistence.pending = CD_CreateMap();
+
+	self->persistence.statistics.chunks   = 0;
+	self->persistence.statistics.batches  = 0;
+	self->persistence.statistics.failures = 0;
+
+	if (self->tick.rate <= 0) {
+		self->tick.rate = 20;
+	}
+
+	self->tick.running = true;
+	self->tick.count   = 0;
+	self->tick.pinned  = CD_CreateVector();
+
+	memset(&self->tick.statistics, 0, sizeof(self->tick.statistics));
 
 	self->lastGeneratedEntityId = 0;
 
-	DYNAMIC(self) = CD_CreateDynamic();
-	ERROR(self)   = CDNull;
+	CD_InitDynamic(DYNAMIC(self));
+	ERROR(self) = CDNull;
 
 	CD_EventDispatch(server, "World.create", self);
 
+	if (pthread_create(&self->persistence.thread, NULL, (void *(*)(void *)) sv_RunWorldFlusher, self) != 0) {
+		CD_abort("pthread thread failed to initialize");
+	}
+
+	if (pthread_create(&self->tick.thread, NULL, (void *(*)(void *)) sv_RunWorldTick, self) != 0) {
+		CD_abort("pthread thread failed to initialize");
+	}
+
 	return self;
 }
 
 bool
 SV_WorldSave (SVWorld* self)
 {
-	bool status;
+	assert(self);
 
-	CD_EventDispatchWithError(status, self->server, "World.save", self);
+	pthread_mutex_lock(&self->lock.chunks);
+	CD_MAP_FOREACH(self->chunks.resident, it) {
+		sv_WorldChunkQueue(self, (SVChunk*) CD_MapIteratorValue(it), false);
+	}
+	pthread_mutex_unlock(&self->lock.chunks);
 
-	return status == CDOk;
+	return true;
 }
 
 void
@@ -81,6 +540,22 @@ SV_DestroyWorld (SVWorld* self)
 {
 	assert(self);
 
+	// No tick may run on a World that's going away
+	__atomic_store_n(&self->tick.running, false, __ATOMIC_SEQ_CST);
+	pthread_join(self->tick.thread, NULL);
+
+	CD_DestroyVector(self->tick.pinned);
+
+	// Everything still dirty is written before the persistence goes away
+	SV_WorldSave(self);
+
+	pthread_mutex_lock(&self->lock.persistence);
+	self->persistence.running = false;
+	pthread_cond_signal(&self->persistence.condition);
+	pthread_mutex_unlock(&self->lock.persistence);
+
+	pthread_join(self->persistence.thread, NULL);
+
 	CD_EventDispatch(self->server, "World.destroy", self);
 
 	CD_HASH_FOREACH(self->players, it) {
@@ -94,13 +569,59 @@ SV_DestroyWorld (SVWorld* self)
 	CD_DestroyHash(self->players);
 	CD_DestroyMap(self->entities);
 
-	CD_DestroySet(self->chunks);
+	CD_MAP_FOREACH(self->grid.cells, it) {
+		CD_DestroyList((CDList*) CD_MapIteratorValue(it));
+	}
+
+	CD_DestroyMap(self->grid.cells);
+
+	SDEBUG(self->server, "%s> chunk cache: %llu hits, %llu misses, %llu evictions", CD_StringContent(self->name),
+		(unsigned long long) self->chunks.statistics.hits,
+		(unsigned long long) self->chunks.statistics.misses,
+		(unsigned long long) self->chunks.statistics.evictions);
+
+	SDEBUG(self->server, "%s> persistence: %llu chunks saved in %llu batches, %llu failed writes", CD_StringContent(self->name),
+		(unsigned long long) self->persistence.statistics.chunks,
+		(unsigned long long) self->persistence.statistics.batches,
+		(unsigned long long) self->persistence.statistics.failures);
+
+	if (self->tick.count > 0) {
+		SDEBUG(self->server, "%s> ticks: %llu run, %llu overruns, %llu skipped, the longest took %.2fms", CD_StringContent(self->name),
+			(unsigned long long) self->tick.count,
+			(unsigned long long) self->tick.statistics.overruns,
+			(unsigned long long) self->tick.statistics.skipped,
+			self->tick.statistics.longest / 1000000.0);
+
+		sv_WorldTickReport(self, self->tick.count, self->tick.statistics.phases, self->tick.statistics.longest, 0);
+	}
+
+	CD_MAP_FOREACH(self->chunks.resident, it) {
+		SVChunk* chunk = (SVChunk*) CD_MapIteratorValue(it);
+
+		if (chunk->cache.packet) {
+			SV_ReleaseChunkPacket(chunk->cache.packet);
+		}
+
+		CD_free(chunk);
+	}
+
+	CD_DestroyMap(self->chunks.resident);
+	CD_DestroyMap(self->chunks.pinned);
+	CD_DestroyMap(self->chunks.loading);
+
+	CD_DestroyList(self->persistence.queue);
+	CD_DestroyList(self->persistence.failed);
+	CD_DestroyMap(self->persistence.pending);
 
 	CD_DestroyString(self->name);
 
-	CD_DestroyDynamic(DYNAMIC(self));
+	CD_FinalizeDynamic(DYNAMIC(self));
 
 	pthread_spin_destroy(&self->lock.time);
+	pthread_mutex_destroy(&self->lock.chunks);
+	pthread_mutex_destroy(&self->lock.persistence);
+	pthread_cond_destroy(&self->persistence.condition);
+	pthread_rwlock_destroy(&self->lock.grid);
 
 	config_unexport(&self->config.data);
 
@@ -122,6 +643,72 @@ SV_WorldGenerateEntityId (SVWorld* self)
 	return self->lastGeneratedEntityId;
 }
 
+/**
+ * Add an entity to the cell of its position, must be called with the grid
+ * lock held for writing.
+ */
+static
+void
+sv_WorldGridAdd (SVWorld* self, SVEntity* entity)
+{
+	CDMapId id   = SV_ChunkPositionToId(SV_PrecisePositionToChunkPosition(entity->position));
+	CDList* cell = (CDList*) CD_MapGet(self->grid.cells, id);
+
+	if (!cell) {
+		CD_MapPut(self->grid.cells, id, (CDPointer) (cell = CD_CreateList()));
+	}
+
+	CD_ListPush(cell, (CDPointer) entity);
+}
+
+/**
+ * Remove an entity from the cell of its position, must be called with the
+ * grid lock held for writing.
+ *
+ * @return true if the entity was indexed
+ */
+static
+bool
+sv_WorldGridDelete (SVWorld* self, SVEntity* entity)
+{
+	CDMapId id   = SV_ChunkPositionToId(SV_PrecisePositionToChunkPosition(entity->position));
+	CDList* cell = (CDList*) CD_MapGet(self->grid.cells, id);
+
+	if (!cell || !CD_ListDelete(cell, (CDPointer) entity)) {
+		return false;
+	}
+
+	// Empty cells are dropped so the index only grows with the populated area
+	if (CD_ListLength(cell) == 0) {
+		CD_MapDelete(self->grid.cells, id);
+		CD_DestroyList(cell);
+	}
+
+	return true;
+}
+
+static inline
+void
+sv_WorldGridInsert (SVWorld* self, SVEntity* entity)
+{
+	pthread_rwlock_wrlock(&self->lock.grid);
+	sv_WorldGridAdd(self, entity);
+	pthread_rwlock_unlock(&self->lock.grid);
+}
+
+static inline
+bool
+sv_WorldGridRemove (SVWorld* self, SVEntity* entity)
+{
+	bool result;
+
+	pthread_rwlock_wrlock(&self->lock.grid);
+	result = sv_WorldGridDelete(self, entity);
+	pthread_rwlock_unlock(&self->lock.grid);
+
+	return result;
+}
+
 bool
 SV_WorldAddPlayer (SVWorld* self, SVPlayer* player)
 {
@@ -171,6 +758,8 @@ SV_WorldAddPlayer (SVWorld* self, SVPlayer* player)
 				(CDPointer) player);
 	CD_MapPut(self->entities, player->entity.id, (CDPointer) player);
 
+	sv_WorldGridInsert(self, &player->entity);
+
 	done: {
 		return ret;
 	}
@@ -185,6 +774,81 @@ SV_WorldRemovePlayer (SVWorld* self, SVPlayer* player)
 
 	CD_HashDelete(player->world->players, CD_StringContent(player->username));
 	CD_MapDelete(player->world->entities, player->entity.id);
+
+	sv_WorldGridRemove(self, &player->entity);
+}
+
+void
+SV_WorldMoveEntity (SVWorld* self, SVEntity* entity, SVPrecisePosition position)
+{
+	assert(self);
+	assert(entity);
+
+	SVChunkPosition from = SV_PrecisePositionToChunkPosition(entity->position);
+	SVChunkPosition to   = SV_PrecisePositionToChunkPosition(position);
+
+	pthread_rwlock_wrlock(&self->lock.grid);
+	if (!SV_ChunkPositionEqual(from, to)) {
+		// Entities that aren't indexed stay that way
+		if (sv_WorldGridDelete(self, entity)) {
+			entity->position = position;
+
+			sv_WorldGridAdd(self, entity);
+		}
+	}
+
+	entity->position = position;
+	pthread_rwlock_unlock(&self->lock.grid);
+}
+
+static inline
+void
+sv_WorldGridCollect (CDList* cell, CDList* result)
+{
+	CD_LIST_FOREACH(cell, it) {
+		SVEntity* entity = (SVEntity*) CD_ListIteratorValue(it);
+
+		if (entity->type == SVEntityPlayer) {
+			CD_ListPush(result, (CDPointer) entity);
+		}
+	}
+}
+
+CDList*
+SV_WorldGetPlayersInRadius (SVWorld* self, SVChunkPosition center, int radius)
+{
+	CDList* result = CD_CreateList();
+	size_t  area   = (size_t) (radius * 2 + 1) * (radius * 2 + 1);
+
+	assert(self);
+
+	pthread_rwlock_rdlock(&self->lock.grid);
+	if (area > CD_MapLength(self->grid.cells)) {
+		// Sparse worlds are faster to walk by occupied cell
+		CD_MAP_FOREACH(self->grid.cells, it) {
+			CDMapId         id       = CD_MapIteratorKey(it);
+			SVChunkPosition position = { (int) (id >> 32), (int) (int32_t) (id & 0xffffffff) };
+
+			if (SV_IsCoordInRadius(&position, &center, radius)) {
+				sv_WorldGridCollect((CDList*) CD_MapIteratorValue(it), result);
+			}
+		}
+	}
+	else {
+		for (int x = center.x - radius; x <= center.x + radius; x++) {
+			for (int z = center.z - radius; z <= center.z + radius; z++) {
+				SVChunkPosition position = { x, z };
+				CDList*         cell     = (CDList*) CD_MapGet(self->grid.cells, SV_ChunkPositionToId(position));
+
+				if (cell) {
+					sv_WorldGridCollect(cell, result);
+				}
+			}
+		}
+	}
+	pthread_rwlock_unlock(&self->lock.grid);
+
+	return result;
 }
 
 void
@@ -192,12 +856,25 @@ SV_WorldBroadcastBuffer (SVWorld* self, CDBuffer* buffer)
 {
 	assert(self);
 
+	CDSharedBuffer* data = CD_CreateSharedBuffer(buffer);
+
+	SV_WorldBroadcastShared(self, data);
+
+	CD_ReleaseSharedBuffer(data);
+}
+
+void
+SV_WorldBroadcastShared (SVWorld* self, CDSharedBuffer* data)
+{
+	assert(self);
+	assert(data);
+
 	CD_HASH_FOREACH(self->players, it) {
 		SVPlayer* player = (SVPlayer*) CD_HashIteratorValue(it);
 
 		pthread_rwlock_rdlock(&player->client->lock.status);
 		if (player->client->status != CDClientDisconnect) {
-			CD_ClientSendBuffer(player->client, buffer);
+			CD_ClientSendShared(player->client, data);
 		}
 		pthread_rwlock_unlock(&player->client->lock.status);
 	}
@@ -208,11 +885,11 @@ SV_WorldBroadcastPacket (SVWorld* self, SVPacket* packet)
 {
 	assert(self);
 
-	CDBuffer* buffer = SV_PacketToBuffer(packet);
+	CDSharedBuffer* data = SV_PacketToSharedBuffer(packet);
 
-	SV_WorldBroadcastBuffer(self, buffer);
+	SV_WorldBroadcastShared(self, data);
 
-	CD_DestroyBuffer(buffer);
+	CD_ReleaseSharedBuffer(data);
 }
 
 void
@@ -259,28 +936,498 @@ SV_WorldSetTime (SVWorld* self, uint16_t time)
 	return time;
 }
 
+static inline
+void
+sv_WorldChunkUnlink (SVWorld* self, SVChunk* chunk)
+{
+	if (chunk->cache.previous) {
+		chunk->cache.previous->cache.next = chunk->cache.next;
+	}
+	else if (self->chunks.first == chunk) {
+		self->chunks.first = chunk->cache.next;
+	}
+
+	if (chunk->cache.next) {
+		chunk->cache.next->cache.previous = chunk->cache.previous;
+	}
+	else if (self->chunks.last == chunk) {
+		self->chunks.last = chunk->cache.previous;
+	}
+
+	chunk->cache.previous = NULL;
+	chunk->cache.next     = NULL;
+}
+
+static inline
+void
+sv_WorldChunkAcquire (SVWorld* self, SVChunk* chunk)
+{
+	if (chunk->cache.references == 0 && chunk->cache.pins == 0) {
+		sv_WorldChunkUnlink(self, chunk);
+	}
+
+	chunk->cache.references++;
+}
+
+/**
+ * Replace the cached MapChunk packet of a chunk, its bytes count against the
+ * cache budget, must be called with the chunks lock held.
+ */
+static
+void
+sv_WorldChunkSetPacket (SVWorld* self, SVChunk* chunk, SVChunkPacket* packet)
+{
+	if (chunk->cache.packet) {
+		self->chunks.size -= chunk->cache.packet->length;
+
+		SV_ReleaseChunkPacket(chunk->cache.packet);
+	}
+
+	if ((chunk->cache.packet = packet)) {
+		self->chunks.size += packet->length;
+	}
+}
+
+/**
+ * Track the loads in flight of a chunk, must be called with the chunks lock
+ * held.
+ *
+ * An entry counts the loads in its low 16 bits and the evictions of the chunk
+ * while there were loads above them, a load that sees the evictions change
+ * may have read what the evicted copy was about to overwrite.
+ *
+ * @param change 1 when a load starts, -1 when it's done, 0 to only read
+ *
+ * @return The evictions of the chunk since its loads started
+ */
+static
+CDPointer
+sv_WorldChunkLoading (SVWorld* self, SVChunkPosition position, int change)
+{
+	CDMapId   id    = SV_ChunkPositionToId(position);
+	CDPointer entry = CD_MapGet(self->chunks.loading, id) + change;
+
+	if ((entry & 0xFFFF) == 0) {
+		CD_MapDelete(self->chunks.loading, id);
+	}
+	else if (change != 0) {
+		CD_MapPut(self->chunks.loading, id, entry);
+	}
+
+	return entry >> 16;
+}
+
+/**
+ * Evict least recently used chunks until the cache fits in its budget, must
+ * be called with the chunks lock held.
+ */
+static
+void
+sv_WorldChunkEvict (SVWorld* self)
+{
+	while (self->chunks.size > self->chunks.budget && self->chunks.first) {
+		SVChunk*  chunk = self->chunks.first;
+		CDPointer loads;
+
+		sv_WorldChunkUnlink(self, chunk);
+		CD_MapDelete(self->chunks.resident, SV_ChunkPositionToId(chunk->position));
+
+		// Loads of it in flight may have read what it's about to overwrite
+		if ((loads = CD_MapGet(self->chunks.loading, SV_ChunkPositionToId(chunk->position)))) {
+			CD_MapPut(self->chunks.loading, SV_ChunkPositionToId(chunk->position), loads + (1 << 16));
+		}
+
+		sv_WorldChunkSetPacket(self, chunk, NULL);
+
+		self->chunks.size -= sizeof(SVChunk);
+		self->chunks.statistics.evictions++;
+
+		sv_WorldChunkQueue(self, chunk, true);
+	}
+}
+
+/**
+ * Put back an unused chunk at the most recently used end, must be called with
+ * the chunks lock held.
+ */
+static inline
+void
+sv_WorldChunkRetire (SVWorld* self, SVChunk* chunk)
+{
+	if (chunk->cache.references > 0 || chunk->cache.pins > 0) {
+		return;
+	}
+
+	chunk->cache.previous = self->chunks.last;
+	chunk->cache.next     = NULL;
+
+	if (self->chunks.last) {
+		self->chunks.last->cache.next = chunk;
+	}
+	else {
+		self->chunks.first = chunk;
+	}
+
+	self->chunks.last = chunk;
+
+	sv_WorldChunkEvict(self);
+}
+
 SVChunk*
 SV_WorldGetChunk (SVWorld* self, int x, int z)
 {
-	SVChunk* result = CD_alloc(sizeof(SVChunk));
-	CDError  status;
+	SVChunkPosition position = { x, z };
+	SVChunk*        result;
+	SVChunk*        loaded;
+	SVChunk*        snapshot;
+	CDPointer       evictions;
+	CDError         status;
 
-	CD_EventDispatchWithError(status, self->server, "World.chunk", self, x, z, result);
+	assert(self);
+
+	pthread_mutex_lock(&self->lock.chunks);
+	if ((result = (SVChunk*) CD_MapGet(self->chunks.resident, SV_ChunkPositionToId(position)))) {
+		sv_WorldChunkAcquire(self, result);
+		self->chunks.statistics.hits++;
+	}
+	else {
+		self->chunks.statistics.misses++;
+	}
+	pthread_mutex_unlock(&self->lock.chunks);
 
-	if (status == CDOk) {
+	if (result) {
 		return result;
 	}
+
+	// Loading can hit the disk or the map generator, so it's done without
+	// holding the lock and the race with other loaders is resolved after
+	loaded = CD_malloc(sizeof(SVChunk));
+
+	pthread_mutex_lock(&self->lock.chunks);
+	evictions = sv_WorldChunkLoading(self, position, 1);
+	pthread_mutex_unlock(&self->lock.chunks);
+
+	while (true) {
+		memset(loaded, 0, sizeof(SVChunk));
+		loaded->position = position;
+
+		// A snapshot waiting to be written is newer than what's saved
+		pthread_mutex_lock(&self->lock.persistence);
+		if ((snapshot = (SVChunk*) CD_MapGet(self->persistence.pending, SV_ChunkPositionToId(position)))) {
+			memcpy(loaded, snapshot, sizeof(SVChunk));
+		}
+		pthread_mutex_unlock(&self->lock.persistence);
+
+		if (snapshot) {
+			status = CDOk;
+		}
+		else {
+			CD_EventDispatchWithError(status, self->server, "World.chunk", self, x, z, loaded);
+		}
+
+		pthread_mutex_lock(&self->lock.chunks);
+		if (status != CDOk) {
+			sv_WorldChunkLoading(self, position, -1);
+			pthread_mutex_unlock(&self->lock.chunks);
+
+			CD_free(loaded);
+
+			errno = CD_ErrorToErrno(status);
+
+			return NULL;
+		}
+
+		// Another loader may have inserted the chunk meanwhile, it's the newest
+		// copy there is
+		if ((result = (SVChunk*) CD_MapGet(self->chunks.resident, SV_ChunkPositionToId(position)))) {
+			break;
+		}
+
+		// Or inserted, changed and evicted it, then what it left pending is
+		// newer than what was loaded, and if it's been written already the
+		// load has to be done again
+		pthread_mutex_lock(&self->lock.persistence);
+		if ((snapshot = (SVChunk*) CD_MapGet(self->persistence.pending, SV_ChunkPositionToId(position)))) {
+			memcpy(loaded, snapshot, sizeof(SVChunk));
+		}
+		pthread_mutex_unlock(&self->lock.persistence);
+
+		if (snapshot || sv_WorldChunkLoading(self, position, 0) == evictions) {
+			break;
+		}
+
+		evictions = sv_WorldChunkLoading(self, position, 0);
+		pthread_mutex_unlock(&self->lock.chunks);
+	}
+
+	sv_WorldChunkLoading(self, position, -1);
+
+	if (result) {
+		sv_WorldChunkAcquire(self, result);
+	}
 	else {
-		CD_free(result);
+		result                   = loaded;
+		result->cache.references = 1;
+		result->cache.pins       = (int) CD_MapDelete(self->chunks.pinned, SV_ChunkPositionToId(position));
+
+		CD_MapPut(self->chunks.resident, SV_ChunkPositionToId(position), (CDPointer) result);
+		self->chunks.size += sizeof(SVChunk);
 
-		errno = CD_ErrorToErrno(status);
+		sv_WorldChunkEvict(self);
+	}
+	pthread_mutex_unlock(&self->lock.chunks);
+
+	if (result != loaded) {
+		CD_free(loaded);
+	}
+
+	return result;
+}
+
+void
+SV_WorldReleaseChunk (SVWorld* self, SVChunk* chunk)
+{
+	assert(self);
+
+	if (!chunk) {
+		return;
+	}
+
+	pthread_mutex_lock(&self->lock.chunks);
+	assert(chunk->cache.references > 0);
+
+	chunk->cache.references--;
+	sv_WorldChunkRetire(self, chunk);
+	pthread_mutex_unlock(&self->lock.chunks);
+}
+
+void
+SV_WorldPinChunk (SVWorld* self, int x, int z)
+{
+	SVChunkPosition position = { x, z };
+	SVChunk*        chunk;
+
+	assert(self);
+
+	pthread_mutex_lock(&self->lock.chunks);
+	if ((chunk = (SVChunk*) CD_MapGet(self->chunks.resident, SV_ChunkPositionToId(position)))) {
+		if (chunk->cache.references == 0 && chunk->cache.pins == 0) {
+			sv_WorldChunkUnlink(self, chunk);
+		}
+
+		chunk->cache.pins++;
+	}
+	else {
+		CD_MapPut(self->chunks.pinned, SV_ChunkPositionToId(position),
+			CD_MapGet(self->chunks.pinned, SV_ChunkPositionToId(position)) + 1);
+	}
+	pthread_mutex_unlock(&self->lock.chunks);
+}
+
+void
+SV_WorldUnpinChunk (SVWorld* self, int x, int z)
+{
+	SVChunkPosition position = { x, z };
+	SVChunk*        chunk;
+	CDPointer       pins;
+
+	assert(self);
+
+	pthread_mutex_lock(&self->lock.chunks);
+	if ((chunk = (SVChunk*) CD_MapGet(self->chunks.resident, SV_ChunkPositionToId(position)))) {
+		if (chunk->cache.pins > 0) {
+			chunk->cache.pins--;
+			sv_WorldChunkRetire(self, chunk);
+		}
+	}
+	else if ((pins = CD_MapGet(self->chunks.pinned, SV_ChunkPositionToId(position))) > 1) {
+		CD_MapPut(self->chunks.pinned, SV_ChunkPositionToId(position), pins - 1);
+	}
+	else {
+		CD_MapDelete(self->chunks.pinned, SV_ChunkPositionToId(position));
+	}
+	pthread_mutex_unlock(&self->lock.chunks);
+}
+
+void
+SV_WorldTouchChunk (SVWorld* self, SVChunk* chunk)
+{
+	assert(self);
+	assert(chunk);
+
+	pthread_mutex_lock(&self->lock.chunks);
+	chunk->cache.version++;
+	pthread_mutex_unlock(&self->lock.chunks);
+}
+
+void
+SV_WorldSetChunkBlock (SVWorld* self, SVChunk* chunk, SVBlockPosition position, SVByte type, SVByte data)
+{
+	int index = position.y + 128 * ((position.z & 0xF) + 16 * (position.x & 0xF));
+
+	assert(self);
+	assert(chunk);
+
+	pthread_mutex_lock(&self->lock.chunks);
+	chunk->blocks[index] = type;
+
+	// Two blocks share a byte of data, the even one takes the low nibble
+	if (index & 1) {
+		chunk->data[index >> 1] = (chunk->data[index >> 1] & 0x0F) | ((data & 0x0F) << 4);
+	}
+	else {
+		chunk->data[index >> 1] = (chunk->data[index >> 1] & 0xF0) | (data & 0x0F);
+	}
+
+	chunk->cache.version++;
+	pthread_mutex_unlock(&self->lock.chunks);
+}
+
+/**
+ * Build a MapChunk packet out of the serialized chunk, data is freed.
+ */
+static
+SVChunkPacket*
+sv_CreateChunkPacket (SVChunkPosition position, uint32_t version, Bytef* data)
+{
+	SVChunkPacket* self    = CD_malloc(sizeof(SVChunkPacket));
+	uLongf         written = compressBound(81920);
+	Bytef*         buffer  = CD_malloc(written);
+
+	if (compress(buffer, &written, data, 81920) != Z_OK) {
+		CD_free(buffer);
+		CD_free(data);
+		CD_free(self);
+
+		errno = EILSEQ;
 
 		return NULL;
 	}
+
+	CD_free(data);
+
+	if (pthread_spin_init(&self->lock, 0) != 0) {
+		CD_abort("pthread spinlock failed to initialize");
+	}
+
+	self->version    = version;
+	self->references = 1;
+
+	DO {
+		SVPacketMapChunk pkt = {
+			.response = {
+				.position = SV_ChunkPositionToBlockPosition(position),
+
+				.size = {
+					.x = 16,
+					.y = 128,
+					.z = 16
+				},
+
+				.length = written,
+				.item   = (SVByte*) buffer
+			}
+		};
+
+		SVPacket  packet = { SVResponse, SVMapChunk, (CDPointer) &pkt };
+		CDBuffer* output = SV_PacketToBuffer(&packet);
+
+		self->length = CD_BufferLength(output);
+		self->data   = (uint8_t*) CD_BufferContent(output);
+
+		CD_DestroyBuffer(output);
+	}
+
+	CD_free(buffer);
+
+	return self;
+}
+
+SVChunkPacket*
+SV_WorldGetChunkPacket (SVWorld* self, int x, int z)
+{
+	SVChunk*       chunk = SV_WorldGetChunk(self, x, z);
+	SVChunkPacket* result;
+	Bytef*         data  = NULL;
+	uint32_t       version;
+
+	if (!chunk) {
+		return NULL;
+	}
+
+	pthread_mutex_lock(&self->lock.chunks);
+	version = chunk->cache.version;
+
+	if (chunk->cache.packet && chunk->cache.packet->version == version) {
+		result = SV_RetainChunkPacket(chunk->cache.packet);
+		self->chunks.statistics.packetHits++;
+	}
+	else {
+		result = NULL;
+		self->chunks.statistics.packetMisses++;
+
+		// Changes are made under the lock, so the copy matches the version and
+		// the compression can run without it
+		data = CD_malloc(81920);
+		SV_ChunkToByteArray(chunk, data);
+	}
+	pthread_mutex_unlock(&self->lock.chunks);
+
+	if (!result) {
+		if ((result = sv_CreateChunkPacket(chunk->position, version, data))) {
+			pthread_mutex_lock(&self->lock.chunks);
+			if (!chunk->cache.packet || chunk->cache.packet->version != chunk->cache.version) {
+				sv_WorldChunkSetPacket(self, chunk, SV_RetainChunkPacket(result));
+				sv_WorldChunkEvict(self);
+			}
+			pthread_mutex_unlock(&self->lock.chunks);
+		}
+	}
+
+	SV_WorldReleaseChunk(self, chunk);
+
+	return result;
+}
+
+SVChunkPacket*
+SV_RetainChunkPacket (SVChunkPacket* self)
+{
+	assert(self);
+
+	pthread_spin_lock(&self->lock);
+	self->references++;
+	pthread_spin_unlock(&self->lock);
+
+	return self;
 }
 
 void
+SV_ReleaseChunkPacket (SVChunkPacket* self)
+{
+	int references;
+
+	assert(self);
+
+	pthread_spin_lock(&self->lock);
+	references = --self->references;
+	pthread_spin_unlock(&self->lock);
+
+	if (references > 0) {
+		return;
+	}
+
+	pthread_spin_destroy(&self->lock);
+
+	CD_free(self->data);
+	CD_free(self);
+}
+
+bool
 SV_WorldSetChunk (SVWorld* self, SVChunk* chunk)
 {
-	CD_EventDispatch(self->server, "World.chunk=", self, chunk->position.x, chunk->position.z, chunk);
+	CDError status;
+
+	CD_EventDispatchWithError(status, self->server, "World.chunk=", self, chunk->position.x, chunk->position.z, chunk);
+
+	return status == CDOk;
 }
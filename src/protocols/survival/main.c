@@ -41,6 +41,11 @@ CD_InitializeSurvivalProtocol (CDServer* server)
 	CD_EventProvides(server, "World.chunk=",  CD_CreateEventParameters("SVWorld", "int", "int", "SVChunk", NULL));
 	CD_EventProvides(server, "World.destroy", CD_CreateEventParameters("SVWorld", NULL));
 
+	CD_EventProvides(server, "World.tick.input",     CD_CreateEventParameters("SVWorld", NULL));
+	CD_EventProvides(server, "World.tick.simulate",  CD_CreateEventParameters("SVWorld", NULL));
+	CD_EventProvides(server, "World.tick.broadcast", CD_CreateEventParameters("SVWorld", NULL));
+	CD_EventProvides(server, "World.tick.flush",     CD_CreateEventParameters("SVWorld", NULL));
+
 	return server->protocol;
 }
 
@@ -38,17 +38,8 @@ const char SVCharsetPixel[] = {
 	4, 5, 5, 5, 5, 4, 4, 4, 4, 5, 1, 5, 1, 5, 1, 1, 4, 5, 4, 1, 5, 6, 3, 5, 3, 5
 };
 
-const size_t SVCharsetLen = 143;
-const size_t SVCharsetOffset[] = {
-	0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20,
-	21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 35, 37, 39, 41, 43, 45, 47,
-	49, 51, 53, 55, 57, 59, 61, 62, 63, 64, 65, 66, 67, 68, 69, 70, 71, 72, 73,
-	74, 75, 76, 77, 78, 79, 80, 81, 82, 83, 84, 85, 86, 87, 88, 89, 90, 91, 92,
-	93, 94, 95, 96, 97, 98, 99, 100, 101, 102, 103, 104, 105, 106, 107, 108,
-	109, 110, 111, 112, 113, 114, 115, 116, 117, 118, 119, 120, 121, 122, 123,
-	125, 127, 129, 131, 133, 135, 137, 139, 141, 143, 145, 147, 149, 151, 153,
-	155, 157, 159, 161, 163, 165, 167, 169, 171, 173, 175, 177, 179, 181, 183,
-	185, 187, 189, 191
+const uint64_t SVCharsetValid[4] = {
+	0xffffffff00000000ULL, 0x7ffffffeffffffffULL, 0xbc005c0a00000000ULL, 0x9f5efff711c202f0ULL
 };
 
 const SVEntityId SVMaxEntityId = INT_MAX;
@@ -128,75 +119,140 @@ SV_AppendData (SVMetadata* metadata, SVData* data)
 	return metadata;
 }
 
+/**
+ * Get the next character of a String as the client gets it, the ones it
+ * can't draw become ?. A color code followed by a single character is cut
+ * along with it.
+ *
+ * @return false when the String is over
+ */
+static inline
 bool
-SV_StringIsValid (SVString self)
+sv_StringNextSanitized (const uint8_t* data, size_t size, size_t* index, uint32_t* ch)
 {
-	assert(self);
+	if (*index >= size) {
+		return false;
+	}
 
-	for (size_t i = 0, ie = CD_StringLength(self); i < ie; i++) {
-		bool      has = false;
-		CDString* ch  = CD_CharAt(self, i);
+	*ch = SV_UTF8Next(data, size, index);
 
-		for (size_t h = 0; h < SVCharsetLen; h++) {
-			const char* che = &SVCharset[SVCharsetOffset[h]];
+	if (*ch == 0xA7) {
+		size_t next = *index;
 
-			if (strncmp(CD_StringContent(ch), che, CD_StringSize(ch)) == 0) {
-				has = true;
-				break;
-			}
-		}
+		if (next < size) {
+			SV_UTF8Next(data, size, &next);
 
-		if (!has && !(strncmp(CD_StringContent(ch), "§", 2) == 0 && i < ie - 2)) {
-			CD_DestroyString(ch);
-			return false;
-		}
+			if (next >= size) {
+				*index = size;
 
-		CD_DestroyString(ch);
+				return false;
+			}
+		}
+	}
+	else if (!SV_CharIsValid(*ch)) {
+		*ch = '?';
 	}
 
 	return true;
 }
 
-SVString
-SV_StringSanitize (SVString self)
+bool
+SV_StringIsValid (SVString self)
 {
-	CDString* result = CD_CreateString();
+	const uint8_t* data = (const uint8_t*) CD_StringContent(self);
+	size_t         size = CD_StringSize(self);
 
 	assert(self);
 
-	for (size_t i = 0, ie = CD_StringLength(self); i < ie; i++) {
-		bool      has = false;
-		CDString* ch  = CD_CharAt(self, i);
+	for (size_t i = 0; i < size;) {
+		uint32_t ch = SV_UTF8Next(data, size, &i);
 
-		for (size_t h = 0; h < SVCharsetLen; h++) {
-			const char* che = &SVCharset[SVCharsetOffset[h]];
-			
-			if (strncmp(CD_StringContent(ch), che, CD_StringSize(ch)) == 0) {
-				has = true;
-				break;
-			}
+		if (SV_CharIsValid(ch)) {
+			continue;
 		}
 
-		if (i == ie - 2 && strncmp(CD_StringContent(ch), "§", 2) == 0){
-			CD_DestroyString(ch);
-			break;
+		// A color code needs at least two characters after it
+		if (ch == 0xA7) {
+			size_t next = i;
+
+			for (int n = 0; n < 2 && next < size; n++) {
+				SV_UTF8Next(data, size, &next);
+			}
+
+			if (next < size) {
+				continue;
+			}
 		}
 
-		if (has || strncmp(CD_StringContent(ch), "§", 2) == 0) {
-			CD_AppendString(result, ch);
+		return false;
+	}
+
+	return true;
+}
+
+size_t
+SV_StringSanitizeTo (SVString self, uint8_t* output)
+{
+	const uint8_t* data   = (const uint8_t*) CD_StringContent(self);
+	size_t         size   = CD_StringSize(self);
+	size_t         length = 0;
+	size_t         start  = 0;
+	size_t         index  = 0;
+	uint32_t       ch;
+
+	assert(self);
+
+	while (sv_StringNextSanitized(data, size, &index, &ch)) {
+		if (ch == '?' && data[start] != '?') {
+			output[length++] = '?';
 		}
 		else {
-			CD_AppendCString(result, "?");
+			memcpy(&output[length], &data[start], index - start);
+			length += index - start;
 		}
 
-		CD_DestroyString(ch);
+		start = index;
 	}
 
-	self->length = CD_UTF8_strnlen(CD_StringContent(self), self->raw->slen);
+	return length;
+}
+
+SVString
+SV_StringSanitize (SVString self)
+{
+	char*    data   = CD_malloc(CD_StringSize(self) + 1);
+	size_t   length = SV_StringSanitizeTo(self, (uint8_t*) data);
+	SVString result = CD_CreateStringFromBuffer(data, length);
+
+	data[length]      = '\0';
+	result->raw->mlen = CD_StringSize(self) + 1;
+	result->external  = false;
 
 	return result;
 }
 
+size_t
+SV_StringToUTF16 (SVString self, uint8_t* output)
+{
+	const uint8_t* data   = (const uint8_t*) CD_StringContent(self);
+	size_t         size   = CD_StringSize(self);
+	size_t         index  = 0;
+	size_t         units  = 0;
+	uint32_t       ch;
+
+	assert(self);
+
+	// Everything sv_StringNextSanitized lets through is in the BMP
+	while (sv_StringNextSanitized(data, size, &index, &ch)) {
+		output[units * 2]     = ch >> 8;
+		output[units * 2 + 1] = ch & 0xFF;
+
+		units++;
+	}
+
+	return units;
+}
+
 SVString
 SV_StringColorRange (SVString self, SVStringColor color, size_t a, size_t b)
 {
@@ -243,15 +299,12 @@ SV_CompareChunkPosition (CDSet* self, SVChunkPosition* a, SVChunkPosition* b)
 	return (a->x == b->x && a->z == b->z);
 }
 
-unsigned int
+uint64_t
 SV_HashChunkPosition (CDSet* self, SVChunkPosition* position)
 {
-	const int HASHMULTIPLIER = 31;
-	const int CHUNKBUCKETS   = 401; // Max chunks to the nearest prime
-
 	assert(self);
 
-	return ((((position->x * HASHMULTIPLIER)) * HASHMULTIPLIER + position->z) * HASHMULTIPLIER) % CHUNKBUCKETS;
+	return CD_SetMix(((uint64_t) (uint32_t) position->x << 32) | (uint32_t) position->z);
 }
 
 void